@@ -110,6 +110,17 @@ void App::OnClevyKeyboardDisconnected()
     m_pCore->OnClevyKeyboardDisconnected();
 }
 
+void App::OnClevyKeyboardPresenceKnown()
+{
+    UpdatePreferencesDialog();
+
+#ifdef __LICENSING_FULL__
+    m_pTrayIcon->UpdateIcon();
+#endif
+
+    m_pCore->OnClevyKeyboardPresenceKnown(m_pDevice->IsClevyKeyboardPresent());
+}
+
 void App::OnDemoTimeLimitExpired()
 {
     wxMessageBox(_("Your 30 minute demo has expired. Please purchase a license."), _("Clevy Dyscover demo license"), wxSTAY_ON_TOP);
@@ -132,6 +143,11 @@ void App::UpdateTrayIcon()
     m_pTrayIcon->UpdateIcon();
 }
 
+void App::UpdateSpeechSettings()
+{
+    m_pCore->OnSpeechSettingsChanged();
+}
+
 bool App::IsClevyKeyboardPresent()
 {
     return m_pDevice->IsClevyKeyboardPresent();
@@ -24,12 +24,14 @@ private:
 public:
     virtual void OnClevyKeyboardConnected() override;
     virtual void OnClevyKeyboardDisconnected() override;
+    virtual void OnClevyKeyboardPresenceKnown() override;
 
     virtual void OnDemoTimeLimitExpired() override;
 
     void ShowPreferencesDialog();
     void UpdatePreferencesDialog();
     void UpdateTrayIcon();
+    void UpdateSpeechSettings();
 
     bool IsClevyKeyboardPresent();
 
@@ -13,7 +13,10 @@
 #endif
 
 #ifndef __NO_PORTAUDIO__
-Audio::Audio() : m_pStream(nullptr)
+// Audio is written in blocks of this many frames, so that Stop() takes effect quickly.
+static const unsigned long kBlockFrames = 512;
+
+Audio::Audio() : m_pStream(nullptr), m_frameSize(0), m_stopCount(0), m_appliedStopCount(0)
 {
 	Pa_Initialize();
 }
@@ -26,6 +29,7 @@ Audio::~Audio()
 
 bool Audio::Open(int channels, int samplerate, PaSampleFormat sampleformat)
 {
+	m_frameSize = channels * Pa_GetSampleSize(sampleformat);
 	PaError error = Pa_OpenDefaultStream(&m_pStream, 0, channels, sampleformat, samplerate, paFramesPerBufferUnspecified, nullptr, nullptr);
 	if (error != paNoError)
 	{
@@ -38,25 +42,63 @@ bool Audio::Open(int channels, int samplerate, PaSampleFormat sampleformat)
 void Audio::Close()
 {
 	Stop();
+	ApplyStop();
 	if (m_pStream) {
 		Pa_CloseStream(m_pStream);
 		m_pStream = nullptr;
 	}
 }
 
-bool Audio::Write(const void* audiodata, unsigned long audiodatalen)
+bool Audio::Write(const void* audiodata, unsigned long audiodatalen, unsigned long* pWritten)
 {
+	if (pWritten) *pWritten = 0;
 	if (!m_pStream) return false;
-	PaError error = Pa_WriteStream(m_pStream, audiodata, audiodatalen);
-	return error == paNoError;
+
+	// Audio buffered before an earlier Stop() is not played ahead of this
+	const char* data = static_cast<const char*>(audiodata);
+	const unsigned stopCount = m_stopCount;
+	ApplyStop();
+
+	while (audiodatalen > 0)
+	{
+		if (stopCount != m_stopCount) {
+			ApplyStop();
+			return false;
+		}
+
+		if (Pa_IsStreamStopped(m_pStream) == 1) Pa_StartStream(m_pStream);
+		unsigned long frames = audiodatalen < kBlockFrames ? audiodatalen : kBlockFrames;
+		PaError error = Pa_WriteStream(m_pStream, data, frames);
+
+		if (error != paNoError) return false;
+		data += frames * m_frameSize;
+		audiodatalen -= frames;
+		if (pWritten) *pWritten += frames;
+	}
+
+	return true;
 }
 
 void Audio::Stop()
 {
-	if (!m_pStream) return;
+	m_stopCount++;
+}
+
+void Audio::ApplyStop()
+{
+	const unsigned stopCount = m_stopCount;
+	if (!m_pStream || stopCount == m_appliedStopCount) return;
+	m_appliedStopCount = stopCount;
+
+	// Discards whatever is buffered; the next Write() starts the stream again.
 	Pa_AbortStream(m_pStream);
-	Pa_Sleep(100);
-	Pa_StartStream(m_pStream);
+}
+
+double Audio::GetOutputLatency()
+{
+	if (!m_pStream) return 0.0;
+	const PaStreamInfo* pInfo = Pa_GetStreamInfo(m_pStream);
+	return pInfo ? pInfo->outputLatency : 0.0;
 }
 #else
 // Stub implementations when PortAudio is disabled.
@@ -64,6 +106,8 @@ Audio::Audio() {}
 Audio::~Audio() {}
 bool Audio::Open(int, int, PaSampleFormat) { return false; }
 void Audio::Close() {}
-bool Audio::Write(const void*, unsigned long) { return false; }
+bool Audio::Write(const void*, unsigned long, unsigned long* pWritten) { if (pWritten) *pWritten = 0; return false; }
 void Audio::Stop() {}
+void Audio::ApplyStop() {}
+double Audio::GetOutputLatency() { return 0.0; }
 #endif
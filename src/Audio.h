@@ -5,6 +5,8 @@
 #pragma once
 
 #ifndef __NO_PORTAUDIO__
+#include <atomic>
+
 #include <portaudio.h>
 
 class Audio
@@ -16,11 +18,28 @@ public:
 	bool Open(int channels, int samplerate, PaSampleFormat sampleformat);
 	void Close();
 
-	bool Write(const void* audiodata, unsigned long audiodatalen);
+	// Returns false when interrupted by Stop(). pWritten receives the number of frames
+	// that were written until then.
+	bool Write(const void* audiodata, unsigned long audiodatalen, unsigned long* pWritten = nullptr);
+
+	// Makes a pending Write() return after its current block, and has the audio that the
+	// device buffered dropped. Only sets a flag, the device is stopped on the thread that
+	// writes, so this can be called from anywhere, e.g. a keyboard hook.
 	void Stop();
 
+	// Stops the device if Stop() was called since, for the thread that writes while no
+	// Write() is pending. Write() does so by itself.
+	void ApplyStop();
+
+	// Seconds of audio that the device buffers, which is what Stop() drops.
+	double GetOutputLatency();
+
 private:
 	PaStream* m_pStream;
+	unsigned long m_frameSize;
+
+	std::atomic<unsigned> m_stopCount;  // Incremented by Stop(), makes pending Write() calls return
+	unsigned m_appliedStopCount;        // Value of m_stopCount when the device was last stopped
 };
 #else
 // Stubbed Audio implementation when PortAudio is disabled.
@@ -32,7 +51,9 @@ public:
 
 	bool Open(int, int, int) { return false; }
 	void Close() {}
-	bool Write(const void*, unsigned long) { return false; }
+	bool Write(const void*, unsigned long, unsigned long* = nullptr) { return false; }
 	void Stop() {}
+	void ApplyStop() {}
+	double GetOutputLatency() { return 0.0; }
 };
 #endif
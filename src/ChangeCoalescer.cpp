@@ -0,0 +1,82 @@
+//
+// ChangeCoalescer.cpp
+//
+
+#include <algorithm>
+
+#include "ChangeCoalescer.h"
+
+ChangeCoalescer::ChangeCoalescer(std::chrono::milliseconds quietTime, std::chrono::milliseconds maxDelay, Callback callback)
+    : m_quietTime(quietTime), m_maxDelay(std::max(maxDelay, quietTime)), m_callback(std::move(callback)),
+      m_bPending(false), m_bStopped(false), m_notifyCount(0), m_callCount(0)
+{
+    m_thread = std::thread(&ChangeCoalescer::Run, this);
+}
+
+ChangeCoalescer::~ChangeCoalescer()
+{
+    Stop();
+}
+
+void ChangeCoalescer::Notify()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_bStopped) return;
+
+    m_lastNotify = std::chrono::steady_clock::now();
+    if (!m_bPending) {
+        m_bPending = true;
+        m_firstNotify = m_lastNotify;
+    }
+    m_notifyCount++;
+    m_condition.notify_one();
+}
+
+void ChangeCoalescer::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStopped = true;
+        m_bPending = false;
+        m_condition.notify_one();
+    }
+    if (m_thread.joinable()) m_thread.join();
+}
+
+unsigned long ChangeCoalescer::GetNotifyCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_notifyCount;
+}
+
+unsigned long ChangeCoalescer::GetCallCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_callCount;
+}
+
+void ChangeCoalescer::Run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_bStopped) {
+        if (!m_bPending) {
+            m_condition.wait(lock);
+            continue;
+        }
+
+        // Notifications that come in while waiting push the deadline back, up to maxDelay
+        const auto deadline = std::min(m_lastNotify + m_quietTime, m_firstNotify + m_maxDelay);
+        if (std::chrono::steady_clock::now() < deadline) {
+            m_condition.wait_until(lock, deadline);
+            continue;
+        }
+
+        // Notifications during the callback lead to another call, since the change they
+        // report may have been missed by it.
+        m_bPending = false;
+        m_callCount++;
+        lock.unlock();
+        m_callback();
+        lock.lock();
+    }
+}
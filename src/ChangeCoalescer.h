@@ -0,0 +1,53 @@
+//
+// ChangeCoalescer.h
+//
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Collapses bursts of change notifications into a single call. The callback is called on
+// a background thread once no notification has come in for the quiet time, or once the
+// oldest pending notification is maxDelay old, so that a burst that never calms down
+// still gets handled.
+class ChangeCoalescer
+{
+public:
+	typedef std::function<void()> Callback;
+
+	ChangeCoalescer(std::chrono::milliseconds quietTime, std::chrono::milliseconds maxDelay, Callback callback);
+	~ChangeCoalescer();
+
+	ChangeCoalescer(const ChangeCoalescer&) = delete;
+	ChangeCoalescer& operator=(const ChangeCoalescer&) = delete;
+
+	// May be called from any thread.
+	void Notify();
+
+	// Drops a pending call and waits for a running one to return. Called by the destructor.
+	void Stop();
+
+	unsigned long GetNotifyCount();
+	unsigned long GetCallCount();
+
+private:
+	const std::chrono::milliseconds m_quietTime;
+	const std::chrono::milliseconds m_maxDelay;
+	const Callback m_callback;
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_bPending;
+	bool m_bStopped;
+	std::chrono::steady_clock::time_point m_firstNotify;
+	std::chrono::steady_clock::time_point m_lastNotify;
+	unsigned long m_notifyCount;
+	unsigned long m_callCount;
+	std::thread m_thread;
+
+	void Run();
+};
@@ -18,6 +18,18 @@ static const wxString kWordsKey("/Dyscover/Words");
 static const wxString kSentencesKey("/Dyscover/Sentences");
 static const wxString kSelectionKey("/Dyscover/Selection");
 static const wxString kSpeedKey("/Dyscover/Speed");
+static const wxString kPitchKey("/Dyscover/Pitch");
+static const wxString kLetterRateKey("/Dyscover/LetterRate");
+static const wxString kWordRateKey("/Dyscover/WordRate");
+static const wxString kBargeInKey("/Dyscover/BargeIn");
+static const wxString kSynthesisInstancesKey("/Dyscover/SynthesisInstances");
+static const wxString kPreferQualityKey("/Dyscover/PreferQuality");
+static const wxString kVoicesKey("/Dyscover/Voices");
+static const wxString kVoiceMemoryBudgetKey("/Dyscover/VoiceMemoryBudget");
+static const wxString kIdleUnloadMinutesKey("/Dyscover/IdleUnloadMinutes");
+static const wxString kReplayMemoryBudgetKey("/Dyscover/ReplayMemoryBudget");
+static const wxString kReplayCountKey("/Dyscover/ReplayCount");
+static const wxString kReplayKeyKey("/Dyscover/ReplayKey");
 static const wxString kDemoStartedKey("/Dyscover/DemoStarted");
 static const wxString kDemoExpiredKey("/Dyscover/DemoExpired");
 
@@ -29,6 +41,18 @@ static constexpr bool kWordsDefaultValue = true;
 static constexpr bool kSentencesDefaultValue = true;
 static constexpr bool kSelectionDefaultValue = true;
 static constexpr long kSpeedDefaultValue = 0;
+static constexpr long kPitchDefaultValue = 0;
+static constexpr long kLetterRateDefaultValue = 100;
+static constexpr long kWordRateDefaultValue = 100;
+static constexpr bool kBargeInDefaultValue = false;
+static constexpr long kSynthesisInstancesDefaultValue = 0;
+static constexpr bool kPreferQualityDefaultValue = false;
+static const wxString kVoicesDefaultValue("");
+static constexpr long kVoiceMemoryBudgetDefaultValue = 64;
+static constexpr long kIdleUnloadMinutesDefaultValue = 10;
+static constexpr long kReplayMemoryBudgetDefaultValue = 2;
+static constexpr long kReplayCountDefaultValue = 5;
+static constexpr bool kReplayKeyDefaultValue = false;
 static const wxDateTime kDemoStartedDefaultValue;
 static constexpr bool kDemoExpiredDefaultValue = false;
 
@@ -55,26 +79,31 @@ Config::~Config()
 
 Layout Config::GetLayout()
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     return m_pConfig->ReadObject<Layout>(kLayoutKey, kLayoutDefaultValue);
 }
 
 void Config::SetLayout(Layout value)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_pConfig->Write(kLayoutKey, value);
 }
 
 bool Config::GetEnabled()
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     return m_pConfig->ReadBool(kEnabledKey, kEnabledDefaultValue);
 }
 
 void Config::SetEnabled(bool value)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_pConfig->Write(kEnabledKey, value);
 }
 
 bool Config::GetAutostart()
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
 #ifdef WIN32
     return m_pWindowsAutostartRegistryKey->HasValue(kWindowsRegistryAutostartKeyName);
 #else
@@ -84,6 +113,7 @@ bool Config::GetAutostart()
 
 void Config::SetAutostart(bool value)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
 #ifdef WIN32
     if (value)
     {
@@ -100,71 +130,229 @@ void Config::SetAutostart(bool value)
 
 bool Config::GetLetters()
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     return m_pConfig->ReadBool(kLettersKey, kLettersDefaultValue);
 }
 
 void Config::SetLetters(bool value)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_pConfig->Write(kLettersKey, value);
 }
 
 bool Config::GetWords()
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     return m_pConfig->ReadBool(kWordsKey, kWordsDefaultValue);
 }
 
 void Config::SetWords(bool value)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_pConfig->Write(kWordsKey, value);
 }
 
 bool Config::GetSentences()
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     return m_pConfig->ReadBool(kSentencesKey, kSentencesDefaultValue);
 }
 
 void Config::SetSentences(bool value)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_pConfig->Write(kSentencesKey, value);
 }
 
 bool Config::GetSelection()
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     return m_pConfig->ReadBool(kSelectionKey, kSelectionDefaultValue);
 }
 
 void Config::SetSelection(bool value)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_pConfig->Write(kSelectionKey, value);
 }
 
 long Config::GetSpeed()
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     return m_pConfig->ReadLong(kSpeedKey, kSpeedDefaultValue);
 }
 
 void Config::SetSpeed(long value)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_pConfig->Write(kSpeedKey, value);
 }
 
+long Config::GetPitch()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pConfig->ReadLong(kPitchKey, kPitchDefaultValue);
+}
+
+void Config::SetPitch(long value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pConfig->Write(kPitchKey, value);
+}
+
+long Config::GetLetterRate()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pConfig->ReadLong(kLetterRateKey, kLetterRateDefaultValue);
+}
+
+void Config::SetLetterRate(long value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pConfig->Write(kLetterRateKey, value);
+}
+
+long Config::GetWordRate()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pConfig->ReadLong(kWordRateKey, kWordRateDefaultValue);
+}
+
+void Config::SetWordRate(long value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pConfig->Write(kWordRateKey, value);
+}
+
+bool Config::GetBargeIn()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pConfig->ReadBool(kBargeInKey, kBargeInDefaultValue);
+}
+
+void Config::SetBargeIn(bool value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pConfig->Write(kBargeInKey, value);
+}
+
+long Config::GetSynthesisInstances()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pConfig->ReadLong(kSynthesisInstancesKey, kSynthesisInstancesDefaultValue);
+}
+
+void Config::SetSynthesisInstances(long value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pConfig->Write(kSynthesisInstancesKey, value);
+}
+
+bool Config::GetPreferQuality()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pConfig->ReadBool(kPreferQualityKey, kPreferQualityDefaultValue);
+}
+
+void Config::SetPreferQuality(bool value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pConfig->Write(kPreferQualityKey, value);
+}
+
+wxString Config::GetVoices()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pConfig->Read(kVoicesKey, kVoicesDefaultValue);
+}
+
+void Config::SetVoices(const wxString& value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pConfig->Write(kVoicesKey, value);
+}
+
+long Config::GetVoiceMemoryBudget()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pConfig->ReadLong(kVoiceMemoryBudgetKey, kVoiceMemoryBudgetDefaultValue);
+}
+
+void Config::SetVoiceMemoryBudget(long value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pConfig->Write(kVoiceMemoryBudgetKey, value);
+}
+
+long Config::GetIdleUnloadMinutes()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pConfig->ReadLong(kIdleUnloadMinutesKey, kIdleUnloadMinutesDefaultValue);
+}
+
+void Config::SetIdleUnloadMinutes(long value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pConfig->Write(kIdleUnloadMinutesKey, value);
+}
+
+long Config::GetReplayMemoryBudget()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pConfig->ReadLong(kReplayMemoryBudgetKey, kReplayMemoryBudgetDefaultValue);
+}
+
+void Config::SetReplayMemoryBudget(long value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pConfig->Write(kReplayMemoryBudgetKey, value);
+}
+
+long Config::GetReplayCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pConfig->ReadLong(kReplayCountKey, kReplayCountDefaultValue);
+}
+
+void Config::SetReplayCount(long value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pConfig->Write(kReplayCountKey, value);
+}
+
+bool Config::GetReplayKey()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pConfig->ReadBool(kReplayKeyKey, kReplayKeyDefaultValue);
+}
+
+void Config::SetReplayKey(bool value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pConfig->Write(kReplayKeyKey, value);
+}
+
 wxDateTime Config::GetDemoStarted()
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     return m_pConfig->ReadObject<wxDateTime>(kDemoStartedKey, kDemoStartedDefaultValue);
 }
 
 void Config::SetDemoStarted(wxDateTime value)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_pConfig->Write(kDemoStartedKey, value);
 }
 
 bool Config::GetDemoExpired()
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     return m_pConfig->ReadBool(kDemoExpiredKey, kDemoExpiredDefaultValue);
 }
 
 void Config::SetDemoExpired(bool value)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_pConfig->Write(kDemoExpiredKey, value);
 }
 
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <mutex>
+
 #include <wx/datetime.h>
 #include <wx/string.h>
 
@@ -55,6 +57,49 @@ public:
     long GetSpeed();
     void SetSpeed(long);
 
+    long GetPitch();
+    void SetPitch(long);
+
+    // Rate of letters and of words typed, in percent of the speed
+    long GetLetterRate();
+    void SetLetterRate(long);
+
+    long GetWordRate();
+    void SetWordRate(long);
+
+    bool GetBargeIn();
+    void SetBargeIn(bool);
+
+    long GetSynthesisInstances();
+    void SetSynthesisInstances(long);
+
+    bool GetPreferQuality();
+    void SetPreferQuality(bool);
+
+    // Comma separated language:voice pairs, e.g. "nl_be:Veerle"
+    wxString GetVoices();
+    void SetVoices(const wxString&);
+
+    // In megabytes
+    long GetVoiceMemoryBudget();
+    void SetVoiceMemoryBudget(long);
+
+    // Zero keeps the voices loaded
+    long GetIdleUnloadMinutes();
+    void SetIdleUnloadMinutes(long);
+
+    // Audio kept for replaying the last utterances, in megabytes
+    long GetReplayMemoryBudget();
+    void SetReplayMemoryBudget(long);
+
+    long GetReplayCount();
+    void SetReplayCount(long);
+
+    // Whether F12 replays the last utterances. The key then no longer reaches other
+    // applications.
+    bool GetReplayKey();
+    void SetReplayKey(bool);
+
     wxDateTime GetDemoStarted();
     void SetDemoStarted(wxDateTime);
 
@@ -62,6 +107,9 @@ public:
     void SetDemoExpired(bool);
 
 private:
+    // Settings are read on the input thread too, wxFileConfig is not thread-safe
+    std::mutex m_mutex;
+
     wxFileConfig* m_pConfig;
 #ifdef WIN32
     wxRegKey* m_pWindowsAutostartRegistryKey;
@@ -2,9 +2,12 @@
 // Core.cpp
 //
 
+#include <algorithm>
+
 #include <wx/clipbrd.h>
 #include <wx/log.h>
 #include <wx/time.h>
+#include <wx/tokenzr.h>
 
 #include "App.h"
 #include "Config.h"
@@ -15,27 +18,73 @@
 #include "Speech.h"
 #include "VersionInfo.h"
 
+// Plays the last utterance again, pressing it again goes further back. Only when enabled
+// in the configuration, as it is taken from all applications.
+static const Key kReplayKey = Key::F12;
+
 Core::Core(App* pApp, Config* pConfig, Device* pDevice)
 {
     m_pApp = pApp;
     m_pConfig = pConfig;
-    m_pKeyboard = Keyboard::Create(this);
     m_pSoundPlayer = new SoundPlayer();
     m_pSpeech = new Speech();
-    m_pSpeech->Init(GetTTSDataPath(), TTS_LANG, TTS_VOICE);
+    m_pSpeech->SetTimingsListener([pApp](const SpeechTimings& timings) {
+        pApp->CallAfter([timings]() {
+            wxLogDebug("Core::Core()  speech init = %ld ms, warm-up = %ld ms, first utterance = %ld ms",
+                static_cast<long>(timings.init.count()), static_cast<long>(timings.warmUp.count()), static_cast<long>(timings.firstUtterance.count()));
+        });
+    });
+    m_pSpeech->SetQualityPolicy(m_pConfig->GetPreferQuality() ? QualityPolicy::Quality : QualityPolicy::Latency);
+    m_pSpeech->SetQualityListener([pApp](const QualityDecision& decision) {
+        pApp->CallAfter([decision]() {
+            wxLogDebug("Core::Core()  speech quality level = %lu (quality = %d, responsiveness = %d) at real-time factor %.2f",
+                static_cast<unsigned long>(decision.level), decision.quality, decision.responsiveness, decision.realTimeFactor);
+        });
+    });
+    wxStringTokenizer voices(m_pConfig->GetVoices(), ",");
+    while (voices.HasMoreTokens())
+    {
+        wxString voice = voices.GetNextToken().Trim().Trim(false);
+        wxString lang = voice.BeforeFirst(':');
+        if (!voice.Contains(":") || lang.IsEmpty())
+        {
+            wxLogDebug("Core::Core()  ignoring voice \"%s\", expected language:voice", voice);
+            continue;
+        }
+        m_pSpeech->AddVoice(lang.ToStdString(), voice.AfterFirst(':').ToStdString());
+    }
+    m_pSpeech->SetVoiceMemoryBudget(static_cast<size_t>(std::max(0L, m_pConfig->GetVoiceMemoryBudget())) * 1024 * 1024);
+    m_pSpeech->SetIdleTimeout(std::chrono::minutes(std::max(0L, m_pConfig->GetIdleUnloadMinutes())));
+    m_pSpeech->SetReplayLimits(static_cast<size_t>(std::max(0L, m_pConfig->GetReplayMemoryBudget())) * 1024 * 1024,
+        static_cast<size_t>(std::max(0L, m_pConfig->GetReplayCount())));
+    m_replayBack = 0;
+    m_pSpeech->InitAsync(GetTTSDataPath(), TTS_LANG, TTS_VOICE, static_cast<size_t>(std::max(0L, m_pConfig->GetSynthesisInstances())));
     m_pSpeech->SetVolume(RSTTS_VOLUME_MAX);
+    OnSpeechSettingsChanged();
+    m_pSpeech->SetBargeIn(m_pConfig->GetBargeIn());
 
     m_bKeyboardConnected = pDevice != nullptr ? pDevice->IsClevyKeyboardPresent() : false;
+
+    // Last, as this starts the input thread, which calls into everything above
+    m_pKeyboard = Keyboard::Create(this);
 }
 
 Core::~Core()
 {
+    // Stops the input thread, which calls into everything else
+    delete m_pKeyboard;
+
+    SpeechSchedulerStats stats = m_pSpeech->GetStats();
+    wxLogDebug("Core::~Core()  speech dispatched = %lu, superseded = %lu, overflowed = %lu, cancelled = %lu, max latency = %ld ms",
+        stats.dispatched, stats.superseded, stats.overflowed, stats.cancelled, static_cast<long>(stats.maxLatency.count()));
+
     m_pSpeech->Term();
     delete m_pSpeech;
     delete m_pSoundPlayer;
-    delete m_pKeyboard;
 }
 
+// Called on the input thread. Whatever needs the main thread is queued to it, so that the
+// keystroke is not held up by it.
 bool Core::OnKeyEvent(Key key, KeyEventType eventType, bool capsLock, bool shift, bool ctrl, bool alt)
 {
 #ifdef __LICENSING_FULL__
@@ -44,28 +93,91 @@ bool Core::OnKeyEvent(Key key, KeyEventType eventType, bool capsLock, bool shift
 
     if (!m_pConfig->GetEnabled())  return false;
 
+    // Reload the voice ahead of the utterance this key may cause
+    if (eventType == KeyEventType::KeyDown)
+    {
+        m_pSpeech->Wake();
+    }
+
     if (key == Key::WinCmd && eventType == KeyEventType::KeyDown && m_pConfig->GetSelection())
     {
+        // Pressing the key again while a selection is read pauses or resumes reading
+        if (m_pSpeech->IsPaused())
+        {
+            m_pSpeech->Resume();
+            return true;
+        }
+        if (m_pSpeech->IsReadingSelection())
+        {
+            m_pSpeech->Pause();
+            return true;
+        }
+
         // Send Ctrl+C
         m_pKeyboard->SendKeyStroke(Key::C, false, true, false);
 
-        // Wait a while
-        wxMilliSleep(25);
+        // The clipboard can only be used on the main thread
+        m_pApp->CallAfter([this]() {
+            // Wait a while
+            wxMilliSleep(25);
 
-        // Read text from clipboard and pronounce it
-        if (wxTheClipboard->Open())
-        {
-            if (wxTheClipboard->IsSupported(wxDF_TEXT))
+            // Read text from clipboard and pronounce it
+            if (wxTheClipboard->Open())
             {
-                wxTextDataObject tdo;
-                wxTheClipboard->GetData(tdo);
-                wxString s = tdo.GetText();
+                if (wxTheClipboard->IsSupported(wxDF_TEXT))
+                {
+                    wxTextDataObject tdo;
+                    wxTheClipboard->GetData(tdo);
+                    wxString s = tdo.GetText();
+
+                    m_pSpeech->Speak(s.ToStdString(), SpeechClass::Selection);
+                }
 
-                m_pSpeech->SetSpeed(static_cast<float>(m_pConfig->GetSpeed()));
-                m_pSpeech->Speak(s.ToStdString());
+                wxTheClipboard->Close();
             }
+        });
 
-            wxTheClipboard->Close();
+        // Supress this event
+        return true;
+    }
+
+    if (key == kReplayKey && m_pConfig->GetReplayKey())
+    {
+        if (eventType == KeyEventType::KeyDown)
+        {
+            if (m_pSpeech->Replay(m_replayBack))
+            {
+                m_replayBack++;
+            }
+            else if (m_replayBack > 0 && m_pSpeech->Replay(0))
+            {
+                // Went past the oldest one, start over
+                m_replayBack = 1;
+            }
+        }
+
+        // Supress this event
+        return true;
+    }
+
+    if (eventType == KeyEventType::KeyDown)
+    {
+        m_replayBack = 0;
+    }
+
+    // While a selection is read, Left repeats the current sentence and Right skips to the next one
+    if ((key == Key::Left || key == Key::Right) && !shift && !ctrl && !alt && m_pSpeech->IsReadingSelection())
+    {
+        if (eventType == KeyEventType::KeyDown)
+        {
+            if (key == Key::Left)
+            {
+                m_pSpeech->RepeatSentence();
+            }
+            else
+            {
+                m_pSpeech->SkipSentence();
+            }
         }
 
         // Supress this event
@@ -88,8 +200,11 @@ bool Core::OnKeyEvent(Key key, KeyEventType eventType, bool capsLock, bool shift
     {
         if (m_pConfig->GetLetters())
         {
-            m_pSoundPlayer->StopPlaying();
-            m_pSoundPlayer->PlaySoundFile(translation.sound);
+            std::string sound = translation.sound;
+            m_pApp->CallAfter([this, sound]() {
+                m_pSoundPlayer->StopPlaying();
+                m_pSoundPlayer->PlaySoundFile(sound);
+            });
         }
     }
 
@@ -98,55 +213,46 @@ bool Core::OnKeyEvent(Key key, KeyEventType eventType, bool capsLock, bool shift
     {
         if (key == Key::Tab || key == Key::Space || key == Key::Enter)
         {
-            if (!m_wordSpeechBuffer.empty() && m_pConfig->GetWords())
+            std::string word = m_speechBuffer.GetWordBeforeCursor();
+            if (!word.empty() && m_pConfig->GetWords())
             {
-                m_pSpeech->SetSpeed(static_cast<float>(m_pConfig->GetSpeed()));
-                m_pSpeech->Speak(m_wordSpeechBuffer);
+                m_pSpeech->Speak(word, SpeechClass::Word);
             }
 
-            m_wordSpeechBuffer.clear();
-            m_sentenceSpeechBuffer.push_back(' ');
+            m_speechBuffer.Insert(" ");
+
+            if (m_pConfig->GetSentences())
+            {
+                m_pSpeech->Prepare(m_speechBuffer.GetText());
+            }
         }
         else if (translation.speak_sentence)
         {
-            m_pSpeech->SetSpeed(static_cast<float>(m_pConfig->GetSpeed()));
-
-            if (!m_wordSpeechBuffer.empty() && m_pConfig->GetWords())
+            std::string word = m_speechBuffer.GetWordBeforeCursor();
+            if (!word.empty() && m_pConfig->GetWords())
             {
-                m_pSpeech->Speak(m_wordSpeechBuffer);
+                m_pSpeech->Speak(word, SpeechClass::Word);
             }
 
-            if (!m_sentenceSpeechBuffer.empty() && m_pConfig->GetSentences())
+            if (!m_speechBuffer.IsEmpty() && m_pConfig->GetSentences())
             {
-                m_pSpeech->Speak(m_sentenceSpeechBuffer);
+                m_pSpeech->SpeakPrepared(m_speechBuffer.GetText());
             }
 
-            m_wordSpeechBuffer.clear();
-            m_sentenceSpeechBuffer.clear();
+            m_speechBuffer.Clear();
         }
         else if (key == Key::Esc)
         {
             m_pSpeech->Stop();
         }
-        else if (key == Key::Backspace)
-        {
-            if (!m_wordSpeechBuffer.empty())
-            {
-                m_wordSpeechBuffer.pop_back();
-            }
-
-            if (!m_sentenceSpeechBuffer.empty())
-            {
-                m_sentenceSpeechBuffer.pop_back();
-            }
-        }
         else
         {
             for (KeyStroke ks : translation.keystrokes)
             {
-                std::string chars = m_pKeyboard->TranslateKeyStroke(ks.key, ks.shift, ks.ctrl);
-                m_wordSpeechBuffer.append(chars);
-                m_sentenceSpeechBuffer.append(chars);
+                if (!EditSpeechBuffer(ks))
+                {
+                    m_speechBuffer.Insert(m_pKeyboard->TranslateKeyStroke(ks.key, ks.shift, ks.ctrl));
+                }
             }
         }
     }
@@ -168,3 +274,90 @@ void Core::OnClevyKeyboardDisconnected()
 
     m_bKeyboardConnected = false;
 }
+
+// Keyboards that are connected at startup are found by the first scan, without a sound.
+void Core::OnClevyKeyboardPresenceKnown(bool bPresent)
+{
+    m_bKeyboardConnected = bPresent;
+}
+
+// Applies the keys that move the cursor or delete text to the speech buffer. Returns
+// false for other keys. Jumps that cannot be followed, such as to another line, start
+// over with an empty buffer.
+bool Core::EditSpeechBuffer(const KeyStroke& ks)
+{
+    bool deleted = false;
+
+    switch (ks.key)
+    {
+    case Key::Backspace:
+    case Key::Del:
+        if (ks.ctrl || ks.alt)
+        {
+            m_speechBuffer.Clear();
+            deleted = true;
+        }
+        else if (ks.key == Key::Backspace)
+        {
+            deleted = m_speechBuffer.Backspace();
+        }
+        else
+        {
+            deleted = m_speechBuffer.Delete();
+        }
+        break;
+    case Key::Left:
+    case Key::Right:
+    case Key::Home:
+    case Key::End:
+        if (ks.ctrl || ks.alt)
+        {
+            m_speechBuffer.Clear();
+        }
+        else if (ks.key == Key::Left)
+        {
+            m_speechBuffer.MoveLeft();
+        }
+        else if (ks.key == Key::Right)
+        {
+            m_speechBuffer.MoveRight();
+        }
+        else if (ks.key == Key::Home)
+        {
+            m_speechBuffer.Home();
+        }
+        else
+        {
+            m_speechBuffer.End();
+        }
+        break;
+    case Key::Up:
+    case Key::Down:
+    case Key::PageUp:
+    case Key::PageDown:
+        m_speechBuffer.Clear();
+        break;
+    default:
+        return false;
+    }
+
+    if (deleted && m_pConfig->GetSentences())
+    {
+        m_pSpeech->Prepare(m_speechBuffer.GetText());
+    }
+
+    return true;
+}
+
+void Core::OnSpeechSettingsChanged()
+{
+    m_pSpeech->SetSpeed(static_cast<float>(m_pConfig->GetSpeed()));
+    m_pSpeech->SetPitch(static_cast<float>(m_pConfig->GetPitch()));
+
+    SsmlProsody letter;
+    letter.rate = static_cast<int>(std::max(1L, m_pConfig->GetLetterRate()));
+    m_pSpeech->SetProsody(SpeechClass::Letter, letter);
+    SsmlProsody word;
+    word.rate = static_cast<int>(std::max(1L, m_pConfig->GetWordRate()));
+    m_pSpeech->SetProsody(SpeechClass::Word, word);
+}
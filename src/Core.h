@@ -4,7 +4,10 @@
 
 #pragma once
 
+#include <atomic>
+
 #include "Keyboard.h"
+#include "TextModel.h"
 
 class App;
 class Config;
@@ -21,16 +24,26 @@ public:
 
     void OnClevyKeyboardConnected();
     void OnClevyKeyboardDisconnected();
+    void OnClevyKeyboardPresenceKnown(bool bPresent);
+
+    // Passes the speech settings in Config on to the engine
+    void OnSpeechSettingsChanged();
 
 private:
+    bool EditSpeechBuffer(const KeyStroke&);
+
     App* m_pApp;
     Config* m_pConfig;
     Keyboard* m_pKeyboard;
     SoundPlayer* m_pSoundPlayer;
     Speech* m_pSpeech;
 
-    std::string m_wordSpeechBuffer;
-    std::string m_sentenceSpeechBuffer;
+    // The sentence being typed, the word before the cursor is spoken when it is completed
+    TextModel m_speechBuffer;
+
+    // How far back the next replay goes, counted in utterances
+    size_t m_replayBack;
 
-    bool m_bKeyboardConnected;
+    // Set on the main thread, read on the input thread
+    std::atomic<bool> m_bKeyboardConnected;
 };
@@ -14,6 +14,10 @@
 
 // Removed runtime JSON configuration; device list is now compile-time.
 
+// Docking a laptop reports dozens of changes within a second.
+static const std::chrono::milliseconds kRescanQuietTime(250);
+static const std::chrono::milliseconds kRescanMaxDelay(2000);
+
 Device* Device::Create(IDeviceListener* pListener)
 {
 #ifdef WIN32
@@ -24,35 +28,180 @@ Device* Device::Create(IDeviceListener* pListener)
 }
 
 Device::Device(IDeviceListener* pListener)
+    : m_eventSequence(0), m_bScanRequested(false), m_bScanCancelled(false),
+      m_rescanCoalescer(kRescanQuietTime, kRescanMaxDelay, [this]() { RescanClevyKeyboards(); })
 {
     m_pListener = pListener;
 
-    m_bIsClevyKeyboardPresent = false;
+    m_changeVersion = 0;
+    m_bPresenceKnown = false;
+
+    m_eventHandler.Bind(wxEVT_THREAD, &Device::OnScanDone, this);
 }
 
 Device::~Device()
 {
+    CancelScan();
+}
+
+bool Device::IsClevyKeyboardPresent() const
+{
+    return !m_clevyKeyboards.empty();
+}
+
+bool Device::IsClevyKeyboardPresenceKnown() const
+{
+    return m_bPresenceKnown;
+}
+
+unsigned long Device::GetChangeVersion() const
+{
+    return m_changeVersion;
+}
+
+std::vector<std::string> Device::GetClevyKeyboards() const
+{
+    return std::vector<std::string>(m_clevyKeyboards.begin(), m_clevyKeyboards.end());
 }
 
 void Device::InitClevyKeyboardPresence()
 {
-    m_bIsClevyKeyboardPresent = IsClevyKeyboardPresent();
+    m_bScanRequested = true;
+    m_scanThread = std::thread(&Device::RunScans, this);
+}
 
-    wxLogDebug("Device::InitClevyKeyboardPresence()  presence = %d", m_bIsClevyKeyboardPresent);
+void Device::CancelScan()
+{
+    m_rescanCoalescer.Stop();
+    {
+        std::lock_guard<std::mutex> lock(m_scanMutex);
+        m_bScanCancelled = true;
+        m_scanCondition.notify_one();
+    }
+    if (m_scanThread.joinable())
+    {
+        m_scanThread.join();
+    }
 }
 
-void Device::RefreshClevyKeyboardPresence()
+bool Device::IsScanCancelled() const
+{
+    return m_bScanCancelled;
+}
+
+void Device::RescanClevyKeyboards()
+{
+    std::lock_guard<std::mutex> lock(m_scanMutex);
+    m_bScanRequested = true;
+    m_scanCondition.notify_one();
+}
+
+void Device::ScheduleRescan()
+{
+    m_rescanCoalescer.Notify();
+}
+
+void Device::RunScans()
+{
+    std::unique_lock<std::mutex> lock(m_scanMutex);
+    while (true)
+    {
+        m_scanCondition.wait(lock, [this]() { return m_bScanRequested || m_bScanCancelled; });
+        if (m_bScanCancelled)
+        {
+            return;
+        }
+        m_bScanRequested = false;
+        lock.unlock();
+
+        ScanResult result;
+        result.sequence = m_eventSequence;
+        ScanClevyKeyboards(result.keyboards);
+
+        lock.lock();
+        if (m_bScanCancelled)
+        {
+            return;
+        }
+        wxThreadEvent* pEvent = new wxThreadEvent(wxEVT_THREAD);
+        pEvent->SetPayload(result);
+        wxQueueEvent(&m_eventHandler, pEvent);
+    }
+}
+
+void Device::OnScanDone(wxThreadEvent& event)
+{
+    ScanResult result = event.GetPayload<ScanResult>();
+
+    // A hotplug event that came in during the scan may or may not be in its result, but
+    // is applied already. Another scan settles it.
+    if (result.sequence != m_eventSequence)
+    {
+        wxLogDebug("Device::OnScanDone()  devices changed during the scan");
+        RescanClevyKeyboards();
+        return;
+    }
+
+    if (!m_bPresenceKnown)
+    {
+        m_clevyKeyboards.swap(result.keyboards);
+        m_changeVersion++;
+        m_bPresenceKnown = true;
+
+        wxLogDebug("Device::OnScanDone()  presence = %d", IsClevyKeyboardPresent());
+        for (const std::string& id : m_clevyKeyboards)
+        {
+            wxLogDebug("Device::OnScanDone()  %s", id);
+        }
+        m_pListener->OnClevyKeyboardPresenceKnown();
+        return;
+    }
+
+    if (result.keyboards == m_clevyKeyboards)
+    {
+        return;
+    }
+
+    const bool bWasPresent = IsClevyKeyboardPresent();
+    m_clevyKeyboards.swap(result.keyboards);
+    OnClevyKeyboardsChanged(bWasPresent);
+}
+
+void Device::AddClevyKeyboard(const std::string& id)
+{
+    const bool bWasPresent = IsClevyKeyboardPresent();
+    if (m_clevyKeyboards.insert(id).second)
+    {
+        m_eventSequence++;
+        wxLogDebug("Device::AddClevyKeyboard()  %s", id);
+        OnClevyKeyboardsChanged(bWasPresent);
+    }
+}
+
+void Device::RemoveClevyKeyboard(const std::string& id)
+{
+    const bool bWasPresent = IsClevyKeyboardPresent();
+    if (m_clevyKeyboards.erase(id) > 0)
+    {
+        m_eventSequence++;
+        wxLogDebug("Device::RemoveClevyKeyboard()  %s", id);
+        OnClevyKeyboardsChanged(bWasPresent);
+    }
+}
+
+void Device::OnClevyKeyboardsChanged(bool bWasPresent)
 {
     // TODO: Move this logic to Core.
-    bool bIsClevyKeyboardPresent = IsClevyKeyboardPresent();
-    wxLogDebug("Device::RefreshClevyKeyboardPresence()  presence = %d -> %d", m_bIsClevyKeyboardPresent, bIsClevyKeyboardPresent);
-    if (bIsClevyKeyboardPresent && !m_bIsClevyKeyboardPresent)
+    m_changeVersion++;
+
+    bool bIsPresent = IsClevyKeyboardPresent();
+    wxLogDebug("Device::OnClevyKeyboardsChanged()  presence = %d -> %d, %lu keyboard(s)", bWasPresent, bIsPresent, static_cast<unsigned long>(m_clevyKeyboards.size()));
+    if (bIsPresent && !bWasPresent)
     {
         m_pListener->OnClevyKeyboardConnected();
     }
-    else if (!bIsClevyKeyboardPresent && m_bIsClevyKeyboardPresent)
+    else if (!bIsPresent && bWasPresent)
     {
         m_pListener->OnClevyKeyboardDisconnected();
     }
-    m_bIsClevyKeyboardPresent = bIsClevyKeyboardPresent;
 }
@@ -4,15 +4,37 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <wx/event.h>
+
+#include "ChangeCoalescer.h"
 #include "SupportedDevices.h"
 
+// Called on the main thread.
 class IDeviceListener
 {
 public:
     virtual void OnClevyKeyboardConnected() = 0;
     virtual void OnClevyKeyboardDisconnected() = 0;
+
+    // The first scan has finished. Keyboards that were already connected do not get
+    // OnClevyKeyboardConnected().
+    virtual void OnClevyKeyboardPresenceKnown() = 0;
 };
 
+// Keeps the set of connected Clevy Keyboards, keyed by a platform specific device id.
+// The platforms enumerate the devices once and then keep the set up to date from hotplug
+// events, so that the queries below are cheap enough to call from the UI at any time.
+// Enumerations run on a worker thread and their results are applied on the main thread,
+// so a slow hub or Bluetooth stack does not hold up the UI. Until the first one has
+// finished, no keyboard is present.
 class Device
 {
 public:
@@ -21,16 +43,72 @@ public:
     Device(IDeviceListener*);
     virtual ~Device();
 
-    virtual bool IsClevyKeyboardPresent() = 0;
+    bool IsClevyKeyboardPresent() const;
+    bool IsClevyKeyboardPresenceKnown() const;
+
+    // Incremented whenever a keyboard is added or removed.
+    unsigned long GetChangeVersion() const;
+
+    // Ids of the connected keyboards, for diagnostics.
+    std::vector<std::string> GetClevyKeyboards() const;
 
 protected:
+    // Full enumeration of the connected keyboards. Called on the worker thread, so it must
+    // not use state that the main thread uses without locking. Should return early once
+    // IsScanCancelled().
+    virtual void ScanClevyKeyboards(std::set<std::string>& keyboards) = 0;
+
+    // Starts the worker with the first scan. Called by the platforms once they are set up.
     void InitClevyKeyboardPresence();
-    void RefreshClevyKeyboardPresence();
+
+    // Stops the worker, cancelling a running scan. Must be called first thing in the
+    // destructors of the platforms, since the worker calls ScanClevyKeyboards().
+    void CancelScan();
+    bool IsScanCancelled() const;
+
+    // For changes that do not say which device they are about. Starts a scan on the
+    // worker; the scans requested while one is running result in a single one after it.
+    // May be called from any thread.
+    void RescanClevyKeyboards();
+
+    // Like RescanClevyKeyboards(), but a burst of calls results in a single rescan once
+    // the changes have calmed down. May be called from any thread.
+    void ScheduleRescan();
+
+    void AddClevyKeyboard(const std::string& id);
+    void RemoveClevyKeyboard(const std::string& id);
 
     // Removed DeviceConfig; compile-time list in SupportedDevices.h
 
 private:
+    struct ScanResult
+    {
+        std::set<std::string> keyboards;
+        unsigned long sequence;
+    };
+
     IDeviceListener* m_pListener;
 
-    bool m_bIsClevyKeyboardPresent;
+    std::set<std::string> m_clevyKeyboards;
+    unsigned long m_changeVersion;
+    bool m_bPresenceKnown;
+
+    // Counts the changes from hotplug events, so that scans that ran while one came in
+    // can be told apart.
+    std::atomic<unsigned long> m_eventSequence;
+
+    std::mutex m_scanMutex;
+    std::condition_variable m_scanCondition;
+    bool m_bScanRequested;
+    std::atomic<bool> m_bScanCancelled;
+    std::thread m_scanThread;
+
+    // Declared after the above, so that the coalescer is stopped before what it uses
+    // goes away.
+    wxEvtHandler m_eventHandler;
+    ChangeCoalescer m_rescanCoalescer;
+
+    void RunScans();
+    void OnScanDone(wxThreadEvent& event);
+    void OnClevyKeyboardsChanged(bool bWasPresent);
 };
@@ -0,0 +1,99 @@
+//
+// DeviceEnumerator.cpp
+//
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "DeviceEnumerator.h"
+#include "SupportedDevices.h"
+
+// Reads the ids from the PRODUCT property of a device, "vendor/product/version" for USB
+// devices and "bus/vendor/product/version" for input devices, in hex without padding.
+// pBus receives the bus of an input device.
+static bool ParseProduct(const char* product, bool hasBus, uint32_t& id, uint16_t* pBus = nullptr)
+{
+    if (!product) {
+        return false;
+    }
+
+    std::string_view fields[4];
+    size_t count = 0;
+    const char* begin = product;
+    for (const char* p = product; count < 4; p++) {
+        if (*p == '/' || *p == '\0') {
+            fields[count++] = std::string_view(begin, p - begin);
+            begin = p + 1;
+        }
+        if (*p == '\0') {
+            break;
+        }
+    }
+
+    const size_t first = hasBus ? 1 : 0;
+    uint16_t vid, pid;
+    if (count < first + 2 || fields[first].empty() || fields[first + 1].empty() ||
+        !ParseHex4(fields[first], vid) || !ParseHex4(fields[first + 1], pid)) {
+        return false;
+    }
+    if (hasBus && pBus && (fields[0].empty() || !ParseHex4(fields[0], *pBus))) {
+        return false;
+    }
+    id = MakeDeviceId(vid, pid);
+    return true;
+}
+
+bool IsClevyKeyboard(const DeviceEntry& entry)
+{
+    if (!entry.subsystem) {
+        return false;
+    }
+
+    uint32_t id;
+    if (strcmp(entry.subsystem, "usb") == 0) {
+        if (!entry.devtype || strcmp(entry.devtype, "usb_device") != 0) {
+            return false;
+        }
+        if (entry.vendorId && entry.productId) {
+            return IsSupported(entry.vendorId, entry.productId);
+        }
+        return ParseProduct(entry.product, false, id) && IsSupportedId(DeviceBus::Usb, id);
+    }
+
+    uint16_t bus;
+    if (strcmp(entry.subsystem, "input") == 0) {
+        return ParseProduct(entry.product, true, id, &bus) &&
+            IsSupportedInputDevice(bus, static_cast<uint16_t>(id >> 16), static_cast<uint16_t>(id));
+    }
+
+    return false;
+}
+
+void ScanClevyKeyboards(DeviceEnumerator& enumerator, std::set<std::string>& keyboards, const std::function<bool()>& isCancelled)
+{
+    enumerator.Scan([&](const DeviceEntry& entry) {
+        if (isCancelled()) {
+            return false;
+        }
+        if (entry.path && IsClevyKeyboard(entry)) {
+            keyboards.insert(entry.path);
+        }
+        return true;
+    });
+}
+
+void ReceiveClevyKeyboardEvents(DeviceEnumerator& enumerator, const std::function<void(const std::string& path, bool bAdded)>& onChange)
+{
+    enumerator.ReceiveEvents([&](DeviceAction action, const DeviceEntry& entry) {
+        if (!entry.path) {
+            return;
+        }
+        if (action == DeviceAction::Remove) {
+            onChange(entry.path, false);
+        }
+        else if (IsClevyKeyboard(entry)) {
+            onChange(entry.path, true);
+        }
+    });
+}
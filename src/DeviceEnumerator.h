@@ -0,0 +1,62 @@
+//
+// DeviceEnumerator.h
+//
+
+#pragma once
+
+#include <functional>
+#include <set>
+#include <string>
+
+// The attributes of a device that keyboards are recognized by. The strings are only valid
+// during the call that passes the entry, and may be null.
+struct DeviceEntry
+{
+	const char* path;       // Sys path, the key of the device
+	const char* subsystem;  // "usb" or "input"
+	const char* devtype;    // "usb_device" for USB devices
+	const char* vendorId;   // idVendor of USB devices
+	const char* productId;  // idProduct of USB devices
+	const char* product;    // PRODUCT property, "vendor/product/version" or "bus/vendor/product/version"
+};
+
+enum class DeviceAction
+{
+	Add,
+	Remove,
+	Change,
+};
+
+// Lists the devices in the usb and input subsystems and reports their hotplug events,
+// so that keyboard detection does not depend on a particular device library.
+class DeviceEnumerator
+{
+public:
+	// Returns false to stop the scan.
+	typedef std::function<bool(const DeviceEntry&)> Visitor;
+	typedef std::function<void(DeviceAction, const DeviceEntry&)> EventVisitor;
+
+	virtual ~DeviceEnumerator() {}
+
+	// May be called from any thread, also while events are being received on another.
+	virtual void Scan(const Visitor& visitor) = 0;
+
+	// Starts listening for hotplug events. Returns false if they are not available.
+	virtual bool StartMonitor() = 0;
+
+	// Becomes readable when events are pending, -1 without a monitor.
+	virtual int GetMonitorFd() const = 0;
+
+	// Passes the hotplug events that are pending, without blocking.
+	virtual void ReceiveEvents(const EventVisitor& visitor) = 0;
+};
+
+bool IsClevyKeyboard(const DeviceEntry& entry);
+
+// Full enumeration of the connected keyboards, keyed by sys path. isCancelled is checked
+// between devices.
+void ScanClevyKeyboards(DeviceEnumerator& enumerator, std::set<std::string>& keyboards, const std::function<bool()>& isCancelled);
+
+// Passes the keyboards that the pending hotplug events add or remove. Removed devices
+// have no attributes left to recognize them by, so every removal is passed on.
+void ReceiveClevyKeyboardEvents(DeviceEnumerator& enumerator, const std::function<void(const std::string& path, bool bAdded)>& onChange);
@@ -0,0 +1,124 @@
+//
+// DeviceEnumeratorUdev.cpp
+//
+
+#include <cstring>
+
+#include <libudev.h>
+
+#include "DeviceEnumeratorUdev.h"
+
+static DeviceEntry ToEntry(struct udev_device* dev)
+{
+    DeviceEntry entry = {};
+    entry.path = udev_device_get_syspath(dev);
+    entry.subsystem = udev_device_get_subsystem(dev);
+    entry.devtype = udev_device_get_devtype(dev);
+    entry.product = udev_device_get_property_value(dev, "PRODUCT");
+
+    // Reading sysattrs goes to sysfs, so only for the devices that have these
+    if (entry.subsystem && entry.devtype && strcmp(entry.subsystem, "usb") == 0 && strcmp(entry.devtype, "usb_device") == 0) {
+        entry.vendorId = udev_device_get_sysattr_value(dev, "idVendor");
+        entry.productId = udev_device_get_sysattr_value(dev, "idProduct");
+    }
+    return entry;
+}
+
+DeviceEnumeratorUdev::DeviceEnumeratorUdev()
+    : m_pUdev(udev_new()), m_pMonitor(nullptr)
+{
+}
+
+DeviceEnumeratorUdev::~DeviceEnumeratorUdev()
+{
+    if (m_pMonitor) {
+        udev_monitor_unref(m_pMonitor);
+    }
+    if (m_pUdev) {
+        udev_unref(m_pUdev);
+    }
+}
+
+void DeviceEnumeratorUdev::Scan(const Visitor& visitor)
+{
+    struct udev* udev = udev_new();
+    if (!udev) {
+        return;
+    }
+
+    struct udev_enumerate* enumerate = udev_enumerate_new(udev);
+    if (!enumerate) {
+        udev_unref(udev);
+        return;
+    }
+
+    udev_enumerate_add_match_subsystem(enumerate, "usb");
+    udev_enumerate_add_match_subsystem(enumerate, "input");
+    udev_enumerate_scan_devices(enumerate);
+
+    struct udev_list_entry* devices = udev_enumerate_get_list_entry(enumerate);
+    struct udev_list_entry* entry;
+
+    udev_list_entry_foreach(entry, devices) {
+        struct udev_device* dev = udev_device_new_from_syspath(udev, udev_list_entry_get_name(entry));
+        if (dev) {
+            const bool bContinue = visitor(ToEntry(dev));
+            udev_device_unref(dev);
+            if (!bContinue) {
+                break;
+            }
+        }
+    }
+
+    udev_enumerate_unref(enumerate);
+    udev_unref(udev);
+}
+
+bool DeviceEnumeratorUdev::StartMonitor()
+{
+    if (!m_pUdev) {
+        return false;
+    }
+
+    m_pMonitor = udev_monitor_new_from_netlink(m_pUdev, "udev");
+    if (!m_pMonitor) {
+        return false;
+    }
+
+    udev_monitor_filter_add_match_subsystem_devtype(m_pMonitor, "usb", "usb_device");
+    udev_monitor_filter_add_match_subsystem_devtype(m_pMonitor, "input", nullptr);
+    if (udev_monitor_enable_receiving(m_pMonitor) < 0) {
+        udev_monitor_unref(m_pMonitor);
+        m_pMonitor = nullptr;
+        return false;
+    }
+    return true;
+}
+
+int DeviceEnumeratorUdev::GetMonitorFd() const
+{
+    return m_pMonitor ? udev_monitor_get_fd(m_pMonitor) : -1;
+}
+
+void DeviceEnumeratorUdev::ReceiveEvents(const EventVisitor& visitor)
+{
+    if (!m_pMonitor) {
+        return;
+    }
+
+    while (struct udev_device* dev = udev_monitor_receive_device(m_pMonitor)) {
+        const char* action = udev_device_get_action(dev);
+        if (action) {
+            if (strcmp(action, "remove") == 0) {
+                visitor(DeviceAction::Remove, ToEntry(dev));
+            }
+            else if (strcmp(action, "add") == 0) {
+                visitor(DeviceAction::Add, ToEntry(dev));
+            }
+            else {
+                visitor(DeviceAction::Change, ToEntry(dev));
+            }
+        }
+        udev_device_unref(dev);
+    }
+}
@@ -0,0 +1,28 @@
+//
+// DeviceEnumeratorUdev.h
+//
+
+#pragma once
+
+#include "DeviceEnumerator.h"
+
+struct udev;
+struct udev_monitor;
+
+// Scans use a udev context of their own, since libudev contexts may not be shared between
+// threads and the one of the monitor is used on the thread that receives the events.
+class DeviceEnumeratorUdev : public DeviceEnumerator
+{
+public:
+	DeviceEnumeratorUdev();
+	virtual ~DeviceEnumeratorUdev();
+
+	virtual void Scan(const Visitor& visitor) override;
+	virtual bool StartMonitor() override;
+	virtual int GetMonitorFd() const override;
+	virtual void ReceiveEvents(const EventVisitor& visitor) override;
+
+private:
+	struct udev* m_pUdev;
+	struct udev_monitor* m_pMonitor;
+};
@@ -2,56 +2,66 @@
 // DeviceLinux.cpp
 //
 
+#include <string>
+
+#include <wx/app.h>
+#include <wx/apptrait.h>
+#include <wx/evtloop.h>
+#include <wx/log.h>
+
 #include "DeviceLinux.h"
 #include "Device.h"
-#include "SupportedDevices.h"
-#include <libudev.h>
-#include <string>
+#include "DeviceEnumeratorUdev.h"
 
-DeviceLinux::DeviceLinux(IDeviceListener *pListener)
-    : Device(pListener)
+DeviceLinux::DeviceLinux(IDeviceListener *pListener, std::unique_ptr<DeviceEnumerator> pEnumerator)
+    : Device(pListener), m_pEnumerator(std::move(pEnumerator)), m_pSource(nullptr)
 {
+    if (!m_pEnumerator) {
+        m_pEnumerator.reset(new DeviceEnumeratorUdev());
+    }
+
+    // The monitor is started first, so that no device goes unnoticed between the two.
+    if (!StartMonitor()) {
+        wxLogDebug("DeviceLinux::DeviceLinux()  hotplug monitoring unavailable");
+    }
+
+    InitClevyKeyboardPresence();
 }
 
-bool DeviceLinux::IsClevyKeyboardPresent()
+DeviceLinux::~DeviceLinux()
 {
-    struct udev* udev = udev_new();
-    if (!udev) {
-        return false;
-    }
+    CancelScan();
 
-    struct udev_enumerate* enumerate = udev_enumerate_new(udev);
-    if (!enumerate) {
-        udev_unref(udev);
+    delete m_pSource;
+}
+
+void DeviceLinux::OnReadWaiting()
+{
+    ReceiveClevyKeyboardEvents(*m_pEnumerator, [this](const std::string& path, bool bAdded) {
+        if (bAdded) {
+            AddClevyKeyboard(path);
+        }
+        else {
+            RemoveClevyKeyboard(path);
+        }
+    });
+}
+
+bool DeviceLinux::StartMonitor()
+{
+    if (!m_pEnumerator->StartMonitor() || m_pEnumerator->GetMonitorFd() < 0) {
         return false;
     }
 
-    udev_enumerate_add_match_subsystem(enumerate, "usb");
-    udev_enumerate_scan_devices(enumerate);
-
-    struct udev_list_entry* devices = udev_enumerate_get_list_entry(enumerate);
-    struct udev_list_entry* entry;
-
-    udev_list_entry_foreach(entry, devices) {
-        const char* path = udev_list_entry_get_name(entry);
-        struct udev_device* dev = udev_device_new_from_syspath(udev, path);
-        if (dev) {
-            const char* vid = udev_device_get_sysattr_value(dev, "idVendor");
-            const char* pid = udev_device_get_sysattr_value(dev, "idProduct");
-            if (vid && pid) {
-                std::string v(vid), p(pid);
-                if (IsSupported(v, p)) {
-                    udev_device_unref(dev);
-                    udev_enumerate_unref(enumerate);
-                    udev_unref(udev);
-                    return true;
-                }
-            }
-            udev_device_unref(dev);
-        }
+    wxAppTraits* pTraits = wxTheApp ? wxTheApp->GetTraits() : nullptr;
+    wxEventLoopSourcesManagerBase* pManager = pTraits ? pTraits->GetEventLoopSourcesManager() : nullptr;
+    if (pManager) {
+        m_pSource = pManager->AddSourceForFD(m_pEnumerator->GetMonitorFd(), this, wxEVENT_SOURCE_INPUT);
     }
+    return m_pSource != nullptr;
+}
 
-    udev_enumerate_unref(enumerate);
-    udev_unref(udev);
-    return false;
+void DeviceLinux::ScanClevyKeyboards(std::set<std::string>& keyboards)
+{
+    ::ScanClevyKeyboards(*m_pEnumerator, keyboards, [this]() { return IsScanCancelled(); });
 }
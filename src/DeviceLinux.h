@@ -4,12 +4,35 @@
 
 #pragma once
 
+#include <memory>
+
+#include <wx/evtloopsrc.h>
+
 #include "Device.h"
+#include "DeviceEnumerator.h"
 
-class DeviceLinux : public Device
+// Keeps track of the Clevy Keyboard through the hotplug events of the usb and input
+// subsystems. The monitor is watched by the wx event loop, so the listener is called on
+// the main thread as soon as a keyboard is connected or disconnected.
+class DeviceLinux : public Device, public wxEventLoopSourceHandler
 {
 public:
-    DeviceLinux(IDeviceListener* pListener);
+    // Uses libudev when no enumerator is given.
+    DeviceLinux(IDeviceListener* pListener, std::unique_ptr<DeviceEnumerator> pEnumerator = nullptr);
+    virtual ~DeviceLinux();
+
+    virtual void OnReadWaiting() override;
+    virtual void OnWriteWaiting() override {}
+    virtual void OnExceptionWaiting() override {}
+
+protected:
+    // Keyboards are keyed by sys path, since removed devices no longer have attributes
+    // to recognize them by.
+    virtual void ScanClevyKeyboards(std::set<std::string>& keyboards) override;
+
+private:
+    std::unique_ptr<DeviceEnumerator> m_pEnumerator;
+    wxEventLoopSource* m_pSource;
 
-    virtual bool IsClevyKeyboardPresent() override;
+    bool StartMonitor();
 };
@@ -3,84 +3,149 @@
 //
 
 #include <windows.h>
+#include <dbt.h>
+#include <initguid.h>
+#include <usbiodef.h>
 #include <wx/log.h>
 
 #include "DeviceWindows.h"
 #include "Device.h"
 #include "SupportedDevices.h"
+#include <algorithm>
+#include <cctype>
 #include <string>
 
+static std::string ToString(const TCHAR* s)
+{
+    // Convert TCHAR* to std::string properly
+    #ifdef UNICODE
+        // Convert wide string to narrow string
+        int size_needed = WideCharToMultiByte(CP_UTF8, 0, s, -1, nullptr, 0, nullptr, nullptr);
+        if (size_needed <= 0) {
+            return std::string();
+        }
+        std::string result(size_needed - 1, 0);
+        WideCharToMultiByte(CP_UTF8, 0, s, -1, &result[0], size_needed, nullptr, nullptr);
+        return result;
+    #else
+        return std::string(s);
+    #endif
+}
+
+static std::string ToUpper(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c){ return static_cast<char>(::toupper(c)); });
+    return s;
+}
+
+// Turns a device interface path, "\\?\USB#VID_04B4&PID_0101#5&2a8e4e&0&1#{guid}", into the
+// instance id of its device, "USB\VID_04B4&PID_0101\5&2A8E4E&0&1".
+static std::string InterfacePathToInstanceId(std::string path)
+{
+    if (path.compare(0, 4, "\\\\?\\") == 0) {
+        path.erase(0, 4);
+    }
+    size_t guidPos = path.rfind("#{");
+    if (guidPos != std::string::npos) {
+        path.erase(guidPos);
+    }
+    std::replace(path.begin(), path.end(), '#', '\\');
+    return ToUpper(path);
+}
+
 DeviceWindows::DeviceWindows(IDeviceListener* pListener)
     : Device(pListener), wxFrame(nullptr, wxID_ANY, wxEmptyString)
 {
+    // Arrivals and removals of USB devices name the device, other changes do not.
+    DEV_BROADCAST_DEVICEINTERFACE filter = {};
+    filter.dbcc_size = sizeof(filter);
+    filter.dbcc_devicetype = DBT_DEVTYP_DEVICEINTERFACE;
+    filter.dbcc_classguid = GUID_DEVINTERFACE_USB_DEVICE;
+    m_hDeviceNotify = RegisterDeviceNotification(GetHWND(), &filter, DEVICE_NOTIFY_WINDOW_HANDLE);
+
     InitClevyKeyboardPresence();
 }
 
 DeviceWindows::~DeviceWindows()
 {
+    CancelScan();
+
+    if (m_hDeviceNotify != nullptr)
+    {
+        UnregisterDeviceNotification(m_hDeviceNotify);
+    }
 }
 
 WXLRESULT DeviceWindows::MSWWindowProc(WXUINT message, WXWPARAM wParam, WXLPARAM lParam)
 {
-    (void)wParam;
-    (void)lParam;
-
     if (message == WM_DEVICECHANGE)
     {
-        RefreshClevyKeyboardPresence();
+        const DEV_BROADCAST_HDR* pHeader = reinterpret_cast<const DEV_BROADCAST_HDR*>(lParam);
+        if ((wParam == DBT_DEVICEARRIVAL || wParam == DBT_DEVICEREMOVECOMPLETE) && pHeader != nullptr && pHeader->dbch_devicetype == DBT_DEVTYP_DEVICEINTERFACE)
+        {
+            const DEV_BROADCAST_DEVICEINTERFACE* pInterface = reinterpret_cast<const DEV_BROADCAST_DEVICEINTERFACE*>(lParam);
+            std::string id = InterfacePathToInstanceId(ToString(pInterface->dbcc_name));
+            if (IsSupportedHardwareId(id))
+            {
+                if (wParam == DBT_DEVICEARRIVAL)
+                {
+                    AddClevyKeyboard(id);
+                }
+                else
+                {
+                    RemoveClevyKeyboard(id);
+                }
+            }
+        }
+        else if (wParam == DBT_DEVNODES_CHANGED)
+        {
+            // Bluetooth keyboards only show up here. These come in bursts, e.g. when
+            // docking, so the device tree is walked once they have calmed down.
+            ScheduleRescan();
+        }
     }
 
     return 0;
 }
 
-bool DeviceWindows::IsClevyKeyboardPresent()
+void DeviceWindows::ScanClevyKeyboards(std::set<std::string>& keyboards)
 {
     DEVINST hRootDevice;
     CONFIGRET cr = CM_Locate_DevNode(&hRootDevice, nullptr, CM_LOCATE_DEVINST_NORMAL);
     if (cr != CR_SUCCESS)
     {
-        return false;
+        return;
     }
 
-    return DoesContainClevyKeyboard(hRootDevice);
+    ScanClevyKeyboards(hRootDevice, keyboards);
 }
 
-bool DeviceWindows::DoesContainClevyKeyboard(DEVINST hDevice)
+void DeviceWindows::ScanClevyKeyboards(DEVINST hDevice, std::set<std::string>& keyboards)
 {
-    while (true)
+    while (!IsScanCancelled())
     {
         // Retrieve hardware ID
         TCHAR szHardwareId[1024] = { 0 };
         ULONG ulHardwareId = 1024;
         CONFIGRET cr = CM_Get_DevNode_Registry_Property(hDevice, CM_DRP_HARDWAREID, nullptr, szHardwareId, &ulHardwareId, 0);
-        if (cr == CR_SUCCESS)
+        if (cr == CR_SUCCESS && IsSupportedHardwareId(ToUpper(ToString(szHardwareId))))
         {
-            // Convert to upper case
-            _tcsupr(szHardwareId);
-
-            // Check if it matches known Clevy Keyboard hardware IDs
-            std::string vid, pid;
-            if (extractVidPid(szHardwareId, vid, pid)) {
-                if (IsSupported(vid, pid)) {
-                    return true;
-                }
-            }
-
-            // Keep BT check for now
-            if (_tcsstr(szHardwareId, TEXT("BTHENUM\\DEV_01000141")) != nullptr) {
-                return true;
+            // Only the keyboard itself, not its interfaces, so that the removal of the USB
+            // device removes the keyboard
+            TCHAR szInstanceId[MAX_DEVICE_ID_LEN] = { 0 };
+            if (CM_Get_Device_ID(hDevice, szInstanceId, MAX_DEVICE_ID_LEN, 0) == CR_SUCCESS)
+            {
+                keyboards.insert(ToUpper(ToString(szInstanceId)));
             }
         }
-
-        // Recursively iterate through child devices
-        DEVINST hChildDevice;
-        cr = CM_Get_Child(&hChildDevice, hDevice, 0);
-        if (cr == CR_SUCCESS)
+        else
         {
-            bool contains = DoesContainClevyKeyboard(hChildDevice);
-            if (contains)
+            // Recursively iterate through child devices
+            DEVINST hChildDevice;
+            cr = CM_Get_Child(&hChildDevice, hDevice, 0);
+            if (cr == CR_SUCCESS)
             {
-                return true;
+                ScanClevyKeyboards(hChildDevice, keyboards);
             }
         }
 
@@ -93,33 +158,4 @@ bool DeviceWindows::DoesContainClevyKeyboard(DEVINST hDevice)
         }
         hDevice = hNextDevice;
     }
-
-    return false;
-}
-
-bool DeviceWindows::extractVidPid(const TCHAR* hardwareId, std::string& vid, std::string& pid)
-{
-    // Convert TCHAR* to std::string properly
-    #ifdef UNICODE
-        // Convert wide string to narrow string
-        int size_needed = WideCharToMultiByte(CP_UTF8, 0, hardwareId, -1, nullptr, 0, nullptr, nullptr);
-        if (size_needed <= 0) {
-            return false;
-        }
-        std::string hid(size_needed - 1, 0);
-        WideCharToMultiByte(CP_UTF8, 0, hardwareId, -1, &hid[0], size_needed, nullptr, nullptr);
-    #else
-        std::string hid = hardwareId;
-    #endif
-    
-    size_t vidPos = hid.find("VID_");
-    if (vidPos != std::string::npos) {
-        vid = hid.substr(vidPos + 4, 4);
-        size_t pidPos = hid.find("PID_", vidPos);
-        if (pidPos != std::string::npos) {
-            pid = hid.substr(pidPos + 4, 4);
-            return true;
-        }
-    }
-    return false;
 }
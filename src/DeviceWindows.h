@@ -18,10 +18,14 @@ public:
     DeviceWindows(IDeviceListener* pListener);
     virtual ~DeviceWindows();
 
-    virtual bool IsClevyKeyboardPresent() override;
+protected:
+    // Keyboards are keyed by device instance id, e.g. "USB\VID_04B4&PID_0101\5&2A8E4E&0&1".
+    virtual void ScanClevyKeyboards(std::set<std::string>& keyboards) override;
 
 private:
+    HDEVNOTIFY m_hDeviceNotify;
+
     WXLRESULT MSWWindowProc(WXUINT message, WXWPARAM wParam, WXLPARAM lParam) override;
 
-    bool DoesContainClevyKeyboard(DEVINST hDevice);
+    void ScanClevyKeyboards(DEVINST hDevice, std::set<std::string>& keyboards);
 };
@@ -0,0 +1,292 @@
+//
+// EvdevCapture.cpp
+//
+
+#include <cerrno>
+#include <cstring>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "EvdevCapture.h"
+#include "SupportedDevices.h"
+
+static const char kVirtualKeyboardName[] = "Clevy Dyscover virtual keyboard";
+
+static bool TestBit(const unsigned char* bits, int bit)
+{
+    return (bits[bit / 8] >> (bit % 8)) & 1;
+}
+
+static_assert(BUS_USB == 0x03, "the bus that IsSupportedInputDevice() knows");
+
+static bool IsSupportedKeyboard(int fd)
+{
+    struct input_id id;
+    if (ioctl(fd, EVIOCGID, &id) < 0 || !IsSupportedInputDevice(id.bustype, id.vendor, id.product)) {
+        return false;
+    }
+
+    // Only the node with the letter keys, not e.g. the one for the media keys
+    unsigned char keys[(KEY_MAX + 7) / 8] = {};
+    return ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) >= 0 && TestBit(keys, KEY_A);
+}
+
+EvdevCapture::EvdevCapture(Handler handler, const std::string& directory)
+    : m_handler(std::move(handler)), m_directory(directory), m_epollFd(-1), m_inotifyFd(-1), m_uinputFd(-1),
+      m_bCapsLockActive(false)
+{
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0 || !CreateVirtualKeyboard()) {
+        return;
+    }
+
+    struct epoll_event leds = {};
+    leds.events = EPOLLIN;
+    leds.data.fd = m_uinputFd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_uinputFd, &leds);
+
+    // Watched before the first scan, so that no keyboard goes unnoticed between the two.
+    // Nodes are created before udev gives access to them, hence the attribute changes.
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd >= 0 && inotify_add_watch(m_inotifyFd, m_directory.c_str(), IN_CREATE | IN_ATTRIB) >= 0) {
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = m_inotifyFd;
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_inotifyFd, &event);
+    }
+
+    OpenDevices();
+}
+
+EvdevCapture::~EvdevCapture()
+{
+    while (!m_devices.empty()) {
+        CloseDevice(m_devices.begin()->first);
+    }
+    if (m_uinputFd >= 0) {
+        ioctl(m_uinputFd, UI_DEV_DESTROY);
+        close(m_uinputFd);
+    }
+    if (m_inotifyFd >= 0) {
+        close(m_inotifyFd);
+    }
+    if (m_epollFd >= 0) {
+        close(m_epollFd);
+    }
+}
+
+void EvdevCapture::OpenDevices()
+{
+    if (!IsValid()) {
+        return;
+    }
+
+    DIR* dir = opendir(m_directory.c_str());
+    if (!dir) {
+        return;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        if (strncmp(entry->d_name, "event", 5) == 0) {
+            OpenDevice(m_directory + "/" + entry->d_name);
+        }
+    }
+    closedir(dir);
+}
+
+void EvdevCapture::ReadEvents()
+{
+    struct epoll_event events[16];
+    int count;
+    while ((count = epoll_wait(m_epollFd, events, 16, 0)) > 0) {
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.fd == m_inotifyFd) {
+                ReadDirectoryChanges();
+            }
+            else if (events[i].data.fd == m_uinputFd) {
+                ReadLeds();
+            }
+            else if (m_devices.count(events[i].data.fd) > 0) {
+                // Not when it was closed by an earlier event of this batch
+                ReadDevice(events[i].data.fd);
+            }
+        }
+    }
+}
+
+void EvdevCapture::SendKey(int code, int value)
+{
+    if (m_uinputFd < 0) {
+        return;
+    }
+
+    struct input_event events[2] = {};
+    events[0].type = EV_KEY;
+    events[0].code = static_cast<unsigned short>(code);
+    events[0].value = value;
+    events[1].type = EV_SYN;
+    events[1].code = SYN_REPORT;
+    if (write(m_uinputFd, events, sizeof(events)) < 0) {
+        // The keystroke is lost; there is nothing better to do with it
+    }
+}
+
+void EvdevCapture::OpenDevice(const std::string& path)
+{
+    if (IsOpen(path)) {
+        return;
+    }
+
+    // Writing is only needed for the LEDs
+    int fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    }
+    if (fd < 0) {
+        return;
+    }
+    if (!IsSupportedKeyboard(fd)) {
+        close(fd);
+        return;
+    }
+
+    // Its LEDs are still up to date until it is grabbed
+    unsigned char leds[(LED_MAX + 7) / 8] = {};
+    const bool bLeds = ioctl(fd, EVIOCGLED(sizeof(leds)), leds) >= 0;
+
+    // Grabbing fails when another program has grabbed the keyboard already
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (ioctl(fd, EVIOCGRAB, 1) < 0 || epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        close(fd);
+        return;
+    }
+    m_devices[fd] = Node{ path };
+    if (bLeds) {
+        m_bCapsLockActive = TestBit(leds, LED_CAPSL);
+    }
+}
+
+void EvdevCapture::CloseDevice(int fd)
+{
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ioctl(fd, EVIOCGRAB, 0);
+    close(fd);
+    m_devices.erase(fd);
+}
+
+void EvdevCapture::ReadDevice(int fd)
+{
+    struct input_event events[64];
+    while (true) {
+        ssize_t size = read(fd, events, sizeof(events));
+        if (size < 0 && errno == EINTR) {
+            continue;
+        }
+        if (size < 0 && errno == EAGAIN) {
+            return;
+        }
+        if (size <= 0) {
+            // Unplugged
+            CloseDevice(fd);
+            return;
+        }
+
+        for (size_t i = 0; i < static_cast<size_t>(size) / sizeof(struct input_event); i++) {
+            if (events[i].type == EV_KEY && !m_handler(events[i].code, events[i].value)) {
+                SendKey(events[i].code, events[i].value);
+            }
+        }
+    }
+}
+
+void EvdevCapture::ReadLeds()
+{
+    struct input_event events[16];
+    ssize_t size;
+    while ((size = read(m_uinputFd, events, sizeof(events))) > 0) {
+        for (size_t i = 0; i < static_cast<size_t>(size) / sizeof(struct input_event); i++) {
+            if (events[i].type != EV_LED) {
+                continue;
+            }
+            if (events[i].code == LED_CAPSL) {
+                m_bCapsLockActive = events[i].value != 0;
+            }
+            for (const auto& device : m_devices) {
+                SetLed(device.first, events[i].code, events[i].value);
+            }
+        }
+    }
+}
+
+void EvdevCapture::SetLed(int fd, int code, int value)
+{
+    struct input_event events[2] = {};
+    events[0].type = EV_LED;
+    events[0].code = static_cast<unsigned short>(code);
+    events[0].value = value;
+    events[1].type = EV_SYN;
+    events[1].code = SYN_REPORT;
+    if (write(fd, events, sizeof(events)) < 0) {
+        // Opened read-only, or the keyboard has no such LED
+    }
+}
+
+void EvdevCapture::ReadDirectoryChanges()
+{
+    alignas(struct inotify_event) char buffer[4096];
+    bool bChanged = false;
+    while (read(m_inotifyFd, buffer, sizeof(buffer)) > 0) {
+        bChanged = true;
+    }
+    if (bChanged) {
+        OpenDevices();
+    }
+}
+
+bool EvdevCapture::IsOpen(const std::string& path) const
+{
+    for (const auto& device : m_devices) {
+        if (device.second.path == path) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool EvdevCapture::CreateVirtualKeyboard()
+{
+    // Read too, for the LEDs that the system sets
+    m_uinputFd = open("/dev/uinput", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (m_uinputFd < 0) {
+        return false;
+    }
+
+    ioctl(m_uinputFd, UI_SET_EVBIT, EV_KEY);
+    ioctl(m_uinputFd, UI_SET_EVBIT, EV_SYN);
+    ioctl(m_uinputFd, UI_SET_EVBIT, EV_LED);
+    for (int code = 1; code < KEY_MAX; code++) {
+        ioctl(m_uinputFd, UI_SET_KEYBIT, code);
+    }
+    for (int code : { LED_NUML, LED_CAPSL, LED_SCROLLL }) {
+        ioctl(m_uinputFd, UI_SET_LEDBIT, code);
+    }
+
+    // Its ids are not in the supported list, so it is never grabbed itself
+    struct uinput_setup setup = {};
+    setup.id.bustype = BUS_VIRTUAL;
+    strncpy(setup.name, kVirtualKeyboardName, UINPUT_MAX_NAME_SIZE - 1);
+    if (ioctl(m_uinputFd, UI_DEV_SETUP, &setup) < 0 || ioctl(m_uinputFd, UI_DEV_CREATE) < 0) {
+        close(m_uinputFd);
+        m_uinputFd = -1;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+//
+// EvdevCapture.h
+//
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <string>
+
+// Captures the key events of the supported keyboards only, by grabbing their evdev nodes
+// in /dev/input. Other keyboards are not opened, so their keystrokes reach the system
+// untouched. Key events that the handler does not suppress are passed on through a
+// virtual uinput keyboard, which is also used to send keystrokes.
+//
+// The system no longer sets the LEDs of a grabbed keyboard, so their state goes stale.
+// The virtual keyboard has LEDs instead, which the system sets like those of any other
+// keyboard. Their changes are read back to track Caps Lock, and copied to the grabbed
+// keyboards.
+//
+// All the descriptors are gathered in one epoll descriptor, GetFd(), including an
+// inotify watch on the directory, so that keyboards that are plugged in later are picked
+// up. ReadEvents() handles whatever is pending without blocking.
+class EvdevCapture
+{
+public:
+	// Called with the evdev key code, and 1 for a press, 0 for a release and 2 for a
+	// repeat. Returns true to suppress the event.
+	typedef std::function<bool(int code, int value)> Handler;
+
+	explicit EvdevCapture(Handler handler, const std::string& directory = "/dev/input");
+	~EvdevCapture();
+
+	EvdevCapture(const EvdevCapture&) = delete;
+	EvdevCapture& operator=(const EvdevCapture&) = delete;
+
+	// False if neither epoll nor uinput could be set up, e.g. without access to /dev/uinput.
+	bool IsValid() const { return m_epollFd >= 0 && m_uinputFd >= 0; }
+	int GetFd() const { return m_epollFd; }
+
+	// Opens and grabs the nodes of supported keyboards that are not open yet.
+	void OpenDevices();
+	size_t GetDeviceCount() const { return m_devices.size(); }
+
+	void ReadEvents();
+
+	// As the system has it, so also when toggled on another keyboard.
+	bool IsCapsLockActive() const { return m_bCapsLockActive; }
+
+	// Writes a key event to the virtual keyboard.
+	void SendKey(int code, int value);
+
+private:
+	struct Node
+	{
+		std::string path;
+	};
+
+	const Handler m_handler;
+	const std::string m_directory;
+	int m_epollFd;
+	int m_inotifyFd;
+	int m_uinputFd;
+	std::map<int, Node> m_devices;  // By descriptor
+	std::atomic<bool> m_bCapsLockActive;
+
+	void OpenDevice(const std::string& path);
+	void CloseDevice(int fd);
+	void ReadDevice(int fd);
+	void ReadLeds();
+	void SetLed(int fd, int code, int value);
+	void ReadDirectoryChanges();
+	bool IsOpen(const std::string& path) const;
+	bool CreateVirtualKeyboard();
+};
@@ -0,0 +1,160 @@
+//
+// InputThread.cpp
+//
+
+#include <future>
+
+#ifndef WIN32
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#endif // WIN32
+
+#include "InputThread.h"
+
+#ifdef WIN32
+
+InputThread::InputThread()
+    : m_bHighPriority(false), m_threadId(0)
+{
+}
+
+bool InputThread::Start(std::function<bool()> setUp, std::function<void()> tearDown)
+{
+    std::promise<bool> started;
+    std::future<bool> result = started.get_future();
+
+    m_thread = std::thread([this, setUp, tearDown, &started]() {
+        RaisePriority();
+
+        // Gives the thread a message queue before Stop() can post to it
+        MSG msg;
+        PeekMessage(&msg, nullptr, WM_USER, WM_USER, PM_NOREMOVE);
+        m_threadId = GetCurrentThreadId();
+
+        if (!setUp()) {
+            tearDown();
+            started.set_value(false);
+            return;
+        }
+        started.set_value(true);
+
+        while (GetMessage(&msg, nullptr, 0, 0) > 0) {
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+
+        tearDown();
+    });
+
+    if (!result.get()) {
+        m_thread.join();
+        return false;
+    }
+    return true;
+}
+
+void InputThread::Stop()
+{
+    if (m_thread.joinable()) {
+        PostThreadMessage(m_threadId, WM_QUIT, 0, 0);
+        m_thread.join();
+    }
+}
+
+void InputThread::RaisePriority()
+{
+    m_bHighPriority = SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != FALSE;
+}
+
+#else
+
+InputThread::InputThread()
+    : m_bHighPriority(false), m_epollFd(-1), m_stopFd(-1)
+{
+}
+
+bool InputThread::Start(int fd, std::function<void()> onReadable)
+{
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    bool bAdded = m_epollFd >= 0 && m_stopFd >= 0 && epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+    event.data.fd = m_stopFd;
+    bAdded = bAdded && epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_stopFd, &event) == 0;
+    if (!bAdded) {
+        Stop();
+        return false;
+    }
+
+    std::promise<void> started;
+    std::future<void> result = started.get_future();
+
+    m_thread = std::thread([this, onReadable, &started]() {
+        RaisePriority();
+        started.set_value();
+
+        for (;;) {
+            epoll_event events[2];
+            const int count = epoll_wait(m_epollFd, events, 2, -1);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                return;
+            }
+            for (int i = 0; i < count; i++) {
+                if (events[i].data.fd == m_stopFd) {
+                    return;
+                }
+                onReadable();
+            }
+        }
+    });
+
+    result.wait();
+    return true;
+}
+
+void InputThread::Stop()
+{
+    if (m_thread.joinable()) {
+        const uint64_t value = 1;
+        if (write(m_stopFd, &value, sizeof(value)) < 0) {
+            // Only fails when the counter would overflow, which one write cannot cause
+        }
+        m_thread.join();
+    }
+
+    if (m_stopFd >= 0) close(m_stopFd);
+    if (m_epollFd >= 0) close(m_epollFd);
+    m_stopFd = -1;
+    m_epollFd = -1;
+}
+
+// Real-time scheduling needs CAP_SYS_NICE or an RLIMIT_RTPRIO, otherwise a lower nice
+// value of the thread is tried, which needs an RLIMIT_NICE.
+void InputThread::RaisePriority()
+{
+    sched_param param = {};
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) {
+        m_bHighPriority = true;
+        return;
+    }
+    m_bHighPriority = setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), -10) == 0;
+}
+
+#endif // WIN32
+
+InputThread::~InputThread()
+{
+    Stop();
+}
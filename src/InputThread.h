@@ -0,0 +1,57 @@
+//
+// InputThread.h
+//
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif // WIN32
+
+// Runs keyboard capture on a thread of its own, at a raised priority, so that keystrokes
+// are not held up while the main thread paints a dialog, shows a message box or is busy
+// otherwise. On Windows the thread runs a message loop, which is what services the
+// Raw Input window that was set up on it, which the keyboard hook asks too. On Linux it waits for
+// a descriptor with epoll.
+class InputThread
+{
+public:
+	InputThread();
+	~InputThread();
+
+	InputThread(const InputThread&) = delete;
+	InputThread& operator=(const InputThread&) = delete;
+
+#ifdef WIN32
+	// setUp is called on the thread before the message loop starts, tearDown when it has
+	// ended, also when setUp failed. Returns what setUp returned.
+	bool Start(std::function<bool()> setUp, std::function<void()> tearDown);
+#else
+	// onReadable is called on the thread whenever fd is readable. Returns once the thread
+	// runs.
+	bool Start(int fd, std::function<void()> onReadable);
+#endif // WIN32
+
+	// Waits for the thread to end. Called by the destructor.
+	void Stop();
+
+	// Whether the priority of the thread could be raised, which may need privileges.
+	bool IsHighPriority() const { return m_bHighPriority; }
+
+private:
+	std::thread m_thread;
+	std::atomic<bool> m_bHighPriority;
+#ifdef WIN32
+	DWORD m_threadId;
+#else
+	int m_epollFd;
+	int m_stopFd;
+#endif // WIN32
+
+	void RaisePriority();
+};
@@ -37,6 +37,8 @@ Keyboard::Keyboard(IKeyEventListener* pListener)
 void Keyboard::Initialize()
 {
     m_bCapsLockActive = IsCapsLockActive();
+
+    StartCapture();
 }
 
 void Keyboard::SendKeyStroke(Key key, bool shift, bool ctrl, bool alt)
@@ -32,6 +32,12 @@ protected:
 
     bool ProcessKeyEvent(KeyEventType eventType, Key key);
 
+    // For when Caps Lock is toggled elsewhere, e.g. on another keyboard
+    void SetCapsLockActive(bool bActive) { m_bCapsLockActive = bActive; }
+
+    // Starts the input thread, which calls the listener from then on
+    virtual void StartCapture() = 0;
+
 private:
     void Initialize();
 
@@ -0,0 +1,73 @@
+//
+// KeyboardHook.cpp
+//
+// DyscoverHook.dll, see KeyboardHook.h. It is loaded into every application that gets
+// keyboard input, so it only asks Dyscover what to do with each keystroke.
+//
+
+#include "KeyboardHook.h"
+
+// The window to ask is shared by all processes that the DLL is loaded into.
+#ifdef _MSC_VER
+#pragma data_seg(".shared")
+static HWND g_hWnd = nullptr;
+#pragma data_seg()
+#pragma comment(linker, "/SECTION:.shared,RWS")
+#else
+static HWND g_hWnd __attribute__((section(".shared"), shared)) = nullptr;
+#endif
+
+static HINSTANCE g_hInstance = nullptr;
+static UINT g_message = 0;
+static HHOOK g_hHook = nullptr;  // Only set in Dyscover itself
+
+static LRESULT CALLBACK KeyboardProc(int nCode, WPARAM wParam, LPARAM lParam)
+{
+    HWND hWnd = g_hWnd;
+    if ((nCode == HC_ACTION || nCode == HC_NOREMOVE) && hWnd != nullptr)
+    {
+        DWORD_PTR result = 0;
+        WPARAM key = MAKEWPARAM(LOWORD(wParam), static_cast<WORD>(nCode));
+        if (SendMessageTimeout(hWnd, g_message, key, lParam, SMTO_ABORTIFHUNG, kKeyboardHookTimeoutMs, &result) != 0 && result != 0)
+        {
+            return 1;
+        }
+    }
+
+    return CallNextHookEx(nullptr, nCode, wParam, lParam);
+}
+
+BOOL WINAPI DllMain(HINSTANCE hInstance, DWORD reason, LPVOID reserved)
+{
+    (void)reserved;
+
+    if (reason == DLL_PROCESS_ATTACH)
+    {
+        g_hInstance = hInstance;
+        g_message = RegisterWindowMessage(kKeyboardHookMessage);
+        DisableThreadLibraryCalls(hInstance);
+    }
+    return TRUE;
+}
+
+extern "C" __declspec(dllexport) BOOL InstallKeyboardHook(HWND hWnd)
+{
+    g_hWnd = hWnd;
+    g_hHook = SetWindowsHookEx(WH_KEYBOARD, KeyboardProc, g_hInstance, 0);
+    if (g_hHook == nullptr)
+    {
+        g_hWnd = nullptr;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+extern "C" __declspec(dllexport) void RemoveKeyboardHook()
+{
+    g_hWnd = nullptr;
+    if (g_hHook != nullptr)
+    {
+        UnhookWindowsHookEx(g_hHook);
+        g_hHook = nullptr;
+    }
+}
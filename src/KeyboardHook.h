@@ -0,0 +1,29 @@
+//
+// KeyboardHook.h
+//
+
+#pragma once
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+// Interface of DyscoverHook.dll. Its WH_KEYBOARD hook runs in every application that gets
+// keyboard input, when the application takes a keystroke from its queue. That is after
+// Raw Input has reported the keystroke, unlike with a low-level hook, so Dyscover can tell
+// which keyboard it came from before it decides what happens to it.
+//
+// The hook sends the message registered as kKeyboardHookMessage to the window passed to
+// InstallKeyboardHook(). The low word of wParam is the virtual key code, the high word
+// the hook code, HC_ACTION or HC_NOREMOVE, and lParam holds the keystroke flags as passed
+// to the hook. A nonzero result swallows the keystroke. Keystrokes are passed on when
+// Dyscover does not answer within kKeyboardHookTimeoutMs.
+static const TCHAR kKeyboardHookMessage[] = TEXT("ClevyDyscoverKeyboardHook");
+static const UINT kKeyboardHookTimeoutMs = 200;
+
+static const char kKeyboardHookLibrary[] = "DyscoverHook.dll";
+
+extern "C"
+{
+    typedef BOOL (*InstallKeyboardHookProc)(HWND hWnd);
+    typedef void (*RemoveKeyboardHookProc)();
+}
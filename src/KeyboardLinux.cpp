@@ -2,26 +2,62 @@
 // KeyboardLinux.cpp
 //
 
+#include <linux/input.h>
+
+#include <wx/log.h>
+
 #include "KeyboardLinux.h"
 
 KeyboardLinux::KeyboardLinux(IKeyEventListener *pListener)
     : Keyboard(pListener)
 {
+    m_pCapture.reset(new EvdevCapture([this](int code, int value) {
+        // Follows the system only when it changes, as its LEDs lag behind our own Caps Lock
+        const bool bCapsLockActive = m_pCapture->IsCapsLockActive();
+        if (bCapsLockActive != m_bSystemCapsLockActive) {
+            m_bSystemCapsLockActive = bCapsLockActive;
+            SetCapsLockActive(bCapsLockActive);
+        }
+        return ProcessKeyEvent(value == 0 ? KeyEventType::KeyUp : KeyEventType::KeyDown, KeyFromKeyCode(code));
+    }));
+    m_bSystemCapsLockActive = m_pCapture->IsCapsLockActive();
+    if (!m_pCapture->IsValid()) {
+        wxLogDebug("KeyboardLinux::KeyboardLinux()  keyboard capture unavailable, no access to /dev/uinput?");
+    }
 }
 
 KeyboardLinux::~KeyboardLinux()
 {
+    m_inputThread.Stop();
+}
+
+void KeyboardLinux::StartCapture()
+{
+    if (!m_pCapture->IsValid()) {
+        return;
+    }
+
+    EvdevCapture* pCapture = m_pCapture.get();
+    if (!m_inputThread.Start(pCapture->GetFd(), [pCapture]() { pCapture->ReadEvents(); })) {
+        wxLogDebug("KeyboardLinux::StartCapture()  failed to start the input thread");
+        return;
+    }
+    if (!m_inputThread.IsHighPriority()) {
+        wxLogDebug("KeyboardLinux::StartCapture()  input thread runs at normal priority");
+    }
 }
 
 bool KeyboardLinux::IsCapsLockActive()
 {
-    return false;
+    return m_pCapture->IsCapsLockActive();
 }
 
 void KeyboardLinux::SendKeyEvent(KeyEventType eventType, Key key)
 {
-    (void)eventType;
-    (void)key;
+    int keyCode = KeyCodeFromKey(key);
+    if (keyCode != -1) {
+        m_pCapture->SendKey(keyCode, eventType == KeyEventType::KeyUp ? 0 : 1);
+    }
 }
 
 std::string KeyboardLinux::TranslateKeyStroke(Key key, bool shift, bool ctrl)
@@ -32,3 +68,112 @@ std::string KeyboardLinux::TranslateKeyStroke(Key key, bool shift, bool ctrl)
 
     return std::string();
 }
+
+struct KeyMapping
+{
+    Key key;
+    int code;
+};
+
+static constexpr KeyMapping s_keyMappings[] = {
+    { Key::Backspace, KEY_BACKSPACE },
+    { Key::Tab, KEY_TAB },
+    { Key::Enter, KEY_ENTER },
+    { Key::Shift, KEY_LEFTSHIFT },
+    { Key::Ctrl, KEY_LEFTCTRL },
+    { Key::Esc, KEY_ESC },
+    { Key::CapsLock, KEY_CAPSLOCK },
+    { Key::Space, KEY_SPACE },
+    { Key::PageUp, KEY_PAGEUP },
+    { Key::PageDown, KEY_PAGEDOWN },
+    { Key::Home, KEY_HOME },
+    { Key::End, KEY_END },
+    { Key::Ins, KEY_INSERT },
+    { Key::Del, KEY_DELETE },
+    { Key::Up, KEY_UP },
+    { Key::Down, KEY_DOWN },
+    { Key::Left, KEY_LEFT },
+    { Key::Right, KEY_RIGHT },
+    { Key::WinCmd, KEY_LEFTMETA },
+    { Key::Alt, KEY_LEFTALT },
+    { Key::Zero, KEY_0 },
+    { Key::One, KEY_1 },
+    { Key::Two, KEY_2 },
+    { Key::Three, KEY_3 },
+    { Key::Four, KEY_4 },
+    { Key::Five, KEY_5 },
+    { Key::Six, KEY_6 },
+    { Key::Seven, KEY_7 },
+    { Key::Eight, KEY_8 },
+    { Key::Nine, KEY_9 },
+    { Key::A, KEY_A },
+    { Key::B, KEY_B },
+    { Key::C, KEY_C },
+    { Key::D, KEY_D },
+    { Key::E, KEY_E },
+    { Key::F, KEY_F },
+    { Key::G, KEY_G },
+    { Key::H, KEY_H },
+    { Key::I, KEY_I },
+    { Key::J, KEY_J },
+    { Key::K, KEY_K },
+    { Key::L, KEY_L },
+    { Key::M, KEY_M },
+    { Key::N, KEY_N },
+    { Key::O, KEY_O },
+    { Key::P, KEY_P },
+    { Key::Q, KEY_Q },
+    { Key::R, KEY_R },
+    { Key::S, KEY_S },
+    { Key::T, KEY_T },
+    { Key::U, KEY_U },
+    { Key::V, KEY_V },
+    { Key::W, KEY_W },
+    { Key::X, KEY_X },
+    { Key::Y, KEY_Y },
+    { Key::Z, KEY_Z },
+    { Key::AltGr, KEY_RIGHTALT },
+    { Key::Equal, KEY_EQUAL },
+    { Key::Comma, KEY_COMMA },
+    { Key::Minus, KEY_MINUS },
+    { Key::Dot, KEY_DOT },
+    { Key::Semicolon, KEY_SEMICOLON },
+    { Key::Slash, KEY_SLASH },
+    { Key::Backtick, KEY_GRAVE },
+    { Key::OpenBracket, KEY_LEFTBRACE },
+    { Key::Backslash, KEY_BACKSLASH },
+    { Key::CloseBracket, KEY_RIGHTBRACE },
+    { Key::Apostrophe, KEY_APOSTROPHE },
+    { Key::F1, KEY_F1 },
+    { Key::F2, KEY_F2 },
+    { Key::F3, KEY_F3 },
+    { Key::F4, KEY_F4 },
+    { Key::F5, KEY_F5 },
+    { Key::F6, KEY_F6 },
+    { Key::F7, KEY_F7 },
+    { Key::F8, KEY_F8 },
+    { Key::F9, KEY_F9 },
+    { Key::F10, KEY_F10 },
+    { Key::F11, KEY_F11 },
+    { Key::F12, KEY_F12 },
+};
+
+Key KeyboardLinux::KeyFromKeyCode(int keyCode)
+{
+    for (KeyMapping mapping : s_keyMappings) {
+        if (mapping.code == keyCode) {
+            return mapping.key;
+        }
+    }
+    return Key::Unknown;
+}
+
+int KeyboardLinux::KeyCodeFromKey(Key key)
+{
+    for (KeyMapping mapping : s_keyMappings) {
+        if (mapping.key == key) {
+            return mapping.code;
+        }
+    }
+    return -1;
+}
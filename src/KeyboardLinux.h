@@ -4,8 +4,14 @@
 
 #pragma once
 
+#include <memory>
+
+#include "EvdevCapture.h"
+#include "InputThread.h"
 #include "Keyboard.h"
 
+// Captures the Clevy Keyboard only, through EvdevCapture. The capture descriptor is
+// watched by the input thread, which the listener is called on.
 class KeyboardLinux : public Keyboard
 {
 public:
@@ -17,4 +23,15 @@ public:
     virtual void SendKeyEvent(KeyEventType eventType, Key key) override;
 
     virtual std::string TranslateKeyStroke(Key key, bool shift, bool ctrl) override;
+
+protected:
+    virtual void StartCapture() override;
+
+private:
+    std::unique_ptr<EvdevCapture> m_pCapture;
+    InputThread m_inputThread;
+    bool m_bSystemCapsLockActive;  // Last seen from the capture, used on the input thread
+
+    static Key KeyFromKeyCode(int keyCode);
+    static int KeyCodeFromKey(Key key);
 };
@@ -2,12 +2,25 @@
 // KeyboardWindows.cpp
 //
 
+#include <algorithm>
 #include <cassert>
+#include <cctype>
+#include <string>
 
+#include <wx/log.h>
+
+#include "KeyboardHook.h"
 #include "KeyboardWindows.h"
+#include "SupportedDevices.h"
 
 KeyboardWindows* g_pInstance = nullptr;
 
+static const TCHAR kRawInputWindowClass[] = TEXT("DyscoverRawInput");
+
+// Raw Input reports of keystrokes that no hook asks about, e.g. those typed into an
+// elevated application, are dropped beyond this.
+static const size_t kMaxRawKeys = 64;
+
 KeyboardWindows::KeyboardWindows(IKeyEventListener* pListener)
     : Keyboard(pListener)
 {
@@ -15,12 +28,228 @@ KeyboardWindows::KeyboardWindows(IKeyEventListener* pListener)
 
     g_pInstance = this;
 
-    m_hKeyboardHook = SetWindowsHookEx(WH_KEYBOARD_LL, KeyboardWindows::LowLevelKeyboardProc, NULL, 0);
+    m_hRawInputWindow = nullptr;
+    m_hHookLibrary = nullptr;
+    m_hookMessage = RegisterWindowMessage(kKeyboardHookMessage);
 }
 
 KeyboardWindows::~KeyboardWindows()
 {
-    UnhookWindowsHookEx(m_hKeyboardHook);
+    m_inputThread.Stop();
+
+    g_pInstance = nullptr;
+}
+
+void KeyboardWindows::StartCapture()
+{
+    if (!m_inputThread.Start([this]() { return SetUpCapture(); }, [this]() { TearDownCapture(); }))
+    {
+        wxLogDebug("KeyboardWindows::StartCapture()  failed to set up capture on the input thread");
+        return;
+    }
+    if (!m_inputThread.IsHighPriority())
+    {
+        wxLogDebug("KeyboardWindows::StartCapture()  input thread runs at normal priority");
+    }
+}
+
+// Called on the input thread. Windows belong to the thread that creates them. Without Raw
+// Input no keystroke could be matched, so nothing is captured then.
+bool KeyboardWindows::SetUpCapture()
+{
+    return RegisterRawInput() && InstallHook();
+}
+
+void KeyboardWindows::TearDownCapture()
+{
+    if (m_hHookLibrary != nullptr)
+    {
+        RemoveKeyboardHookProc removeHook = reinterpret_cast<RemoveKeyboardHookProc>(GetProcAddress(m_hHookLibrary, "RemoveKeyboardHook"));
+        if (removeHook != nullptr)
+        {
+            removeHook();
+        }
+        FreeLibrary(m_hHookLibrary);
+        m_hHookLibrary = nullptr;
+    }
+
+    if (m_hRawInputWindow != nullptr)
+    {
+        DestroyWindow(m_hRawInputWindow);
+        m_hRawInputWindow = nullptr;
+    }
+    m_rawKeys.clear();
+}
+
+// Keyboard input is delivered to a message-only window, also while the app is in the
+// background.
+bool KeyboardWindows::RegisterRawInput()
+{
+    WNDCLASS windowClass = {};
+    windowClass.lpfnWndProc = KeyboardWindows::RawInputWindowProc;
+    windowClass.hInstance = GetModuleHandle(nullptr);
+    windowClass.lpszClassName = kRawInputWindowClass;
+    RegisterClass(&windowClass);
+
+    m_hRawInputWindow = CreateWindowEx(0, kRawInputWindowClass, TEXT(""), 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr, windowClass.hInstance, nullptr);
+    if (m_hRawInputWindow == nullptr)
+    {
+        return false;
+    }
+    SetWindowLongPtr(m_hRawInputWindow, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+
+    RAWINPUTDEVICE device = {};
+    device.usUsagePage = 0x01;  // Generic desktop
+    device.usUsage = 0x06;      // Keyboard
+    device.dwFlags = RIDEV_INPUTSINK | RIDEV_DEVNOTIFY;
+    device.hwndTarget = m_hRawInputWindow;
+    return RegisterRawInputDevices(&device, 1, sizeof(device)) != FALSE;
+}
+
+// The DLL is looked for next to the executable first.
+bool KeyboardWindows::InstallHook()
+{
+    // Applications at a lower integrity level may ask too
+    ChangeWindowMessageFilterEx(m_hRawInputWindow, m_hookMessage, MSGFLT_ALLOW, nullptr);
+
+    m_hHookLibrary = LoadLibraryA(kKeyboardHookLibrary);
+    if (m_hHookLibrary == nullptr)
+    {
+        return false;
+    }
+
+    InstallKeyboardHookProc installHook = reinterpret_cast<InstallKeyboardHookProc>(GetProcAddress(m_hHookLibrary, "InstallKeyboardHook"));
+    return installHook != nullptr && installHook(m_hRawInputWindow) != FALSE;
+}
+
+LRESULT CALLBACK KeyboardWindows::RawInputWindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    KeyboardWindows* pThis = reinterpret_cast<KeyboardWindows*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+    if (pThis != nullptr)
+    {
+        if (message == pThis->m_hookMessage)
+        {
+            return pThis->OnHookedKey(wParam, lParam) ? 1 : 0;
+        }
+        else if (message == WM_INPUT)
+        {
+            pThis->OnRawInput(reinterpret_cast<HRAWINPUT>(lParam));
+        }
+        else if (message == WM_INPUT_DEVICE_CHANGE && wParam == GIDC_REMOVAL)
+        {
+            pThis->m_clevyKeyboards.erase(reinterpret_cast<HANDLE>(lParam));
+        }
+    }
+
+    return DefWindowProc(hWnd, message, wParam, lParam);
+}
+
+void KeyboardWindows::OnRawInput(HRAWINPUT hRawInput)
+{
+    RAWINPUT input;
+    UINT size = sizeof(input);
+    if (GetRawInputData(hRawInput, RID_INPUT, &input, &size, sizeof(RAWINPUTHEADER)) == static_cast<UINT>(-1) || input.header.dwType != RIM_TYPEKEYBOARD)
+    {
+        return;
+    }
+
+    const RAWKEYBOARD& keyboard = input.data.keyboard;
+    RawKey key = {};
+    key.vkCode = keyboard.VKey;
+    key.keyCode = keyboard.VKey;
+    key.bKeyUp = (keyboard.Flags & RI_KEY_BREAK) != 0;
+
+    // Keystrokes sent with SendInput() have no device
+    key.bClevy = input.header.hDevice != nullptr && IsClevyKeyboard(input.header.hDevice);
+
+    // Keyboard messages do not tell left and right modifiers apart
+    const bool bRight = (keyboard.Flags & RI_KEY_E0) != 0;
+    switch (keyboard.VKey)
+    {
+    case VK_SHIFT:
+        key.keyCode = MapVirtualKey(keyboard.MakeCode, MAPVK_VSC_TO_VK_EX);
+        break;
+    case VK_CONTROL:
+        key.keyCode = bRight ? VK_RCONTROL : VK_LCONTROL;
+        break;
+    case VK_MENU:
+        key.keyCode = bRight ? VK_RMENU : VK_LMENU;
+        break;
+    }
+
+    m_rawKeys.push_back(key);
+    if (m_rawKeys.size() > kMaxRawKeys)
+    {
+        m_rawKeys.pop_front();
+    }
+}
+
+// The hook asks with a sent message, which is handled before the posted WM_INPUT of the
+// same keystroke, so pending Raw Input is taken in first if needed. A keystroke may be
+// asked about with HC_NOREMOVE first, when an application peeks at it, and is processed
+// only once. Reports before the matching one were not asked about, and are dropped.
+bool KeyboardWindows::OnHookedKey(WPARAM wParam, LPARAM lParam)
+{
+    const USHORT vkCode = LOWORD(wParam);
+    const bool bRemove = static_cast<short>(HIWORD(wParam)) == HC_ACTION;
+    const bool bKeyUp = (lParam & 0x80000000) != 0;
+
+    auto it = FindRawKey(vkCode, bKeyUp);
+    if (it == m_rawKeys.end())
+    {
+        MSG msg;
+        while (PeekMessage(&msg, m_hRawInputWindow, WM_INPUT, WM_INPUT, PM_REMOVE))
+        {
+            DispatchMessage(&msg);
+        }
+        it = FindRawKey(vkCode, bKeyUp);
+        if (it == m_rawKeys.end())
+        {
+            return false;
+        }
+    }
+
+    if (!it->bHandled)
+    {
+        it->bHandled = true;
+        it->bSwallow = it->bClevy && ProcessKeyEvent(bKeyUp ? KeyEventType::KeyUp : KeyEventType::KeyDown, KeyFromKeyCode(it->keyCode));
+    }
+
+    const bool bSwallow = it->bSwallow;
+    if (bRemove)
+    {
+        m_rawKeys.erase(m_rawKeys.begin(), it + 1);
+    }
+    return bSwallow;
+}
+
+std::deque<KeyboardWindows::RawKey>::iterator KeyboardWindows::FindRawKey(USHORT vkCode, bool bKeyUp)
+{
+    return std::find_if(m_rawKeys.begin(), m_rawKeys.end(), [vkCode, bKeyUp](const RawKey& key) {
+        return key.vkCode == vkCode && key.bKeyUp == bKeyUp;
+    });
+}
+
+// Device names look like "\\?\HID#VID_04B4&PID_0101&MI_00#7&1B2C3D&0&0000#{...}".
+bool KeyboardWindows::IsClevyKeyboard(HANDLE hDevice)
+{
+    auto it = m_clevyKeyboards.find(hDevice);
+    if (it != m_clevyKeyboards.end())
+    {
+        return it->second;
+    }
+
+    char name[512] = { 0 };
+    UINT size = sizeof(name);
+    bool bClevy = false;
+    if (GetRawInputDeviceInfoA(hDevice, RIDI_DEVICENAME, name, &size) != static_cast<UINT>(-1))
+    {
+        std::string id(name);
+        std::transform(id.begin(), id.end(), id.begin(), [](unsigned char c){ return static_cast<char>(::toupper(c)); });
+        bClevy = IsSupportedHardwareId(id);
+    }
+    m_clevyKeyboards[hDevice] = bClevy;
+    return bClevy;
 }
 
 bool KeyboardWindows::IsCapsLockActive()
@@ -42,37 +271,12 @@ void KeyboardWindows::SendKeyEvent(KeyEventType eventType, Key key)
     }
 }
 
-LRESULT CALLBACK KeyboardWindows::LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam)
-{
-    KeyboardWindows* pThis = g_pInstance;
-
-    if (nCode == HC_ACTION)
-    {
-        KBDLLHOOKSTRUCT* pData = reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam);
-
-        // Ignore generated keystrokes in order to prevent (infinite) recursion
-        if ((pData->flags & LLKHF_INJECTED) == 0)
-        {
-            KeyEventType eventType = KeyEventTypeFromWParam(wParam);
-            Key key = KeyFromKeyCode(pData->vkCode);
-
-            if (pThis->ProcessKeyEvent(eventType, key))
-            {
-                // Supress this event
-                return 1;
-            }
-        }
-    }
-
-    return CallNextHookEx(pThis->m_hKeyboardHook, nCode, wParam, lParam);
-}
-
 std::string KeyboardWindows::TranslateKeyStroke(Key key, bool shift, bool ctrl)
 {
     int vkCode = KeyCodeFromKey(key);
 
     // Check if keystroke is a dead key/diacritic.
-    // This is needed because ToAscii() modifies the keyboard state and effectively kills diacritics.
+    // This is needed because ToUnicode() modifies the keyboard state and effectively kills diacritics.
     // https://stackoverflow.com/questions/1964614/toascii-tounicode-in-a-keyboard-hook-destroys-dead-keys
     UINT mapped = MapVirtualKey(vkCode, MAPVK_VK_TO_CHAR);
     if (mapped >> (sizeof(UINT) * 8 - 1) & 1)  return std::string();
@@ -83,14 +287,18 @@ std::string KeyboardWindows::TranslateKeyStroke(Key key, bool shift, bool ctrl)
     keyboardState[VK_SHIFT] = shift ? 0xFF : 0x00;
     keyboardState[VK_CONTROL] = ctrl ? 0xFF : 0x00;
 
-    WORD charBuffer[10];
-    ZeroMemory(charBuffer, sizeof(charBuffer));
+    // Flag 0x4 leaves the keyboard state alone, on Windows 10 version 1607 and later.
+    WCHAR charBuffer[10];
+    int count = ToUnicode(vkCode, MapVirtualKey(vkCode, MAPVK_VK_TO_VSC), keyboardState, charBuffer, ARRAYSIZE(charBuffer), 0x4);
+    if (count <= 0)  return std::string();
 
-    // TODO: Use ToUnicode().
-    int result = ToAscii(vkCode, 0, keyboardState, charBuffer, 0);
-    if (result < 0)  return std::string();
+    // The speech buffer holds UTF-8
+    int size = WideCharToMultiByte(CP_UTF8, 0, charBuffer, count, nullptr, 0, nullptr, nullptr);
+    if (size <= 0)  return std::string();
 
-    return std::string(reinterpret_cast<char*>(&charBuffer[0]));
+    std::string result(size, '\0');
+    WideCharToMultiByte(CP_UTF8, 0, charBuffer, count, &result[0], size, nullptr, nullptr);
+    return result;
 }
 
 struct KeyMapping
@@ -205,18 +413,3 @@ int KeyboardWindows::KeyCodeFromKey(Key key)
     }
     return -1;
 }
-
-KeyEventType KeyboardWindows::KeyEventTypeFromWParam(WPARAM wParam)
-{
-    switch (wParam)
-    {
-    case WM_KEYUP:
-    case WM_SYSKEYUP:
-        return KeyEventType::KeyUp;
-    case WM_KEYDOWN:
-    case WM_SYSKEYDOWN:
-        return KeyEventType::KeyDown;
-    default:
-        return KeyEventType::Unknown;
-    }
-}
@@ -7,8 +7,21 @@
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 
+#include <deque>
+#include <map>
+
+#include "InputThread.h"
 #include "Keyboard.h"
 
+// The keyboard hook in DyscoverHook.dll, see KeyboardHook.h, asks for every keystroke that
+// an application takes from its queue whether it is swallowed. Raw Input has reported the
+// keystroke to the window of the input thread by then, with the keyboard it came from, so
+// each keystroke is matched with its Raw Input report, and only the keystrokes of the
+// Clevy Keyboard are processed. Those of other keyboards, and keystrokes sent with
+// SendInput(), which have no keyboard, pass untouched.
+//
+// The window is created on the input thread, whose message loop services it, so that the
+// hook does not wait for the main thread.
 class KeyboardWindows : public Keyboard
 {
 public:
@@ -21,12 +34,40 @@ public:
 
     virtual std::string TranslateKeyStroke(Key key, bool shift, bool ctrl) override;
 
+protected:
+    virtual void StartCapture() override;
+
 private:
-    HHOOK m_hKeyboardHook;
+    // A keystroke reported by Raw Input that no hook has asked about yet
+    struct RawKey
+    {
+        USHORT vkCode;     // As in the keyboard message, e.g. VK_SHIFT
+        int keyCode;       // With left and right told apart, e.g. VK_LSHIFT
+        bool bKeyUp;
+        bool bClevy;
+        bool bHandled;     // Asked about before, with HC_NOREMOVE
+        bool bSwallow;
+    };
+
+    InputThread m_inputThread;
+
+    HWND m_hRawInputWindow;
+    HMODULE m_hHookLibrary;
+    UINT m_hookMessage;
+
+    std::map<HANDLE, bool> m_clevyKeyboards;  // Whether each keyboard is one, by Raw Input handle
+    std::deque<RawKey> m_rawKeys;             // In the order they were reported
 
-    static LRESULT CALLBACK LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam);
+    static LRESULT CALLBACK RawInputWindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
 
-    static KeyEventType KeyEventTypeFromWParam(WPARAM wParam);
+    bool SetUpCapture();
+    void TearDownCapture();
+    bool RegisterRawInput();
+    bool InstallHook();
+    void OnRawInput(HRAWINPUT hRawInput);
+    bool OnHookedKey(WPARAM wParam, LPARAM lParam);
+    std::deque<RawKey>::iterator FindRawKey(USHORT vkCode, bool bKeyUp);
+    bool IsClevyKeyboard(HANDLE hDevice);
 
     static Key KeyFromKeyCode(int keyCode);
     static int KeyCodeFromKey(Key key);
@@ -212,6 +212,8 @@ void PreferencesDialog::OnSoundVolumeChanged(wxCommandEvent&)
 void PreferencesDialog::OnSoundSpeedChanged(wxCommandEvent&)
 {
     m_pConfig->SetSpeed(m_pSoundSpeed->GetValue());
+
+    m_pApp->UpdateSpeechSettings();
 }
 
 wxBEGIN_EVENT_TABLE(PreferencesDialog, wxDialog)
@@ -0,0 +1,96 @@
+//
+// QualityGovernor.cpp
+//
+
+#include "QualityGovernor.h"
+
+struct QualityLevel
+{
+    int quality;         // RSTTS_QUALITY_LOW (0) .. RSTTS_QUALITY_NORMAL (100)
+    int responsiveness;  // RSTTS_RESPONSIVENESS_NORMAL (0) .. RSTTS_RESPONSIVENESS_FAST (100)
+};
+
+static const QualityLevel kLevels[QualityGovernor::kLevelCount] = {
+    { 100, 0 },
+    { 100, 100 },
+    { 75, 100 },
+    { 50, 100 },
+    { 25, 100 },
+    { 0, 100 },
+};
+
+struct PolicyThresholds
+{
+    double stepDownBelow;
+    double stepUpAbove;
+    unsigned stepUpAfter;
+};
+
+static const PolicyThresholds kLatencyThresholds = { 1.5, 3.0, 5 };
+static const PolicyThresholds kQualityThresholds = { 1.1, 2.0, 3 };
+
+QualityGovernor::QualityGovernor(QualityPolicy policy)
+{
+    SetPolicy(policy);
+}
+
+void QualityGovernor::SetPolicy(QualityPolicy policy)
+{
+    m_policy = policy;
+    m_level = GetBestLevel();
+    m_headroomCount = 0;
+}
+
+QualityPolicy QualityGovernor::GetPolicy() const
+{
+    return m_policy;
+}
+
+bool QualityGovernor::Update(double realTimeFactor, QualityDecision& decision)
+{
+    const PolicyThresholds& thresholds = m_policy == QualityPolicy::Quality ? kQualityThresholds : kLatencyThresholds;
+    const size_t level = m_level;
+
+    if (realTimeFactor < thresholds.stepDownBelow) {
+        m_headroomCount = 0;
+        if (m_level + 1 < kLevelCount) m_level++;
+    }
+    else if (realTimeFactor > thresholds.stepUpAbove) {
+        if (++m_headroomCount >= thresholds.stepUpAfter && m_level > GetBestLevel()) {
+            m_level--;
+            m_headroomCount = 0;
+        }
+    }
+    else {
+        m_headroomCount = 0;
+    }
+
+    if (m_level == level) return false;
+
+    decision.level = m_level;
+    decision.quality = GetQuality();
+    decision.responsiveness = GetResponsiveness();
+    decision.realTimeFactor = realTimeFactor;
+    return true;
+}
+
+size_t QualityGovernor::GetLevel() const
+{
+    return m_level;
+}
+
+int QualityGovernor::GetQuality() const
+{
+    return kLevels[m_level].quality;
+}
+
+int QualityGovernor::GetResponsiveness() const
+{
+    return kLevels[m_level].responsiveness;
+}
+
+// The latency policy never gives up the fast responsiveness setting.
+size_t QualityGovernor::GetBestLevel() const
+{
+    return m_policy == QualityPolicy::Quality ? 0 : 1;
+}
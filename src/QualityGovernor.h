@@ -0,0 +1,51 @@
+//
+// QualityGovernor.h
+//
+
+#pragma once
+
+#include <cstddef>
+
+enum class QualityPolicy
+{
+	Latency,  // Keep the engine responsive, give up quality early
+	Quality,  // Keep the best quality for as long as synthesis keeps up
+};
+
+struct QualityDecision
+{
+	size_t level;
+	int quality;          // RSTTS_PARAM_QUALITY_SETTING
+	int responsiveness;   // RSTTS_PARAM_RESPONSIVENESS_SETTING
+	double realTimeFactor;
+};
+
+// Chooses synthesis settings from the measured real-time factor, i.e. the seconds of
+// audio produced per second of synthesis. Steps down to a faster level as soon as
+// synthesis gets close to falling behind playback, and back up only after several
+// measurements in a row show plenty of headroom.
+class QualityGovernor
+{
+public:
+	static const size_t kLevelCount = 6;
+
+	explicit QualityGovernor(QualityPolicy policy = QualityPolicy::Latency);
+
+	// Starts over at the best level the policy allows.
+	void SetPolicy(QualityPolicy policy);
+	QualityPolicy GetPolicy() const;
+
+	// Returns true if the level changed, decision then describes the new level.
+	bool Update(double realTimeFactor, QualityDecision& decision);
+
+	size_t GetLevel() const;
+	int GetQuality() const;
+	int GetResponsiveness() const;
+
+private:
+	QualityPolicy m_policy;
+	size_t m_level;
+	unsigned m_headroomCount;  // Consecutive measurements above the step up threshold
+
+	size_t GetBestLevel() const;
+};
@@ -23,6 +23,16 @@ public:
 		m_condition.notify_all();
 	}
 
+	void Enqueue(T&& value)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_queue.push_back(std::move(value));
+		}
+
+		m_condition.notify_all();
+	}
+
 	T Dequeue()
 	{
 		std::unique_lock<std::mutex> lock(m_mutex);
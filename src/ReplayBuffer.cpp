@@ -0,0 +1,89 @@
+//
+// ReplayBuffer.cpp
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include "ReplayBuffer.h"
+
+ReplayBuffer::ReplayBuffer(size_t capacity, size_t maxClips)
+    : m_maxClips(maxClips), m_end(0), m_clipBegin(0), m_recording(false), m_overflowed(false)
+{
+    m_ring.resize(capacity);
+}
+
+void ReplayBuffer::SetLimits(size_t capacity, size_t maxClips)
+{
+    m_ring.assign(capacity, 0);
+    m_ring.shrink_to_fit();
+    m_clips.clear();
+    m_maxClips = maxClips;
+    m_end = 0;
+    m_recording = false;
+}
+
+void ReplayBuffer::Begin()
+{
+    m_recording = true;
+    m_overflowed = false;
+    m_clipBegin = m_end;
+}
+
+// Clips whose start has been overwritten are evicted, oldest first.
+void ReplayBuffer::Append(const char* data, size_t size)
+{
+    if (!m_recording || m_overflowed || size == 0) return;
+
+    const size_t capacity = m_ring.size();
+    if (m_end - m_clipBegin + size > capacity) {
+        m_overflowed = true;
+        return;
+    }
+
+    size_t pos = m_end % capacity;
+    while (size > 0) {
+        const size_t count = std::min(size, capacity - pos);
+        std::memcpy(&m_ring[pos], data, count);
+        data += count;
+        size -= count;
+        m_end += count;
+        pos = 0;
+    }
+
+    while (!m_clips.empty() && m_clips.front().begin + capacity < m_end) {
+        m_clips.pop_front();
+    }
+}
+
+bool ReplayBuffer::Commit()
+{
+    if (!m_recording) return false;
+    m_recording = false;
+    if (m_overflowed || m_end == m_clipBegin || m_maxClips == 0) return false;
+
+    m_clips.push_back({ m_clipBegin, m_end - m_clipBegin });
+    while (m_clips.size() > m_maxClips) {
+        m_clips.pop_front();
+    }
+    return true;
+}
+
+void ReplayBuffer::Discard()
+{
+    m_recording = false;
+}
+
+bool ReplayBuffer::Get(size_t back, std::vector<char>& audio) const
+{
+    if (back >= m_clips.size()) return false;
+
+    const Clip& clip = m_clips[m_clips.size() - 1 - back];
+    const size_t capacity = m_ring.size();
+    const size_t pos = clip.begin % capacity;
+    const size_t first = std::min(clip.size, capacity - pos);
+    audio.resize(clip.size);
+    std::memcpy(audio.data(), &m_ring[pos], first);
+    std::memcpy(audio.data() + first, m_ring.data(), clip.size - first);
+    return true;
+}
@@ -0,0 +1,52 @@
+//
+// ReplayBuffer.h
+//
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+// Audio of the last few utterances, kept in a ring of fixed size so that they can be
+// played again without synthesizing them. A clip being recorded overwrites the oldest
+// clips as it grows; one that does not fit in the ring at all is dropped.
+class ReplayBuffer
+{
+public:
+	static const size_t kDefaultMaxClips = 5;
+
+	explicit ReplayBuffer(size_t capacity = 0, size_t maxClips = kDefaultMaxClips);
+
+	// Clears the buffer. A capacity of zero disables it.
+	void SetLimits(size_t capacity, size_t maxClips);
+	size_t GetCapacity() const { return m_ring.size(); }
+
+	// Begin() discards a clip that was not committed.
+	void Begin();
+	void Append(const char* data, size_t size);
+	bool Commit();  // Returns false if the clip was empty or did not fit
+	void Discard();
+
+	size_t GetCount() const { return m_clips.size(); }
+
+	// Copies the audio of a clip, back being 0 for the latest one.
+	bool Get(size_t back, std::vector<char>& audio) const;
+
+private:
+	// Positions count the bytes written since the start, the ring holds the last
+	// m_ring.size() of them.
+	struct Clip
+	{
+		size_t begin;
+		size_t size;
+	};
+
+	std::vector<char> m_ring;
+	std::deque<Clip> m_clips;
+	size_t m_maxClips;
+	size_t m_end;
+	size_t m_clipBegin;    // Of the clip being recorded
+	bool m_recording;
+	bool m_overflowed;     // The clip being recorded does not fit
+};
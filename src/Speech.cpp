@@ -2,14 +2,19 @@
 // Speech.cpp
 //
 
+#include <algorithm>
 #include <thread>
 
 #ifdef __BORLANDC__
 #pragma hdrstop
 #endif
 
+#include <librstts_event.h>
+
 #include "Audio.h"
 #include "Speech.h"
+#include "SsmlBuilder.h"
+#include "TextSegmenter.h"
 
 #ifdef  __BORLANDC__
 #pragma package(smart_init)
@@ -19,121 +24,1275 @@ static const int kChannels = 1;
 static const int kSampleRate = 22050;
 static const int kSampleSize = 2;
 
-static const char kLicense[] = "<?xml version=\"1.0\"?>\
-<license version=\"1.0\" licid=\"e73db530bb7c651ea041eca0eb7faba2\" subject=\"rSpeak SDK SuperLicense\">\
-	<issued>2020-09-23</issued>\
-	<licensee>\
-		<company name=\"BNC Distribution\" address=\"Wasaweg 3a, 9723JD Groningen, The Netherlands\"/>\
-		<contact name=\"Bertran van den Hoff\" email=\"bertran.vandenhoff@bnc-distribution.nl\"/>\
-	</licensee>\
-	<product name=\"SDK rSpeak\"/>\
-	<general channels=\"0\" speed=\"5\" textlimit=\"0\" expires=\"-1\"/>\
-	<voice name=\"Ilse\" vendor=\"rSpeak\"/>\
-	<voice name=\"Max\" vendor=\"rSpeak\"/>\
-	<voice name=\"Gina\" vendor=\"rSpeak\"/>\
-	<voice name=\"Veerle\" vendor=\"rSpeak\"/>\
-	<signature id=\"6711250ff810fa1b50fa806f607ecbd66fee09195d42b52727938855daf579f761ae0acad579ffd5fb694c281b2a3665196abf8e1a74d08cfd8474bcd96cd2ec\"/>\
-</license>";
+// Number of chunks of a long text that may be synthesized ahead of playback. The pool
+// renders up to one more chunk per instance.
+static const unsigned kChunksAhead = 2;
+
+// Silence inserted between paragraphs.
+static const int kParagraphPauseMs = 400;
+
+// Utterances shorter than this are not used to measure the real-time factor, since the
+// fixed cost per synthesis call dominates them.
+static const size_t kMinMeasuredBytes = kSampleRate * kChannels * kSampleSize / 2;
+
+// Audio of the selection being read is kept for seeking, up to about this size. Older
+// sentences are dropped beyond it.
+static const size_t kMaxRecordingBytes = static_cast<size_t>(kSampleRate) * kChannels * kSampleSize * 5 * 60;
+
+// Recorded audio is played in pieces of this size, so that a seek requested while paused
+// takes effect soon after resuming.
+static const size_t kRecordedPieceBytes = static_cast<size_t>(kSampleRate) * kChannels * kSampleSize / 4;
+
+// Default size of the audio kept for Replay(), about 45 seconds.
+static const size_t kDefaultReplayBytes = 2 * 1024 * 1024;
+
+// Default memory budget for voices in addition to the main one.
+static const size_t kDefaultVoiceMemoryBudget = 64 * 1024 * 1024;
+
+// Utterance number of letters and words that are spoken while a selection is paused. It
+// is never the number of the latest utterance.
+static const unsigned kInterjection = 0;
+
+// Synthesized without playing it while initializing, to prime the caches of the engine.
+static const char kWarmUpText[] = "Hallo, dit is een test.";
 
 #ifndef __NO_TTS__
-Speech::Speech() : m_rstts(nullptr), m_quit(false) {}
+Speech::Speech() : m_voiceBudget(kDefaultVoiceMemoryBudget), m_quit(false), m_poolSize(0), m_ready(false), m_idleTimeoutMs(0), m_lastActivity(0), m_speed(0.0f), m_pitch(0.0f), m_volume(-1.0f), m_qualityPolicy(QualityPolicy::Latency), m_pauseCount(0), m_rewoundPauseCount(0), m_firstRequested(false), m_firstPlayed(false), m_chunksQueued(0), m_chunksPlayed(0), m_utterance(0), m_nextUtteranceId(0), m_bargeIn(false), m_busy(false), m_readingSelection(false), m_paused(false), m_stopCount(0), m_recordedBytes(0), m_recordingBase(0), m_selectionStart(0), m_receivedOffset(0), m_selectionStopCount(0), m_playingSelection(false), m_playedOffset(0), m_seek(Seek::None), m_replay(kDefaultReplayBytes), m_settingsCount(0) {}
 Speech::~Speech() { Term(); }
 
-bool Speech::Init(const char* basedir, const char* lang, const char* voice)
+// m_pActiveEngine does not own the main engine, hence the aliasing constructor.
+static std::shared_ptr<SpeechEngine> Unowned(SpeechEngine& engine)
 {
-    m_rstts = rsttsInit(basedir);
-    if (m_rstts == nullptr) return false;
+    return std::shared_ptr<SpeechEngine>(std::shared_ptr<SpeechEngine>(), &engine);
+}
 
-    int result = rsttsSetParameter(m_rstts, RSTTS_PARAM_LICENSE_BUFFER, RSTTS_TYPE_STRING, kLicense);
-    if (RSTTS_ERROR(result)) { Term(); return false; }
+std::shared_future<bool> Speech::InitAsync(const char* basedir, const char* lang, const char* voice, size_t poolSize)
+{
+    m_basedir = basedir;
+    m_lang = lang;
+    m_voice = voice;
+    m_poolSize = poolSize;
+    m_readyPromise = std::promise<bool>();
+    std::shared_future<bool> ready = m_readyPromise.get_future().share();
 
-    const int responsiveness = RSTTS_RESPONSIVENESS_FAST;
-    result = rsttsSetParameter(m_rstts, RSTTS_PARAM_RESPONSIVENESS_SETTING, RSTTS_TYPE_INT, &responsiveness);
-    if (RSTTS_ERROR(result)) { Term(); return false; }
+    m_thread = std::thread(&Speech::ThreadProc, this);
+    return ready;
+}
 
-    result = rsttsSetSampleRate(m_rstts, kSampleRate);
-    if (RSTTS_ERROR(result)) { Term(); return false; }
+bool Speech::Init(const char* basedir, const char* lang, const char* voice, size_t poolSize)
+{
+    return InitAsync(basedir, lang, voice, poolSize).get();
+}
 
-    result = rsttsSetLanguage(m_rstts, lang);
-    if (RSTTS_ERROR(result)) { Term(); return false; }
+bool Speech::IsReady()
+{
+    return m_ready;
+}
 
-    result = rsttsSetVoiceByName(m_rstts, voice);
-    if (RSTTS_ERROR(result)) { Term(); return false; }
+// Runs on the speech thread.
+bool Speech::InitEngine()
+{
+    const auto start = std::chrono::steady_clock::now();
 
-    result = rsttsSetAudioCallback(m_rstts, TTSAudioCallback, this);
-    if (RSTTS_ERROR(result)) { Term(); return false; }
+    if (!m_audio.Open(kChannels, kSampleRate, paInt16)) return false;
+    if (!LoadEngine()) return false;
 
-    if (!m_audio.Open(kChannels, kSampleRate, paInt16)) { Term(); return false; }
+    m_playbackThread = std::thread(&Speech::PlaybackThreadProc, this);
 
-    m_thread = std::thread(&Speech::ThreadProc, this);
+    SpeechTimings timings;
+    {
+        std::lock_guard<std::mutex> lock(m_timingsMutex);
+        m_timings.init = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        timings = m_timings;
+    }
+    if (m_timingsListener) m_timingsListener(timings);
+    return true;
+}
+
+// Runs on the speech thread. Loads the TTS instances and warms them up.
+bool Speech::LoadEngine()
+{
+    if (!m_engine.Init(m_basedir.c_str(), m_lang.c_str(), m_voice.c_str(), kSampleRate)) return false;
+
+    // The pool is an optimization only, reading continues on the main instance without it.
+    const size_t cores = std::thread::hardware_concurrency();
+    const size_t poolSize = std::min(m_poolSize, cores > 1 ? cores - 1 : 0);
+    if (poolSize > 0) {
+        m_pool.Init(poolSize, m_basedir.c_str(), m_lang.c_str(), m_voice.c_str(), kSampleRate);
+    }
+
+    m_voices.Configure(m_basedir, kSampleRate, m_voiceBudget);
+    m_voices.Preload();
+    SetActiveEngine(Unowned(m_engine));
+
+    // A first synthesis is much slower than the ones after it, so it is done now, silently.
+    const auto warmUpStart = std::chrono::steady_clock::now();
+    m_engine.Synthesize(kWarmUpText, [](const char*, size_t) {});
+    {
+        std::lock_guard<std::mutex> lock(m_timingsMutex);
+        m_timings.warmUp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - warmUpStart);
+    }
+
+    if (m_governor.GetPolicy() != m_qualityPolicy) m_governor.SetPolicy(m_qualityPolicy);
+    ApplyQuality(0.0);
+
+    // Settings made while not loaded were only stored, see SetSpeed().
+    std::lock_guard<std::mutex> lock(m_engineMutex);
+    m_ready = true;
+    ApplySpeed(m_speed);
+    ApplyPitch(m_pitch);
+    if (m_volume >= 0.0f) ApplyVolume(m_volume);
     return true;
 }
 
+// Runs on the speech thread, while it has no utterance.
+void Speech::UnloadEngine()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_engineMutex);
+        m_ready = false;
+    }
+    SetActiveEngine(Unowned(m_engine));
+    m_voices.Term();
+    m_pool.Term();
+    m_engine.Term();
+
+    // Pre-synthesized words are kept, they are only audio.
+}
+
 void Speech::Term()
 {
     if (m_thread.joinable()) {
         m_quit = true;
-        m_queue.Enqueue("");
+        m_queue.Close();
+        Interrupt();
         m_thread.join();
     }
-    m_audio.Close();
-    if (m_rstts != nullptr) {
-        rsttsFree(m_rstts);
-        m_rstts = nullptr;
+    if (m_playbackThread.joinable()) {
+        m_playback.Enqueue({ BlockType::Quit, 0, 0, {}, nullptr });
+        m_playbackThread.join();
     }
+
+    // Utterances that were not played are finished as cancelled.
+    Block block;
+    while (m_playback.TryDequeue(block)) {}
+    m_pPlaying.reset();
+    m_pSpeaking.reset();
+    m_queue.Clear();
+
+    m_ready = false;
+    m_audio.Close();
+    SetActiveEngine(nullptr);
+    m_voices.Term();
+    m_pool.Term();
+    m_engine.Term();
+}
+
+void Speech::SetTimingsListener(std::function<void(const SpeechTimings&)> listener)
+{
+    m_timingsListener = std::move(listener);
+}
+
+SpeechTimings Speech::GetTimings()
+{
+    std::lock_guard<std::mutex> lock(m_timingsMutex);
+    return m_timings;
 }
 
 float Speech::GetSpeed()
 {
+    std::lock_guard<std::mutex> lock(m_engineMutex);
+    if (!m_ready) return -1.0f;
     float speed = -1.0f;
-    int result = rsttsGetSpeed(m_rstts, &speed);
+    int result = rsttsGetSpeed(m_engine.GetInstance(), &speed);
     return RSTTS_SUCCESS(result) ? speed : -1.0f;
 }
 
 bool Speech::SetSpeed(float value)
 {
-    int result = rsttsSetSpeed(m_rstts, static_cast<float>(RSTTS_SPEED_DEFAULT) + value);
+    if (m_speed.exchange(value) == value) return true;
+    InvalidatePrepared();
+    std::lock_guard<std::mutex> lock(m_engineMutex);
+    if (!m_ready) return true;
+    return ApplySpeed(value);
+}
+
+// The settings below are master controls of the instances, so they also change the
+// utterance being synthesized. Called with m_engineMutex held while m_ready is set.
+bool Speech::ApplySpeed(float value)
+{
+    const float speed = static_cast<float>(RSTTS_SPEED_DEFAULT) + value;
+    m_pool.SetSpeed(speed);
+    m_voices.SetSpeed(speed);
+    std::shared_ptr<SpeechEngine> pEngine = GetActiveEngine();
+    if (pEngine && pEngine.get() != &m_engine) rsttsSetSpeed(pEngine->GetInstance(), speed);
+    int result = rsttsSetSpeed(m_engine.GetInstance(), speed);
+    return RSTTS_SUCCESS(result);
+}
+
+float Speech::GetPitch()
+{
+    std::lock_guard<std::mutex> lock(m_engineMutex);
+    if (!m_ready) return -1.0f;
+    float pitch = -1.0f;
+    int result = rsttsGetPitch(m_engine.GetInstance(), &pitch);
+    return RSTTS_SUCCESS(result) ? pitch : -1.0f;
+}
+
+bool Speech::SetPitch(float value)
+{
+    if (m_pitch.exchange(value) == value) return true;
+    InvalidatePrepared();
+    std::lock_guard<std::mutex> lock(m_engineMutex);
+    if (!m_ready) return true;
+    return ApplyPitch(value);
+}
+
+bool Speech::ApplyPitch(float value)
+{
+    const float pitch = static_cast<float>(RSTTS_PITCH_DEFAULT) + value;
+    m_pool.SetPitch(pitch);
+    m_voices.SetPitch(pitch);
+    std::shared_ptr<SpeechEngine> pEngine = GetActiveEngine();
+    if (pEngine && pEngine.get() != &m_engine) rsttsSetPitch(pEngine->GetInstance(), pitch);
+    int result = rsttsSetPitch(m_engine.GetInstance(), pitch);
     return RSTTS_SUCCESS(result);
 }
 
 float Speech::GetVolume()
 {
+    std::lock_guard<std::mutex> lock(m_engineMutex);
+    if (!m_ready) return -1.0f;
     float volume = -1.0f;
-    int result = rsttsGetVolume(m_rstts, &volume);
+    int result = rsttsGetVolume(m_engine.GetInstance(), &volume);
     return RSTTS_SUCCESS(result) ? volume : -1.0f;
 }
 
 bool Speech::SetVolume(float value)
 {
-    int result = rsttsSetVolume(m_rstts, value);
+    if (m_volume.exchange(value) == value) return true;
+    InvalidatePrepared();
+    std::lock_guard<std::mutex> lock(m_engineMutex);
+    if (!m_ready) return true;
+    return ApplyVolume(value);
+}
+
+bool Speech::ApplyVolume(float value)
+{
+    m_pool.SetVolume(value);
+    m_voices.SetVolume(value);
+    std::shared_ptr<SpeechEngine> pEngine = GetActiveEngine();
+    if (pEngine && pEngine.get() != &m_engine) rsttsSetVolume(pEngine->GetInstance(), value);
+    int result = rsttsSetVolume(m_engine.GetInstance(), value);
     return RSTTS_SUCCESS(result);
 }
 
-void Speech::Speak(std::string text)
+void Speech::SetProsody(SpeechClass cls, const SsmlProsody& prosody)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_prosodyMutex);
+        m_prosody[cls] = prosody;
+    }
+    if (cls == SpeechClass::Sentence) InvalidatePrepared();
+}
+
+SpeechHandle Speech::Speak(std::string text, SpeechClass cls, const std::string& voice)
 {
-    m_queue.Enqueue(text);
+    OnRequest();
+    OnActivity();
+
+    // Interrupting before the utterance is queued means that the speech thread cannot have
+    // started on it yet, so only what was being spoken before is stopped. A paused
+    // selection is kept, the letter or word is spoken in between.
+    const bool interjection = cls == SpeechClass::Letter || cls == SpeechClass::Word;
+    if (m_bargeIn && m_busy && !m_paused && interjection) {
+        Interrupt();
+    }
+    SpeechHandle handle = Enqueue(cls, JobType::Speak, std::move(text), voice);
+
+    // The selection may be paused halfway a chunk, which is finished first, so that the
+    // speech thread gets to WaitForPlayback(). The pool may be rendering that chunk.
+    if (m_paused && interjection) {
+        {
+            std::lock_guard<std::mutex> lock(m_engineMutex);
+            if (m_ready) {
+                GetActiveEngine()->Resume();
+                m_pool.Resume();
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_playbackMutex);
+        }
+        m_playbackCondition.notify_all();
+    }
+    return handle;
+}
+
+SpeechHandle Speech::Enqueue(SpeechClass cls, JobType type, std::string text, const std::string& voice)
+{
+    auto pUtterance = std::make_shared<Utterance>(++m_nextUtteranceId);
+    m_queue.Enqueue(cls, { type, std::move(text), voice, UtteranceTicket(pUtterance) });
+    return SpeechHandle(pUtterance);
+}
+
+void Speech::Prepare(const std::string& sentence)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_preparedMutex);
+        if (m_preparedText == sentence) return;
+        m_preparedText = sentence;
+    }
+    OnActivity();
+    m_queue.Enqueue(SpeechClass::Background, { JobType::Prepare, std::string(), std::string(), UtteranceTicket() });
+}
+
+SpeechHandle Speech::SpeakPrepared(const std::string& sentence)
+{
+    OnRequest();
+    OnActivity();
+    return Enqueue(SpeechClass::Sentence, JobType::SpeakPrepared, sentence, std::string());
 }
 
 void Speech::Stop()
 {
-    if (m_rstts != nullptr) {
-        rsttsStop(m_rstts);
+    m_queue.Clear();
+    Interrupt();
+}
+
+void Speech::SetReplayLimits(size_t bytes, size_t count)
+{
+    std::lock_guard<std::mutex> lock(m_replayMutex);
+    m_replay.SetLimits(bytes, count);
+}
+
+// The audio goes to the playback thread directly, behind only the blocks that Stop()
+// left to be skipped, so no synthesis is involved. It is played as an utterance without
+// tickets, which barge-in stops like any other, and which is not recorded again.
+bool Speech::Replay(size_t back)
+{
+    std::vector<char> audio;
+    {
+        std::lock_guard<std::mutex> lock(m_replayMutex);
+        if (!m_replay.Get(back, audio)) return false;
+    }
+    Stop();
+
+    const unsigned stopCount = m_stopCount;
+    const unsigned utterance = ++m_utterance;
+    auto pGroup = std::make_shared<UtteranceGroup>();
+    m_busy = true;
+    m_playback.Enqueue({ BlockType::UtteranceStart, stopCount, utterance, {}, pGroup });
+    m_playback.Enqueue({ BlockType::Replay, stopCount, 0, std::move(audio), nullptr });
+    m_playback.Enqueue({ BlockType::UtteranceEnd, stopCount, utterance, {}, std::move(pGroup) });
+    return true;
+}
+
+void Speech::AddVoice(const std::string& lang, const std::string& voice)
+{
+    m_voices.AddVoice(lang, voice);
+}
+
+void Speech::SetVoiceMemoryBudget(size_t bytes)
+{
+    m_voiceBudget = bytes;
+}
+
+std::vector<std::string> Speech::GetResidentVoices()
+{
+    return m_voices.GetResidentVoices();
+}
+
+// The playback thread leaves the selection where it is once the device has stopped, and
+// the speech thread stops synthesizing ahead, see WaitForPlayback().
+void Speech::Pause()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_playbackMutex);
+        m_pauseCount++;
+        m_paused = true;
+    }
+    StopAudio();
+    std::lock_guard<std::mutex> lock(m_engineMutex);
+    if (m_ready) {
+        GetActiveEngine()->Pause();
+        m_pool.Pause();
+    }
+}
+
+void Speech::Resume()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_playbackMutex);
+        m_paused = false;
+    }
+    m_playbackCondition.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(m_engineMutex);
+        if (m_ready) {
+            GetActiveEngine()->Resume();
+            m_pool.Resume();
+        }
     }
+    m_playback.Enqueue({ BlockType::Seek, 0, 0, {}, nullptr });
+}
+
+bool Speech::IsPaused()
+{
+    return m_paused;
+}
+
+bool Speech::IsReadingSelection()
+{
+    return m_readingSelection;
+}
+
+void Speech::RepeatSentence()
+{
+    RequestSeek(Seek::Repeat);
+}
+
+void Speech::SkipSentence()
+{
+    RequestSeek(Seek::Skip);
+}
+
+// Playback is stopped right away, unless it is paused, in which case nothing is playing
+// and the seek takes effect when it resumes.
+void Speech::RequestSeek(Seek seek)
+{
+    if (!m_readingSelection) return;
+    m_seek = seek;
+    if (!m_paused) m_audio.Stop();
+    m_playback.Enqueue({ BlockType::Seek, 0, 0, {}, nullptr });
+}
+
+bool Speech::GetSpokenWord(size_t& begin, size_t& end)
+{
+    if (!m_readingSelection) return false;
+
+    TextMark mark;
+    std::lock_guard<std::mutex> lock(m_timelineMutex);
+    if (!m_timeline.Find(TextMarkType::Word, m_playedOffset, mark)) return false;
+    begin = mark.textBegin;
+    end = mark.textEnd;
+    return true;
+}
+
+void Speech::SetBargeIn(bool value)
+{
+    m_bargeIn = value;
+}
+
+SpeechSchedulerStats Speech::GetStats()
+{
+    return m_queue.GetStats();
+}
+
+void Speech::SetIdleTimeout(std::chrono::milliseconds timeout)
+{
+    m_idleTimeoutMs = timeout.count();
+}
+
+// Any pending job loads the instances as well. Background jobs supersede each other, so
+// a Wake job would drop a pending Prepare job instead.
+void Speech::Wake()
+{
+    OnActivity();
+    if (!m_ready && m_idleTimeoutMs > 0 && m_queue.GetDepth() == 0) {
+        m_queue.Enqueue(SpeechClass::Background, { JobType::Wake, std::string(), std::string(), UtteranceTicket() });
+    }
+}
+
+void Speech::OnActivity()
+{
+    m_lastActivity = std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+void Speech::SetQualityPolicy(QualityPolicy policy)
+{
+    m_qualityPolicy = policy;
+}
+
+void Speech::SetQualityListener(std::function<void(const QualityDecision&)> listener)
+{
+    m_qualityListener = std::move(listener);
+}
+
+// Runs on the speech thread, while the main instance is idle.
+void Speech::ApplyQuality(double realTimeFactor)
+{
+    QualityDecision decision{ m_governor.GetLevel(), m_governor.GetQuality(), m_governor.GetResponsiveness(), realTimeFactor };
+    m_engine.SetQuality(decision.quality, decision.responsiveness);
+    m_pool.SetQuality(decision.quality, decision.responsiveness);
+    m_voices.SetQuality(decision.quality, decision.responsiveness);
+    if (m_qualityListener) m_qualityListener(decision);
+}
+
+void Speech::OnRequest()
+{
+    if (m_firstRequested) return;
+
+    std::lock_guard<std::mutex> lock(m_timingsMutex);
+    if (!m_firstRequested) {
+        m_firstRequestTime = std::chrono::steady_clock::now();
+        m_firstRequested = true;
+    }
+}
+
+// Runs on the playback thread.
+void Speech::OnFirstPlayed()
+{
+    SpeechTimings timings;
+    {
+        std::lock_guard<std::mutex> lock(m_timingsMutex);
+        if (!m_firstRequested) return;
+        m_timings.firstUtterance = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_firstRequestTime);
+        timings = m_timings;
+    }
+    m_firstPlayed = true;
+    if (m_timingsListener) m_timingsListener(timings);
+}
+
+// Stops the current utterance. Audio of the utterance that is still queued for playback
+// is skipped. The TTS instances are only signalled to stop, the speech thread and the
+// pool threads wait until they are ready before they synthesize again, so that this can
+// be called from the input thread.
+void Speech::Interrupt()
+{
+    m_stopCount++;
+    m_paused = false;
+    StopAudio();
+    std::unique_lock<std::mutex> lock(m_engineMutex);
+    if (m_ready) {
+        m_pool.Cancel();
+        m_engine.Stop();
+        std::shared_ptr<SpeechEngine> pEngine = GetActiveEngine();
+        if (pEngine && pEngine.get() != &m_engine) pEngine->Stop();
+    }
+    lock.unlock();
+    {
+        std::lock_guard<std::mutex> lock(m_playbackMutex);
+    }
+    m_playbackCondition.notify_all();
+}
+
+// Stopping the device can take a while, and it is called from the keyboard hook, so it is
+// left to the playback thread. A pending write stops by itself, Stop wakes the thread
+// when it is idle while the device still plays what it buffered.
+void Speech::StopAudio()
+{
     m_audio.Stop();
+    m_playback.Enqueue({ BlockType::Stop, 0, 0, {}, nullptr });
 }
 
 void Speech::ThreadProc()
+{
+    const bool ready = InitEngine();
+    m_readyPromise.set_value(ready);
+    if (!ready) return;
+
+    Job job;
+    SpeechClass cls;
+    while (!m_quit && NextJob(job, cls)) {
+        if (m_qualityPolicy != m_governor.GetPolicy()) {
+            m_governor.SetPolicy(m_qualityPolicy);
+            ApplyQuality(0.0);
+        }
+
+        if (job.type == JobType::Prepare) {
+            UpdatePrepared();
+            continue;
+        }
+
+        // The flags are cleared by the playback thread once the utterance has been played.
+        const unsigned utterance = ++m_utterance;
+        if (!BeginUtterance(job.ticket, utterance)) continue;  // Cancelled while queued
+        const unsigned stopCount = m_stopCount;
+        m_pSpeaking = std::make_shared<UtteranceGroup>();
+        m_pSpeaking->push_back(std::move(job.ticket));
+        m_playback.Enqueue({ BlockType::UtteranceStart, stopCount, utterance, {}, m_pSpeaking });
+        m_busy = true;
+        m_readingSelection = cls == SpeechClass::Selection;
+        SelectVoice(job.voice);
+        if (job.type == JobType::Speak && cls != SpeechClass::Selection) {
+            SpeakBatch(cls, job.text, job.voice);
+        }
+        else if (job.type == JobType::Speak) {
+            SpeakChunked(job.text);
+        }
+        else {
+            PlayPrepared(job.text);
+        }
+        m_playback.Enqueue({ BlockType::UtteranceEnd, stopCount, utterance, {}, std::move(m_pSpeaking) });
+
+        // A selection has been played by now, which may have taken longer than the timeout.
+        OnActivity();
+    }
+}
+
+// Runs on the speech thread. Returns false if the utterance was cancelled while queued.
+bool Speech::BeginUtterance(UtteranceTicket& ticket, unsigned utterance)
+{
+    return ticket->Begin([this, utterance]() {
+        if (m_utterance == utterance) Interrupt();
+    });
+}
+
+// Runs on the playback thread. Audio of utterances that were all cancelled is skipped.
+bool Speech::IsPlayingCancelled()
+{
+    if (!m_pPlaying) return false;
+    for (const UtteranceTicket& ticket : *m_pPlaying) {
+        if (!ticket->IsCancelRequested()) return false;
+    }
+    return true;
+}
+
+// Waits for the next job. The instances are unloaded when no job arrived within the idle
+// timeout, and loaded again before the next job is returned. Returns false once the
+// queue is closed.
+bool Speech::NextJob(Job& job, SpeechClass& cls)
+{
+    for (;;) {
+        const std::chrono::milliseconds timeout(m_idleTimeoutMs.load());
+        if (!m_ready || timeout.count() <= 0) {
+            if (!m_queue.Dequeue(job, &cls)) return false;
+        }
+        else {
+            const auto lastActivity = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(m_lastActivity.load()));
+            const auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - lastActivity);
+            if (idle >= timeout) {
+                UnloadEngine();
+                continue;
+            }
+            if (!m_queue.DequeueFor(job, &cls, timeout - idle)) {
+                if (m_queue.IsClosed()) return false;
+                continue;
+            }
+        }
+
+        if (!m_ready) {
+            const auto start = std::chrono::steady_clock::now();
+            if (!LoadEngine()) continue;  // The job is dropped, the next one tries again
+
+            SpeechTimings timings;
+            {
+                std::lock_guard<std::mutex> lock(m_timingsMutex);
+                m_timings.reload = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+                m_timings.reloads++;
+                timings = m_timings;
+            }
+            if (m_timingsListener) m_timingsListener(timings);
+        }
+
+        if (job.type != JobType::Wake) return true;
+    }
+}
+
+void Speech::PlaybackThreadProc()
+{
+    for (;;) {
+        Block block = m_playback.Dequeue();
+        switch (block.type) {
+        case BlockType::Audio:
+            if (IsPlayingCancelled()) break;
+            if (!m_firstPlayed) OnFirstPlayed();
+            if (block.stopCount == m_stopCount && !m_pSuspended) RecordReplay(block.audio);
+            PlayAudio(block.audio, block.stopCount);
+            break;
+        case BlockType::Replay:
+            PlayAudio(block.audio, block.stopCount);
+            break;
+        case BlockType::RecordedAudio:
+            // Kept even when it is not played, to stay in line with the speech thread.
+            m_recording.insert(m_recording.end(), block.audio.begin(), block.audio.end());
+            m_receivedOffset += block.audio.size();
+            if (block.stopCount == m_stopCount && !IsPlayingCancelled()) RecordReplay(block.audio);
+            if (!m_firstPlayed && !IsPlayingCancelled()) OnFirstPlayed();
+            PlayRecorded(block.stopCount);
+            break;
+        case BlockType::SelectionStart:
+            m_selectionStopCount = block.stopCount;
+            StartRecording();
+            break;
+        case BlockType::Seek:
+            m_audio.ApplyStop();
+            PlayRecorded(m_selectionStopCount);
+            break;
+        case BlockType::Stop:
+            m_audio.ApplyStop();
+            break;
+        case BlockType::ChunkEnd:
+            // A chunk of the selection has not been played yet if it was paused.
+            m_chunkEnds.push_back(m_playingSelection ? m_receivedOffset : 0);
+            ReleaseChunks();
+            break;
+        case BlockType::UtteranceStart:
+            if (block.utterance == kInterjection) {
+                m_pSuspended = std::move(m_pPlaying);
+                m_pPlaying = std::move(block.pGroup);
+                m_pPlaying->front()->MarkStarted();
+                break;
+            }
+            m_pPlaying = std::move(block.pGroup);
+            for (const UtteranceTicket& ticket : *m_pPlaying) {
+                ticket->MarkStarted();
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_replayMutex);
+                m_replay.Begin();
+            }
+            break;
+        case BlockType::UtteranceEnd:
+            if (block.utterance == kInterjection) {
+                block.pGroup->front()->Finish(block.stopCount == m_stopCount ? UtteranceState::Done : UtteranceState::Cancelled);
+                m_pPlaying = std::move(m_pSuspended);
+                break;
+            }
+            // The idle timeout counts from the end of playback.
+            OnActivity();
+            if (block.utterance == m_utterance) {
+                m_busy = false;
+                m_readingSelection = false;
+            }
+            m_playingSelection = false;
+            ReleaseChunks(true);
+            {
+                std::lock_guard<std::mutex> lock(m_replayMutex);
+                if (block.stopCount == m_stopCount && !IsPlayingCancelled()) m_replay.Commit();
+                else m_replay.Discard();
+            }
+            for (const UtteranceTicket& ticket : *block.pGroup) {
+                ticket->Finish(block.stopCount == m_stopCount ? UtteranceState::Done : UtteranceState::Cancelled);
+            }
+            m_pPlaying.reset();
+            break;
+        case BlockType::Quit:
+            return;
+        }
+    }
+}
+
+// Synthesizes text one sentence or paragraph at a time. The first chunk is passed to
+// the main TTS instance in place, by terminating it inside the text temporarily instead
+// of copying it, so that reading starts as soon as possible. The pool, if there is one,
+// renders the following chunks in parallel from a single copy of the text.
+void Speech::SpeakChunked(std::string& text)
+{
+    const unsigned stopCount = m_stopCount;
+    m_playback.Enqueue({ BlockType::SelectionStart, stopCount, 0, {}, nullptr });
+
+    std::vector<TextChunk> chunks;
+    TextSegmenter segmenter(text.data(), text.size());
+    TextChunk chunk;
+    while (segmenter.Next(chunk)) {
+        chunks.push_back(chunk);
+    }
+
+    // The pool only has the main voice.
+    const size_t window = kChunksAhead + m_pool.GetSize();
+    const bool parallel = m_pool.GetSize() > 0 && chunks.size() > 1 && GetActiveEngine().get() == &m_engine;
+    if (parallel) {
+        auto pBatch = std::make_shared<SpeechPool::Batch>();
+        pBatch->text.reserve(text.size() + chunks.size());
+        for (size_t i = 1; i < chunks.size(); i++) {
+            pBatch->offsets.push_back(pBatch->text.size());
+            pBatch->text.append(text, chunks[i].begin, chunks[i].end - chunks[i].begin);
+            pBatch->text.push_back('\0');
+        }
+        m_pool.Start(pBatch, window);
+    }
+
+    for (size_t i = 0; i < chunks.size() && WaitForPlayback(stopCount, kChunksAhead - 1); i++) {
+        AddTextMark({ TextMarkType::Sentence, chunks[i].begin, chunks[i].end, m_recordedBytes });
+        if (i == 0 || !parallel) {
+            const char terminator = text[chunks[i].end];
+            text[chunks[i].end] = '\0';
+            Synthesize(text.c_str() + chunks[i].begin, stopCount, "text", chunks[i].begin);
+            text[chunks[i].end] = terminator;
+        }
+        else {
+            std::vector<char> audio;
+            std::vector<TextMark> marks;
+            double seconds = 0.0;
+            if (!m_pool.Take(i - 1, audio, &marks, &seconds)) break;
+            m_pool.SetLimit(i + window);
+            UpdateQuality(audio.size(), seconds);
+            for (TextMark& mark : marks) {
+                mark.textBegin += chunks[i].begin;
+                mark.textEnd += chunks[i].begin;
+                mark.audioOffset += m_recordedBytes;
+                AddTextMark(mark);
+            }
+            QueueRecorded(std::move(audio), stopCount);
+        }
+        EndChunk(chunks[i].paragraph, stopCount);
+    }
+
+    if (parallel) {
+        m_pool.Cancel();
+    }
+
+    // The utterance ends once it has been played, which takes until the end of a pause.
+    WaitForPlayback(stopCount, 0);
+}
+
+// Letters, words and sentences that are pending together, such as the last word and the
+// sentence it completes, are merged into one SSML document and synthesized in one call.
+void Speech::SpeakBatch(SpeechClass cls, const std::string& text, const std::string& voice)
+{
+    // A sentence that was prepared plays without synthesis, the rest is synthesized along.
+    auto batchable = [this, &voice](SpeechClass c, const Job& j) {
+        if (j.type == JobType::SpeakPrepared) return j.voice == voice && !IsPrepared(j.text);
+        return j.type == JobType::Speak && j.voice == voice && c != SpeechClass::Selection && c != SpeechClass::Background;
+    };
+
+    SsmlBuilder ssml;
+    SetUpSsml(ssml);
+    ssml.Add(cls, text);
+
+    Job next;
+    SpeechClass nextClass;
+    while (m_queue.TryDequeueIf(next, &nextClass, batchable)) {
+        if (!BeginUtterance(next.ticket, m_utterance)) continue;
+        ssml.Add(nextClass, next.text);
+        m_pSpeaking->push_back(std::move(next.ticket));
+    }
+
+    const unsigned stopCount = m_stopCount;
+    if (ssml.GetCount() > 1 || ssml.HasProsody(cls)) {
+        Synthesize(ssml.Finish().c_str(), stopCount, "ssml");
+    }
+    else {
+        Synthesize(text.c_str(), stopCount);
+    }
+    EndChunk(false, stopCount);
+}
+
+// Runs on the speech thread. Falls back to the main voice if the voice fails to load.
+void Speech::SelectVoice(const std::string& voice)
+{
+    std::shared_ptr<SpeechEngine> pEngine;
+    if (!voice.empty() && voice != m_voice) {
+        pEngine = m_voices.Acquire(voice);
+    }
+    SetActiveEngine(pEngine ? pEngine : Unowned(m_engine));
+}
+
+// Interrupt() may still use the previous engine while another voice is being selected,
+// the shared pointer keeps it alive until then.
+std::shared_ptr<SpeechEngine> Speech::GetActiveEngine()
+{
+    std::lock_guard<std::mutex> lock(m_activeEngineMutex);
+    return m_pActiveEngine;
+}
+
+void Speech::SetActiveEngine(std::shared_ptr<SpeechEngine> pEngine)
+{
+    std::lock_guard<std::mutex> lock(m_activeEngineMutex);
+    m_pActiveEngine = std::move(pEngine);
+}
+
+void Speech::EndChunk(bool paragraph, unsigned stopCount)
+{
+    // Only selections have paragraphs.
+    if (paragraph) {
+        const size_t size = static_cast<size_t>(kSampleRate) * kParagraphPauseMs / 1000 * kChannels * kSampleSize;
+        QueueRecorded(std::vector<char>(size, 0), stopCount);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_playbackMutex);
+        m_chunksQueued++;
+    }
+    m_playback.Enqueue({ BlockType::ChunkEnd, stopCount, 0, {}, nullptr });
+}
+
+// Runs on the playback thread. Counts the chunks whose audio has been played, or all of
+// them when the utterance has ended.
+void Speech::ReleaseChunks(bool all)
+{
+    unsigned count = 0;
+    while (!m_chunkEnds.empty() && (all || m_chunkEnds.front() <= m_playedOffset)) {
+        m_chunkEnds.pop_front();
+        count++;
+    }
+    if (count == 0) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_playbackMutex);
+        m_chunksPlayed += count;
+    }
+    m_playbackCondition.notify_all();
+}
+
+// Blocks while more than maxPending chunks are waiting to be played, and while paused.
+// Letters and words that come in during a pause are spoken in the meantime. Returns
+// false if the utterance was stopped.
+bool Speech::WaitForPlayback(unsigned stopCount, unsigned maxPending)
+{
+    auto interjection = [](SpeechClass c, const Job& job) {
+        return job.type == JobType::Speak && (c == SpeechClass::Letter || c == SpeechClass::Word);
+    };
+
+    std::unique_lock<std::mutex> lock(m_playbackMutex);
+    for (;;) {
+        if (m_quit || stopCount != m_stopCount) return false;
+        if (!m_paused && m_chunksQueued - m_chunksPlayed <= maxPending) return true;
+
+        // Checked with m_playbackMutex held, so that the notification of Speak() is not missed.
+        Job job;
+        SpeechClass cls;
+        if (m_paused && m_queue.TryDequeueIf(job, &cls, interjection)) {
+            lock.unlock();
+            SpeakInterjection(job, cls);
+            lock.lock();
+            continue;
+        }
+        m_playbackCondition.wait(lock);
+    }
+}
+
+// Runs on the speech thread while a selection is paused. The letter or word is spoken as
+// an utterance of its own, which is played while the selection stays where it is.
+void Speech::SpeakInterjection(Job& job, SpeechClass cls)
+{
+    if (!BeginUtterance(job.ticket, kInterjection)) return;
+    const unsigned stopCount = m_stopCount;
+    auto pGroup = std::make_shared<UtteranceGroup>();
+    pGroup->push_back(std::move(job.ticket));
+    m_playback.Enqueue({ BlockType::UtteranceStart, stopCount, kInterjection, {}, pGroup });
+
+    std::shared_ptr<SpeechEngine> pSelectionEngine = GetActiveEngine();
+    std::shared_ptr<UtteranceGroup> pSelection = std::move(m_pSpeaking);
+    m_pSpeaking = pGroup;
+    SelectVoice(job.voice);
+    const bool ssml = MarkUp(cls, job.text);
+    Synthesize(job.text.c_str(), stopCount, ssml ? "ssml" : "text");
+    SetActiveEngine(std::move(pSelectionEngine));
+    m_pSpeaking = std::move(pSelection);
+
+    m_playback.Enqueue({ BlockType::UtteranceEnd, stopCount, kInterjection, {}, std::move(pGroup) });
+}
+
+// Synthesizes text and queues its audio for playback as it comes in. Unless textOffset is
+// kNotRecorded, the audio is recorded, and the words and sentences reported by the engine
+// are added to the timeline at textOffset in the selection.
+int Speech::Synthesize(const char* text, unsigned stopCount, const char* format, size_t textOffset)
+{
+    const unsigned pauseCount = m_pauseCount;
+    const auto start = std::chrono::steady_clock::now();
+    const size_t audioOffset = m_recordedBytes;
+    size_t bytes = 0;
+
+    std::chrono::steady_clock::time_point textStart, textEnd;
+    const SpeechEngine::EventSink events = [this, textOffset, audioOffset, &textStart, &textEnd](const RSTTSEventData& event) {
+        TextMark mark;
+        if (event.eventtype == RSTTSEvent_TextStart) textStart = std::chrono::steady_clock::now();
+        else if (event.eventtype == RSTTSEvent_TextEnd) textEnd = std::chrono::steady_clock::now();
+        else if (textOffset != kNotRecorded && SpeechEngine::GetTextMark(event, mark)) {
+            mark.textBegin += textOffset;
+            mark.textEnd += textOffset;
+            mark.audioOffset += audioOffset;
+            AddTextMark(mark);
+        }
+    };
+
+    int result = GetActiveEngine()->Synthesize(text, [this, stopCount, textOffset, &bytes](const char* data, size_t size) {
+        bytes += size;
+        if (textOffset != kNotRecorded) {
+            QueueRecorded(std::vector<char>(data, data + size), stopCount);
+        }
+        else {
+            m_playback.Enqueue({ BlockType::Audio, stopCount, 0, std::vector<char>(data, data + size), nullptr });
+        }
+    }, format, &events);
+
+    for (const UtteranceTicket& ticket : *m_pSpeaking) {
+        ticket->SetSynthesisTimes(textStart, textEnd);
+        if (RSTTS_ERROR(result) && stopCount == m_stopCount) ticket->MarkFailed();
+    }
+
+    // Stopped or paused synthesis says nothing about the speed of the engine.
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (stopCount == m_stopCount && pauseCount == m_pauseCount) {
+        UpdateQuality(bytes, seconds);
+    }
+    return result;
+}
+
+// Runs on the speech thread. Measures the speed of the main instance, or of one in the
+// pool, from a synthesis of bytes of audio that took seconds.
+void Speech::UpdateQuality(size_t bytes, double seconds)
+{
+    if (bytes < kMinMeasuredBytes || seconds <= 0.0) return;
+
+    const double realTimeFactor = static_cast<double>(bytes) / (kSampleRate * kChannels * kSampleSize) / seconds;
+    QualityDecision decision;
+    if (m_governor.Update(realTimeFactor, decision)) {
+        ApplyQuality(realTimeFactor);
+    }
+}
+
+// Returns whether the synthesis ran to its end. Events stop coming once the instance is
+// stopped, so a synthesis that was cut off does not see SynthesizeEnd.
+bool Speech::SynthesizeTo(const std::string& text, std::vector<char>& audio)
+{
+    bool ended = false;
+    const SpeechEngine::EventSink events = [&ended](const RSTTSEventData& event) {
+        if (event.eventtype == RSTTSEvent_SynthesizeEnd) ended = RSTTS_SUCCESS(event.evtspec.SynthesizeEnd->rstts_statuscode);
+    };
+    std::string document = text;
+    const bool ssml = MarkUp(SpeechClass::Sentence, document);
+    int result = m_engine.Synthesize(document.c_str(), [&audio](const char* data, size_t size) {
+        audio.insert(audio.end(), data, data + size);
+    }, ssml ? "ssml" : "text", &events);
+    return RSTTS_SUCCESS(result) && ended;
+}
+
+// The end of the clause of sentence that starts at pos, including the spaces after it, or
+// npos while it has not been completed. Clauses end in a comma, semicolon or colon that is
+// followed by a space, where the sentence pauses anyway.
+static size_t FindClauseEnd(const std::string& sentence, size_t pos)
+{
+    for (size_t i = sentence.find_first_of(",;:", pos); i != std::string::npos; i = sentence.find_first_of(",;:", i + 1)) {
+        if (i + 1 < sentence.size() && sentence[i + 1] == ' ') {
+            const size_t end = sentence.find_first_not_of(' ', i + 1);
+            return end == std::string::npos ? sentence.size() : end;
+        }
+    }
+    return std::string::npos;
+}
+
+// Brings m_prepared in line with the latest prepared sentence. It is prepared a clause at
+// a time, so that each is spoken with its own intonation and the segments are joined where
+// the sentence pauses. Segments are kept up to the first one that no longer matches (e.g.
+// after Backspace), only the clauses after that point are synthesized again. The last
+// clause is synthesized along with the end of the sentence.
+void Speech::UpdatePrepared()
 {
     while (!m_quit) {
-        std::string text = m_queue.Dequeue();
-        rsttsSynthesize(m_rstts, text.c_str(), "text");
+        std::string sentence;
+        {
+            std::lock_guard<std::mutex> lock(m_preparedMutex);
+            sentence = m_preparedText;
+        }
+
+        size_t pos = 0;
+        auto it = m_prepared.begin();
+        while (it != m_prepared.end() && IsPrepared(*it, sentence, pos)) {
+            pos += it->text.size();
+            ++it;
+        }
+        m_prepared.erase(it, m_prepared.end());
+
+        const size_t end = FindClauseEnd(sentence, pos);
+        if (end == std::string::npos) return;
+
+        // Utterances that came in meanwhile go first, the rest is prepared after them.
+        if (m_queue.GetDepth() > 0) {
+            m_queue.Enqueue(SpeechClass::Background, { JobType::Prepare, std::string(), std::string(), UtteranceTicket() });
+            return;
+        }
+
+        const unsigned stopCount = m_stopCount;
+        Segment segment{ sentence.substr(pos, end - pos), {}, m_settingsCount };
+        const bool complete = SynthesizeTo(segment.text, segment.audio);
+
+        // Audio that Stop() cut off is not kept, the clause is synthesized again when the
+        // sentence is spoken.
+        if (!complete || stopCount != m_stopCount) return;
+
+        // Drop the result if the sentence was edited before this point in the meantime.
+        std::lock_guard<std::mutex> lock(m_preparedMutex);
+        if (m_preparedText.compare(0, end, sentence, 0, end) == 0) {
+            m_prepared.push_back(std::move(segment));
+        }
     }
 }
 
-void Speech::TTSAudioCallback(RSTTSInst inst, const void* audiodata, size_t audiodatalen, void* userptr)
+// Runs on the speech thread. Whether audio of the start of sentence was prepared.
+bool Speech::IsPrepared(const std::string& sentence)
+{
+    return !m_prepared.empty() && IsPrepared(m_prepared.front(), sentence, 0);
+}
+
+// Whether segment is the audio of sentence at pos, as it sounds with the current settings.
+bool Speech::IsPrepared(const Segment& segment, const std::string& sentence, size_t pos)
+{
+    return segment.settingsCount == m_settingsCount && sentence.compare(pos, segment.text.size(), segment.text) == 0;
+}
+
+// Called when the speed, pitch or volume changes. The audio that was prepared is dropped
+// by the speech thread, which synthesizes it again.
+void Speech::InvalidatePrepared()
 {
-    (void)inst;
-    Speech* pThis = (Speech*)userptr;
-    pThis->m_audio.Write(audiodata, static_cast<unsigned long>(audiodatalen / kSampleSize));
+    m_settingsCount++;
+    m_queue.Enqueue(SpeechClass::Background, { JobType::Prepare, std::string(), std::string(), UtteranceTicket() });
 }
+
+void Speech::PlayPrepared(const std::string& sentence)
+{
+    const unsigned stopCount = m_stopCount;
+
+    size_t pos = 0;
+    auto it = m_prepared.begin();
+    while (it != m_prepared.end() && IsPrepared(*it, sentence, pos)) {
+        m_playback.Enqueue({ BlockType::Audio, stopCount, 0, std::move(it->audio), nullptr });
+        pos += it->text.size();
+        ++it;
+    }
+    m_prepared.erase(m_prepared.begin(), it);
+
+    // Whatever was not prepared in time is synthesized now.
+    if (pos < sentence.size() && stopCount == m_stopCount) {
+        std::string rest = sentence.substr(pos);
+        const bool ssml = MarkUp(SpeechClass::Sentence, rest);
+        Synthesize(rest.c_str(), stopCount, ssml ? "ssml" : "text");
+    }
+    EndChunk(false, stopCount);
+}
+
+void Speech::SetUpSsml(SsmlBuilder& ssml)
+{
+    std::lock_guard<std::mutex> lock(m_prosodyMutex);
+    for (const auto& prosody : m_prosody) {
+        ssml.SetProsody(prosody.first, prosody.second);
+    }
+}
+
+// Puts text in an SSML document if its class has a prosody of its own. Returns whether it
+// did, so that it is synthesized as SSML.
+bool Speech::MarkUp(SpeechClass cls, std::string& text)
+{
+    SsmlBuilder ssml;
+    SetUpSsml(ssml);
+    if (!ssml.HasProsody(cls)) return false;
+    ssml.Add(cls, text);
+    text = ssml.Finish();
+    return true;
+}
+
+void Speech::AddTextMark(const TextMark& mark)
+{
+    std::lock_guard<std::mutex> lock(m_timelineMutex);
+    m_timeline.Add(mark);
+}
+
+void Speech::QueueRecorded(std::vector<char> audio, unsigned stopCount)
+{
+    m_recordedBytes += audio.size();
+    m_playback.Enqueue({ BlockType::RecordedAudio, stopCount, 0, std::move(audio), nullptr });
+}
+
+// Runs on the playback thread. All recorded audio before the selection has been received
+// by now, so the selection starts at the end of it.
+void Speech::StartRecording()
+{
+    m_recording.clear();
+    m_recordingBase = m_receivedOffset;
+    m_selectionStart = m_receivedOffset;
+    m_playedOffset = m_receivedOffset;
+    m_playingSelection = true;
+    m_seek = Seek::None;
+
+    std::lock_guard<std::mutex> lock(m_timelineMutex);
+    m_timeline.DropBefore(m_selectionStart);
+}
+
+// Runs on the playback thread. Plays the recording from the played offset up to the audio
+// received so far, applying seek requests in between.
+void Speech::PlayRecorded(unsigned stopCount)
+{
+    unsigned failures = 0;
+    while (m_playingSelection) {
+        const Seek seek = m_seek.exchange(Seek::None);
+        if (seek != Seek::None) ApplySeek(seek);
+
+        const size_t played = m_playedOffset;
+        if (stopCount != m_stopCount || IsPlayingCancelled()) {
+            m_playedOffset = std::max(played, m_receivedOffset);
+            break;
+        }
+        if (m_paused) {
+            RewindPaused();
+            break;
+        }
+        if (played >= m_receivedOffset) break;
+
+        const size_t size = std::min(m_receivedOffset - played, kRecordedPieceBytes);
+        unsigned long frames = 0;
+        const bool complete = m_audio.Write(&m_recording[played - m_recordingBase], static_cast<unsigned long>(size / kSampleSize), &frames);
+        m_playedOffset = played + frames * kSampleSize;
+        if (m_paused) {
+            RewindPaused();
+            break;
+        }
+
+        // A write is also stopped by a seek request that was applied before it started.
+        // Only one that keeps failing without a seek means that the device failed.
+        if (complete || frames > 0 || m_seek != Seek::None) {
+            failures = 0;
+        }
+        else if (++failures > 1 && stopCount == m_stopCount) {
+            m_playedOffset = m_receivedOffset;
+            break;
+        }
+    }
+    ReleaseChunks();
+    TrimRecording();
+}
+
+// Pause() dropped the audio that the device had buffered, which is played again when
+// reading resumes. Done once per pause.
+void Speech::RewindPaused()
+{
+    const unsigned pauseCount = m_pauseCount;
+    if (pauseCount == m_rewoundPauseCount) return;
+    m_rewoundPauseCount = pauseCount;
+
+    const size_t buffered = std::min(static_cast<size_t>(m_audio.GetOutputLatency() * kSampleRate) * kChannels * kSampleSize, m_playedOffset.load());
+    m_playedOffset = std::max(m_playedOffset - buffered, std::max(m_selectionStart, m_recordingBase));
+}
+
+// A skip past the audio received so far continues once it arrives.
+void Speech::ApplySeek(Seek seek)
+{
+    const size_t played = m_playedOffset;
+    size_t target = played;
+    {
+        std::lock_guard<std::mutex> lock(m_timelineMutex);
+        if (seek == Seek::Repeat) m_timeline.GetRepeatOffset(played, target);
+        else m_timeline.GetSkipOffset(played, target);
+    }
+    m_playedOffset = std::max(target, std::max(m_selectionStart, m_recordingBase));
+}
+
+// Drops the oldest part of the recording when it exceeds kMaxRecordingBytes, but keeps the
+// sentence being played, so that it can still be repeated.
+void Speech::TrimRecording()
+{
+    if (m_recording.size() <= kMaxRecordingBytes) return;
+
+    std::lock_guard<std::mutex> lock(m_timelineMutex);
+    size_t keep = m_playedOffset;
+    m_timeline.GetRepeatOffset(keep, keep, 0);
+    const size_t drop = std::min(m_recording.size() / 2, keep > m_recordingBase ? keep - m_recordingBase : 0);
+    m_recording.erase(m_recording.begin(), m_recording.begin() + drop);
+    m_recordingBase += drop;
+    m_timeline.DropBefore(m_recordingBase);
+}
+
+void Speech::RecordReplay(const std::vector<char>& audio)
+{
+    std::lock_guard<std::mutex> lock(m_replayMutex);
+    m_replay.Append(audio.data(), audio.size());
+}
+
+void Speech::PlayAudio(const std::vector<char>& audio, unsigned stopCount)
+{
+    if (stopCount != m_stopCount) return;
+    m_audio.Write(audio.data(), static_cast<unsigned long>(audio.size() / kSampleSize));
+}
+
 #endif
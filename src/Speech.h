@@ -4,15 +4,41 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
+
+#include "Audio.h"
+#include "QualityGovernor.h"
+#include "Queue.h"
+#include "ReplayBuffer.h"
+#include "SpeechHandle.h"
+#include "SpeechScheduler.h"
+#include "SsmlBuilder.h"
+#include "TextTimeline.h"
 
 #ifndef __NO_TTS__
-#include <librstts.h>
+#include "SpeechEngine.h"
+#include "SpeechPool.h"
+#include "VoicePool.h"
 #endif
 
-#include "Audio.h"
-#include "Queue.h"
+struct SpeechTimings
+{
+	std::chrono::milliseconds init{ -1 };            // Until the engine was ready, including the warm-up
+	std::chrono::milliseconds warmUp{ -1 };
+	std::chrono::milliseconds firstUtterance{ -1 };  // From the first utterance request until its audio was played
+	std::chrono::milliseconds reload{ -1 };          // Last reload after the engine was unloaded while idle
+	unsigned long reloads = 0;
+};
 
 #ifndef __NO_TTS__
 class Speech
@@ -21,28 +47,274 @@ public:
 	Speech();
 	~Speech();
 
-	bool Init(const char* basedir, const char* lang, const char* voice);
+	// Loads the voice, opens audio and warms up the engine on the speech thread. Utterances
+	// requested before the returned future is ready are queued. poolSize is the number of
+	// additional TTS instances that render long texts in parallel.
+	std::shared_future<bool> InitAsync(const char* basedir, const char* lang, const char* voice, size_t poolSize = 0);
+	bool Init(const char* basedir, const char* lang, const char* voice, size_t poolSize = 0);
+	bool IsReady();
 	void Term();
 
+	// Called on a speech thread when initialization has finished, and again when the first
+	// utterance starts playing.
+	void SetTimingsListener(std::function<void(const SpeechTimings&)> listener);
+	SpeechTimings GetTimings();
+
+	// Speed and pitch are offsets from the engine defaults. The settings are only passed
+	// to the engine when they change, and take effect on the utterance being spoken.
+	// Sentence audio prepared with the previous settings is synthesized again.
 	float GetSpeed();
 	bool SetSpeed(float value);
 
+	float GetPitch();
+	bool SetPitch(float value);
+
 	float GetVolume();
 	bool SetVolume(float value);
 
-	void Speak(std::string text);
+	// Letters, words and sentences can have a rate and pitch of their own, relative to the
+	// speed and pitch above. Utterances of such a class are synthesized as SSML.
+	void SetProsody(SpeechClass cls, const SsmlProsody& prosody);
+
+	// voice selects one of the voices added with AddVoice(), the main voice when empty.
+	// The handle tells when the utterance starts and finishes, and cancels only this one.
+	// Pending letters, words and sentences are synthesized in one batch, though, and
+	// cancelling one of those while it is spoken stops the batch, which finishes all of
+	// its utterances as cancelled.
+	SpeechHandle Speak(std::string text, SpeechClass cls, const std::string& voice = std::string());
+
+	// Returns without waiting for the TTS instances to stop, so it can be called from the
+	// input thread.
 	void Stop();
 
+	// The audio of the last utterances that were played completely is kept, up to the
+	// given size in bytes and number of utterances. Replay() stops what is being spoken
+	// and plays one of them again, back being 0 for the latest one.
+	void SetReplayLimits(size_t bytes, size_t count);
+	bool Replay(size_t back = 0);
+
+	// Additional voices are preloaded during initialization for as long as they fit in
+	// the memory budget, the others are loaded when first used.
+	void AddVoice(const std::string& lang, const std::string& voice);
+	void SetVoiceMemoryBudget(size_t bytes);
+	std::vector<std::string> GetResidentVoices();
+
+	// Pausing a selection silences it right away, and keeps the synthesis state and any
+	// audio not yet played, so that Resume() continues where reading left off. Letters
+	// and words that are typed meanwhile are spoken during the pause. Stop() also ends
+	// a pause.
+	void Pause();
+	void Resume();
+	bool IsPaused();
+	bool IsReadingSelection();
+
+	// While a selection is read, RepeatSentence() goes back to the start of the sentence
+	// being spoken, or of the previous one when it has only just started, and
+	// SkipSentence() continues with the next one. Both play audio that was already
+	// synthesized. GetSpokenWord() returns the position of the word being spoken in the
+	// selection, in bytes.
+	void RepeatSentence();
+	void SkipSentence();
+	bool GetSpokenWord(size_t& begin, size_t& end);
+
+	// When enabled, a new letter or word interrupts whatever is being spoken.
+	void SetBargeIn(bool value);
+
+	SpeechSchedulerStats GetStats();
+
+	// The TTS instances are freed after timeout without utterances, to release the memory
+	// of the voice data, and are loaded again for the next utterance. Zero disables this.
+	// Wake() marks user activity: it postpones unloading, and reloads ahead of time when
+	// the instances were freed, so that the next utterance does not wait for it.
+	void SetIdleTimeout(std::chrono::milliseconds timeout);
+	void Wake();
+
+	// The synthesis quality is lowered when the engine has trouble keeping up with
+	// playback, and raised again when it has headroom. The policy sets the trade-off.
+	// The listener is called on the speech thread for every change.
+	void SetQualityPolicy(QualityPolicy policy);
+	void SetQualityListener(std::function<void(const QualityDecision&)> listener);
+
+	// Sentence pre-synthesis. Prepare() is called whenever the sentence being typed
+	// changes; its completed clauses are synthesized in the background, so that
+	// SpeakPrepared() only has to synthesize the last one when the sentence is finished.
+	// A sentence of which nothing was prepared yet is synthesized in one go with the
+	// words queued before it.
+	void Prepare(const std::string& sentence);
+	SpeechHandle SpeakPrepared(const std::string& sentence);
+
 private:
-	Queue<std::string> m_queue;
+	enum class JobType { Speak, Prepare, SpeakPrepared, Wake };
+
+	struct Job
+	{
+		JobType type;
+		std::string text;
+		std::string voice;
+		UtteranceTicket ticket;  // Only for Speak and SpeakPrepared
+	};
+
+	// Utterances synthesized together, e.g. a batch of words and sentences.
+	typedef std::vector<UtteranceTicket> UtteranceGroup;
+
+	struct Segment
+	{
+		std::string text;
+		std::vector<char> audio;
+		unsigned settingsCount;  // Value of m_settingsCount when it was synthesized
+	};
+
+	// RecordedAudio is audio of the selection being read, which the playback thread keeps
+	// so that it can seek in it. SelectionStart precedes it, Seek wakes up the playback
+	// thread for a seek request or to resume, Stop to silence the device.
+	enum class BlockType { Audio, RecordedAudio, SelectionStart, Seek, Stop, Replay, ChunkEnd, UtteranceStart, UtteranceEnd, Quit };
+
+	enum class Seek { None, Repeat, Skip };
+
+	// Passed to Synthesize() for audio that is not recorded.
+	static const size_t kNotRecorded = static_cast<size_t>(-1);
+
+	// Unit of work for the playback thread. Audio blocks are moved through the queue.
+	struct Block
+	{
+		BlockType type;
+		unsigned stopCount;   // Value of m_stopCount when the audio was synthesized
+		unsigned utterance;   // Sequence number of the utterance, for UtteranceEnd
+		std::vector<char> audio;
+		std::shared_ptr<UtteranceGroup> pGroup;  // For UtteranceStart and UtteranceEnd
+	};
+
+	SpeechScheduler<Job> m_queue;
 	std::thread m_thread;
-	RSTTSInst m_rstts;
+	SpeechEngine m_engine;              // Main voice
+	SpeechPool m_pool;
+	VoicePool m_voices;
+	std::atomic<size_t> m_voiceBudget;
+	std::mutex m_activeEngineMutex;
+	std::shared_ptr<SpeechEngine> m_pActiveEngine;  // Engine of the current utterance, guarded by m_activeEngineMutex
 	Audio m_audio;
-	bool m_quit;  // Used to signalize thread to exit
+	std::atomic<bool> m_quit;  // Used to signalize threads to exit
+
+	std::string m_basedir;
+	std::string m_lang;
+	std::string m_voice;
+	size_t m_poolSize;
+	std::promise<bool> m_readyPromise;
+	std::mutex m_engineMutex;       // Held by other threads while they use the instances, see UnloadEngine()
+	std::atomic<bool> m_ready;      // Set while the instances are loaded, guarded by m_engineMutex
+	std::atomic<long long> m_idleTimeoutMs;
+	std::atomic<long long> m_lastActivity;  // steady_clock ticks of the last request
+	std::atomic<float> m_speed;     // Applied when the engine becomes ready
+	std::atomic<float> m_pitch;
+	std::atomic<float> m_volume;
+	std::mutex m_prosodyMutex;
+	std::map<SpeechClass, SsmlProsody> m_prosody;  // Guarded by m_prosodyMutex
+
+	std::mutex m_timingsMutex;
+	SpeechTimings m_timings;
+	std::function<void(const SpeechTimings&)> m_timingsListener;
+	QualityGovernor m_governor;     // Owned by the speech thread
+	std::atomic<QualityPolicy> m_qualityPolicy;
+	std::function<void(const QualityDecision&)> m_qualityListener;
+	std::atomic<unsigned> m_pauseCount;
+	unsigned m_rewoundPauseCount;   // Owned by the playback thread, see RewindPaused()
+
+	std::atomic<bool> m_firstRequested;
+	std::chrono::steady_clock::time_point m_firstRequestTime;
+	bool m_firstPlayed;             // Owned by the playback thread
+
+	// Synthesis runs ahead of playback by at most kChunksAhead chunks, so that reading a
+	// large selection starts after its first sentence and memory use stays bounded.
+	Queue<Block> m_playback;
+	std::thread m_playbackThread;
+	std::mutex m_playbackMutex;
+	std::condition_variable m_playbackCondition;
+	unsigned m_chunksQueued;            // Guarded by m_playbackMutex
+	unsigned m_chunksPlayed;            // Guarded by m_playbackMutex
+	std::atomic<unsigned> m_utterance;  // Sequence number of the latest foreground utterance
+	std::atomic<unsigned> m_nextUtteranceId;
+	std::shared_ptr<UtteranceGroup> m_pSpeaking;  // Owned by the speech thread
+	std::shared_ptr<UtteranceGroup> m_pPlaying;   // Owned by the playback thread
+	std::shared_ptr<UtteranceGroup> m_pSuspended; // The paused selection while a letter or word is played
+	std::deque<size_t> m_chunkEnds;               // Offsets of chunks not yet played, see ReleaseChunks()
+
+	std::atomic<bool> m_bargeIn;
+	std::atomic<bool> m_busy;           // Set while a foreground utterance is being spoken
+	std::atomic<bool> m_readingSelection;
+	std::atomic<bool> m_paused;
+	std::atomic<unsigned> m_stopCount;  // Incremented by Interrupt() to abandon the current utterance
+
+	// Offsets in the recording count the bytes of recorded audio since the start, on the
+	// speech thread as it is synthesized and on the playback thread as it is played, so
+	// that both agree on where text marks are without sharing the audio.
+	std::mutex m_timelineMutex;
+	TextTimeline m_timeline;           // Guarded by m_timelineMutex
+	size_t m_recordedBytes;            // Owned by the speech thread
+	std::vector<char> m_recording;     // Owned by the playback thread, like the offsets below
+	size_t m_recordingBase;            // Offset of m_recording[0]
+	size_t m_selectionStart;           // Offset where the selection being played starts
+	size_t m_receivedOffset;           // End of the recorded audio received so far
+	unsigned m_selectionStopCount;
+	bool m_playingSelection;
+	std::atomic<size_t> m_playedOffset;
+	std::atomic<Seek> m_seek;
+
+	std::mutex m_replayMutex;
+	ReplayBuffer m_replay;             // Recorded by the playback thread, guarded by m_replayMutex
+
+	std::mutex m_preparedMutex;
+	std::string m_preparedText;         // Latest sentence passed to Prepare(), guarded by m_preparedMutex
+	std::vector<Segment> m_prepared;    // Synthesized clauses of m_preparedText, owned by the speech thread
+	std::atomic<unsigned> m_settingsCount;  // Incremented when prepared audio no longer sounds as it should
 
 	void ThreadProc();
+	bool InitEngine();
+	bool LoadEngine();
+	void UnloadEngine();
+	bool NextJob(Job& job, SpeechClass& cls);
+	void OnActivity();
+	void PlaybackThreadProc();
+	SpeechHandle Enqueue(SpeechClass cls, JobType type, std::string text, const std::string& voice);
+	bool BeginUtterance(UtteranceTicket& ticket, unsigned utterance);
+	bool IsPlayingCancelled();
+	void OnRequest();
+	bool ApplySpeed(float value);
+	bool ApplyPitch(float value);
+	bool ApplyVolume(float value);
+	void UpdateQuality(size_t bytes, double seconds);
+	void ApplyQuality(double realTimeFactor);
+	void OnFirstPlayed();
+	void Interrupt();
+	void StopAudio();
+	void RequestSeek(Seek seek);
+	void AddTextMark(const TextMark& mark);
+	void QueueRecorded(std::vector<char> audio, unsigned stopCount);
+	void StartRecording();
+	void PlayRecorded(unsigned stopCount);
+	void ApplySeek(Seek seek);
+	void RewindPaused();
+	void TrimRecording();
+	void RecordReplay(const std::vector<char>& audio);
 
-	static void TTSAudioCallback(RSTTSInst, const void*, size_t, void*);
+	int Synthesize(const char* text, unsigned stopCount, const char* format = "text", size_t textOffset = kNotRecorded);
+	bool SynthesizeTo(const std::string& text, std::vector<char>& audio);
+	void SpeakChunked(std::string& text);
+	void SpeakBatch(SpeechClass cls, const std::string& text, const std::string& voice);
+	void SelectVoice(const std::string& voice);
+	std::shared_ptr<SpeechEngine> GetActiveEngine();
+	void SetActiveEngine(std::shared_ptr<SpeechEngine> pEngine);
+	void UpdatePrepared();
+	bool IsPrepared(const std::string& sentence);
+	bool IsPrepared(const Segment& segment, const std::string& sentence, size_t pos);
+	void InvalidatePrepared();
+	void PlayPrepared(const std::string& sentence);
+	void PlayAudio(const std::vector<char>& audio, unsigned stopCount);
+	void EndChunk(bool paragraph, unsigned stopCount);
+	void ReleaseChunks(bool all = false);
+	bool WaitForPlayback(unsigned stopCount, unsigned maxPending);
+	void SpeakInterjection(Job& job, SpeechClass cls);
+	void SetUpSsml(SsmlBuilder& ssml);
+	bool MarkUp(SpeechClass cls, std::string& text);
 };
 #else
 // Stubbed Speech implementation when librstts is disabled.
@@ -51,13 +323,40 @@ class Speech
 public:
 	Speech() {}
 	~Speech() {}
-	bool Init(const char*, const char*, const char*) { return false; }
+	std::shared_future<bool> InitAsync(const char*, const char*, const char*, size_t = 0) { std::promise<bool> ready; ready.set_value(false); return ready.get_future().share(); }
+	bool Init(const char*, const char*, const char*, size_t = 0) { return false; }
+	bool IsReady() { return false; }
 	void Term() {}
+	void SetTimingsListener(std::function<void(const SpeechTimings&)>) {}
+	SpeechTimings GetTimings() { return SpeechTimings(); }
 	float GetSpeed() { return -1.0f; }
 	bool SetSpeed(float) { return false; }
+	float GetPitch() { return -1.0f; }
+	bool SetPitch(float) { return false; }
 	float GetVolume() { return -1.0f; }
 	bool SetVolume(float) { return false; }
-	void Speak(std::string) {}
+	void SetProsody(SpeechClass, const SsmlProsody&) {}
+	SpeechHandle Speak(std::string, SpeechClass, const std::string& = std::string()) { return SpeechHandle(); }
 	void Stop() {}
+	void SetReplayLimits(size_t, size_t) {}
+	bool Replay(size_t = 0) { return false; }
+	void AddVoice(const std::string&, const std::string&) {}
+	void SetVoiceMemoryBudget(size_t) {}
+	std::vector<std::string> GetResidentVoices() { return std::vector<std::string>(); }
+	void Pause() {}
+	void Resume() {}
+	bool IsPaused() { return false; }
+	bool IsReadingSelection() { return false; }
+	void RepeatSentence() {}
+	void SkipSentence() {}
+	bool GetSpokenWord(size_t&, size_t&) { return false; }
+	void SetBargeIn(bool) {}
+	SpeechSchedulerStats GetStats() { return SpeechSchedulerStats(); }
+	void SetIdleTimeout(std::chrono::milliseconds) {}
+	void Wake() {}
+	void SetQualityPolicy(QualityPolicy) {}
+	void SetQualityListener(std::function<void(const QualityDecision&)>) {}
+	void Prepare(const std::string&) {}
+	SpeechHandle SpeakPrepared(const std::string&) { return SpeechHandle(); }
 };
 #endif
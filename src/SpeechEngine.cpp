@@ -0,0 +1,203 @@
+//
+// SpeechEngine.cpp
+//
+
+#include <chrono>
+
+#ifdef __BORLANDC__
+#pragma hdrstop
+#endif
+
+#include <librstts_event.h>
+
+#include "SpeechEngine.h"
+
+#ifdef  __BORLANDC__
+#pragma package(smart_init)
+#endif
+
+// Upper bound for waiting on a state change of the TTS instance, e.g. after rsttsStop().
+static const int kStateTimeoutMs = 500;
+
+// The SynthesizeEnd event is not sent when synthesis is stopped, so Synthesize() also
+// polls the instance state at this interval while waiting.
+static const std::chrono::milliseconds kStatePollInterval(20);
+
+static const char kLicense[] = "<?xml version=\"1.0\"?>\
+<license version=\"1.0\" licid=\"e73db530bb7c651ea041eca0eb7faba2\" subject=\"rSpeak SDK SuperLicense\">\
+	<issued>2020-09-23</issued>\
+	<licensee>\
+		<company name=\"BNC Distribution\" address=\"Wasaweg 3a, 9723JD Groningen, The Netherlands\"/>\
+		<contact name=\"Bertran van den Hoff\" email=\"bertran.vandenhoff@bnc-distribution.nl\"/>\
+	</licensee>\
+	<product name=\"SDK rSpeak\"/>\
+	<general channels=\"0\" speed=\"5\" textlimit=\"0\" expires=\"-1\"/>\
+	<voice name=\"Ilse\" vendor=\"rSpeak\"/>\
+	<voice name=\"Max\" vendor=\"rSpeak\"/>\
+	<voice name=\"Gina\" vendor=\"rSpeak\"/>\
+	<voice name=\"Veerle\" vendor=\"rSpeak\"/>\
+	<signature id=\"6711250ff810fa1b50fa806f607ecbd66fee09195d42b52727938855daf579f761ae0acad579ffd5fb694c281b2a3665196abf8e1a74d08cfd8474bcd96cd2ec\"/>\
+</license>";
+
+#ifndef __NO_TTS__
+SpeechEngine::SpeechEngine() : m_rstts(nullptr), m_stopCount(0), m_synthesisStopCount(0), m_ended(false), m_result(RSTTS_OK), m_pSink(nullptr), m_pEvents(nullptr) {}
+SpeechEngine::~SpeechEngine() { Term(); }
+
+bool SpeechEngine::Init(const char* basedir, const char* lang, const char* voice, int sampleRate)
+{
+    m_rstts = rsttsInit(basedir);
+    if (m_rstts == nullptr) return false;
+
+    int result = rsttsSetParameter(m_rstts, RSTTS_PARAM_LICENSE_BUFFER, RSTTS_TYPE_STRING, kLicense);
+    if (RSTTS_ERROR(result)) { Term(); return false; }
+
+    const int responsiveness = RSTTS_RESPONSIVENESS_FAST;
+    result = rsttsSetParameter(m_rstts, RSTTS_PARAM_RESPONSIVENESS_SETTING, RSTTS_TYPE_INT, &responsiveness);
+    if (RSTTS_ERROR(result)) { Term(); return false; }
+
+    result = rsttsSetSampleRate(m_rstts, sampleRate);
+    if (RSTTS_ERROR(result)) { Term(); return false; }
+
+    result = rsttsSetLanguage(m_rstts, lang);
+    if (RSTTS_ERROR(result)) { Term(); return false; }
+
+    result = rsttsSetVoiceByName(m_rstts, voice);
+    if (RSTTS_ERROR(result)) { Term(); return false; }
+
+    result = rsttsSetAudioCallback(m_rstts, TTSAudioCallback, this);
+    if (RSTTS_ERROR(result)) { Term(); return false; }
+
+    const int eventMask = RSTTSEvent_SynthesizeEnd | RSTTSEvent_TextStart | RSTTSEvent_TextEnd | RSTTSEvent_Word | RSTTSEvent_Sentence;
+    result = rsttsSetParameter(m_rstts, RSTTS_PARAM_EVENT_MASK, RSTTS_TYPE_INT, &eventMask);
+    if (RSTTS_ERROR(result)) { Term(); return false; }
+
+    // Word and sentence events carry their text positions only with tracking enabled.
+    result = rsttsSetParameter(m_rstts, RSTTS_PARAM_TEXT_POSITION_TRACKING, RSTTS_TYPE_BOOL, RSTTS_PARAMVAL_TRUE);
+    if (RSTTS_ERROR(result)) { Term(); return false; }
+
+    result = rsttsSetEventCallback(m_rstts, TTSEventCallback, this);
+    if (RSTTS_ERROR(result)) { Term(); return false; }
+
+    return true;
+}
+
+void SpeechEngine::Term()
+{
+    if (m_rstts != nullptr) {
+        Stop();
+        rsttsWaitState(m_rstts, RSTTSInst_ready, kStateTimeoutMs);
+        rsttsFree(m_rstts);
+        m_rstts = nullptr;
+    }
+}
+
+// Waits for a stop to complete first, since Stop() does not.
+bool SpeechEngine::SetQuality(int quality, int responsiveness)
+{
+    rsttsWaitState(m_rstts, RSTTSInst_ready, kStateTimeoutMs);
+
+    int result = rsttsSetParameter(m_rstts, RSTTS_PARAM_QUALITY_SETTING, RSTTS_TYPE_INT, &quality);
+    if (RSTTS_ERROR(result)) return false;
+
+    result = rsttsSetParameter(m_rstts, RSTTS_PARAM_RESPONSIVENESS_SETTING, RSTTS_TYPE_INT, &responsiveness);
+    return RSTTS_SUCCESS(result);
+}
+
+int SpeechEngine::Synthesize(const char* text, const AudioSink& sink, const char* format, const EventSink* pEvents)
+{
+    rsttsWaitState(m_rstts, RSTTSInst_ready, kStateTimeoutMs);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ended = false;
+        m_result = RSTTS_OK;
+        m_pSink = &sink;
+        m_pEvents = pEvents;
+        m_synthesisStopCount = m_stopCount.load();
+    }
+
+    int result = rsttsSynthesizeAsync(m_rstts, text, format);
+    if (RSTTS_ERROR(result)) return result;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_ended) {
+        if (m_condition.wait_for(lock, kStatePollInterval) == std::cv_status::timeout || m_synthesisStopCount != m_stopCount) {
+            // The audio callback takes m_mutex, so it is not held while calling into the engine.
+            lock.unlock();
+            const bool ready = rsttsGetState(m_rstts) == RSTTSInst_ready;
+            lock.lock();
+            if (ready) break;
+        }
+    }
+    m_pSink = nullptr;
+    m_pEvents = nullptr;
+    return m_result;
+}
+
+bool SpeechEngine::GetTextMark(const RSTTSEventData& event, TextMark& mark)
+{
+    if (event.eventtype != RSTTSEvent_Word && event.eventtype != RSTTSEvent_Sentence) return false;
+    if (event.text_pos_start < 0 || event.byte_pos < 0) return false;
+
+    mark.type = event.eventtype == RSTTSEvent_Word ? TextMarkType::Word : TextMarkType::Sentence;
+    mark.textBegin = static_cast<size_t>(event.text_pos_start);
+    mark.textEnd = event.text_pos_end >= event.text_pos_start ? static_cast<size_t>(event.text_pos_end) : mark.textBegin;
+    mark.audioOffset = static_cast<size_t>(event.byte_pos);
+    return true;
+}
+
+// Only signals the instance, so that stopping several of them takes no longer than
+// stopping one, and a thread that must stay responsive can do it. The thread that uses
+// the instance next waits until it is ready, see Synthesize().
+void SpeechEngine::Stop()
+{
+    m_stopCount++;
+    if (m_rstts != nullptr) {
+        rsttsStop(m_rstts);
+    }
+    m_condition.notify_all();
+}
+
+void SpeechEngine::Pause()
+{
+    if (m_rstts != nullptr && rsttsGetState(m_rstts) == RSTTSInst_playing) {
+        rsttsPause(m_rstts);
+    }
+}
+
+void SpeechEngine::Resume()
+{
+    if (m_rstts != nullptr && rsttsGetState(m_rstts) == RSTTSInst_paused) {
+        rsttsResume(m_rstts);
+    }
+}
+
+void SpeechEngine::TTSAudioCallback(RSTTSInst inst, const void* audiodata, size_t audiodatalen, void* userptr)
+{
+    (void)inst;
+    SpeechEngine* pThis = (SpeechEngine*)userptr;
+    std::lock_guard<std::mutex> lock(pThis->m_mutex);
+    if (pThis->m_synthesisStopCount != pThis->m_stopCount || pThis->m_pSink == nullptr) return;
+    (*pThis->m_pSink)(static_cast<const char*>(audiodata), audiodatalen);
+}
+
+void SpeechEngine::TTSEventCallback(RSTTSInst inst, const RSTTSEventData* eventdata, void* userptr)
+{
+    (void)inst;
+    SpeechEngine* pThis = (SpeechEngine*)userptr;
+    {
+        std::lock_guard<std::mutex> lock(pThis->m_mutex);
+        if (pThis->m_synthesisStopCount == pThis->m_stopCount && pThis->m_pEvents != nullptr) {
+            (*pThis->m_pEvents)(*eventdata);
+        }
+    }
+    if (eventdata->eventtype == RSTTSEvent_SynthesizeEnd) {
+        {
+            std::lock_guard<std::mutex> lock(pThis->m_mutex);
+            pThis->m_ended = true;
+            pThis->m_result = eventdata->evtspec.SynthesizeEnd->rstts_statuscode;
+        }
+        pThis->m_condition.notify_all();
+    }
+}
+#endif
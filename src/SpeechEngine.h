@@ -0,0 +1,63 @@
+//
+// SpeechEngine.h
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+#include <librstts.h>
+
+#include "TextTimeline.h"
+
+// A single librstts instance. Synthesize() runs the synthesis asynchronously and blocks
+// until it is done, or until the instance has stopped after Stop() was called from
+// another thread. Stop() itself does not wait.
+class SpeechEngine
+{
+public:
+	typedef std::function<void(const char* data, size_t size)> AudioSink;
+	typedef std::function<void(const RSTTSEventData& event)> EventSink;
+
+	SpeechEngine();
+	~SpeechEngine();
+
+	bool Init(const char* basedir, const char* lang, const char* voice, int sampleRate);
+	void Term();
+
+	RSTTSInst GetInstance() { return m_rstts; }
+
+	// Must not be called while synthesizing.
+	bool SetQuality(int quality, int responsiveness);
+
+	// Audio is passed to sink on a thread of the engine. Audio that is still delivered
+	// after Stop() is discarded. format is "text" or "ssml". The TextStart, TextEnd,
+	// Word, Sentence and SynthesizeEnd events are passed to pEvents, if given, on the
+	// same thread.
+	int Synthesize(const char* text, const AudioSink& sink, const char* format = "text", const EventSink* pEvents = nullptr);
+
+	// Converts a Word or Sentence event. Positions are relative to the text and the audio
+	// of the synthesis that reported the event.
+	static bool GetTextMark(const RSTTSEventData& event, TextMark& mark);
+	void Stop();
+	void Pause();
+	void Resume();
+
+private:
+	RSTTSInst m_rstts;
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::atomic<unsigned> m_stopCount;           // Incremented by Stop()
+	std::atomic<unsigned> m_synthesisStopCount;  // Value of m_stopCount when the current synthesis started
+	bool m_ended;
+	int m_result;
+	const AudioSink* m_pSink;
+	const EventSink* m_pEvents;
+
+	static void TTSAudioCallback(RSTTSInst, const void*, size_t, void*);
+	static void TTSEventCallback(RSTTSInst, const RSTTSEventData*, void*);
+};
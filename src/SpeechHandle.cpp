@@ -0,0 +1,179 @@
+//
+// SpeechHandle.cpp
+//
+
+#include "SpeechHandle.h"
+
+Utterance::Utterance(unsigned id)
+    : m_id(id), m_state(UtteranceState::Queued), m_cancelRequested(false), m_failed(false), m_future(m_promise.get_future().share())
+{
+    m_times.requested = std::chrono::steady_clock::now();
+}
+
+UtteranceState Utterance::GetState()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_state;
+}
+
+UtteranceTimes Utterance::GetTimes()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_times;
+}
+
+bool Utterance::IsFinished()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_state != UtteranceState::Queued && m_state != UtteranceState::Speaking;
+}
+
+bool Utterance::IsCancelRequested()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_cancelRequested;
+}
+
+void Utterance::OnFinished(Listener listener)
+{
+    if (!AddListener(listener)) listener(GetState());
+}
+
+bool Utterance::AddListener(Listener listener)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_state != UtteranceState::Queued && m_state != UtteranceState::Speaking) return false;
+    m_listeners.push_back(std::move(listener));
+    return true;
+}
+
+// The handler is called without m_mutex held, since stopping the utterance may finish
+// it, or others whose listeners cancel this one, on another thread that waits for it.
+void Utterance::Cancel()
+{
+    bool speaking;
+    std::function<void()> cancelHandler;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancelRequested = true;
+        speaking = m_state == UtteranceState::Speaking;
+        if (speaking) cancelHandler = m_cancelHandler;
+    }
+
+    if (!speaking) Finish(UtteranceState::Cancelled);
+    else if (cancelHandler) cancelHandler();
+}
+
+bool Utterance::Begin(std::function<void()> cancelHandler)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_state != UtteranceState::Queued) return false;
+    m_state = UtteranceState::Speaking;
+    m_cancelHandler = std::move(cancelHandler);
+    return true;
+}
+
+// Long texts are synthesized in several calls, so the first start and the last end count.
+void Utterance::SetSynthesisTimes(std::chrono::steady_clock::time_point started, std::chrono::steady_clock::time_point ended)
+{
+    const std::chrono::steady_clock::time_point none;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_times.synthesisStarted == none) m_times.synthesisStarted = started;
+    if (ended != none) m_times.synthesisEnded = ended;
+}
+
+void Utterance::MarkStarted()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_times.started == std::chrono::steady_clock::time_point()) {
+        m_times.started = std::chrono::steady_clock::now();
+    }
+}
+
+void Utterance::MarkFailed()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_failed = true;
+}
+
+// Only the first call has an effect. A requested cancel or a reported failure takes
+// precedence over state.
+void Utterance::Finish(UtteranceState state)
+{
+    std::vector<Listener> listeners;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_state != UtteranceState::Queued && m_state != UtteranceState::Speaking) return;
+        if (m_cancelRequested) state = UtteranceState::Cancelled;
+        else if (m_failed) state = UtteranceState::Failed;
+
+        m_state = state;
+        m_times.ended = std::chrono::steady_clock::now();
+        m_cancelHandler = nullptr;
+        listeners.swap(m_listeners);
+    }
+
+    m_promise.set_value(state);
+    for (const Listener& listener : listeners) {
+        listener(state);
+    }
+}
+
+UtteranceTicket& UtteranceTicket::operator=(UtteranceTicket&& other) noexcept
+{
+    if (this != &other) {
+        if (m_pUtterance) m_pUtterance->Finish(UtteranceState::Cancelled);
+        m_pUtterance = std::move(other.m_pUtterance);
+    }
+    return *this;
+}
+
+UtteranceTicket::~UtteranceTicket()
+{
+    if (m_pUtterance) m_pUtterance->Finish(UtteranceState::Cancelled);
+}
+
+UtteranceState SpeechHandle::GetState() const
+{
+    return m_pUtterance ? m_pUtterance->GetState() : UtteranceState::Cancelled;
+}
+
+UtteranceTimes SpeechHandle::GetTimes() const
+{
+    return m_pUtterance ? m_pUtterance->GetTimes() : UtteranceTimes();
+}
+
+bool SpeechHandle::IsFinished() const
+{
+    return !m_pUtterance || m_pUtterance->IsFinished();
+}
+
+UtteranceState SpeechHandle::Wait() const
+{
+    return m_pUtterance ? m_pUtterance->GetFuture().get() : UtteranceState::Cancelled;
+}
+
+bool SpeechHandle::WaitFor(std::chrono::milliseconds timeout) const
+{
+    return !m_pUtterance || m_pUtterance->GetFuture().wait_for(timeout) == std::future_status::ready;
+}
+
+std::shared_future<UtteranceState> SpeechHandle::GetFuture() const
+{
+    if (m_pUtterance) return m_pUtterance->GetFuture();
+
+    std::promise<UtteranceState> cancelled;
+    cancelled.set_value(UtteranceState::Cancelled);
+    return cancelled.get_future().share();
+}
+
+void SpeechHandle::OnFinished(Utterance::Listener listener) const
+{
+    if (m_pUtterance) m_pUtterance->OnFinished(std::move(listener));
+    else listener(UtteranceState::Cancelled);
+}
+
+void SpeechHandle::Cancel() const
+{
+    if (m_pUtterance) m_pUtterance->Cancel();
+}
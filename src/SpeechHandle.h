@@ -0,0 +1,149 @@
+//
+// SpeechHandle.h
+//
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define SPEECH_HANDLE_COROUTINES
+#endif
+
+enum class UtteranceState
+{
+	Queued,
+	Speaking,   // Synthesis has started
+	Done,       // All of its audio has been played
+	Cancelled,  // Cancelled, stopped, or superseded by a newer utterance before it was spoken
+	Failed,     // The engine reported an error
+};
+
+// A default constructed time point means that the event has not happened yet.
+struct UtteranceTimes
+{
+	std::chrono::steady_clock::time_point requested;
+	std::chrono::steady_clock::time_point synthesisStarted;  // TextStart event of the engine
+	std::chrono::steady_clock::time_point synthesisEnded;    // TextEnd event of the engine
+	std::chrono::steady_clock::time_point started;           // Its audio started playing
+	std::chrono::steady_clock::time_point ended;             // Finished, in whatever state
+};
+
+// State of one utterance, shared between Speech and the handles to it. Listeners are
+// called on the thread that finishes the utterance, usually the playback thread.
+class Utterance
+{
+public:
+	typedef std::function<void(UtteranceState)> Listener;
+
+	explicit Utterance(unsigned id);
+
+	unsigned GetId() const { return m_id; }
+	UtteranceState GetState();
+	UtteranceTimes GetTimes();
+	bool IsFinished();
+	bool IsCancelRequested();
+	std::shared_future<UtteranceState> GetFuture() { return m_future; }
+
+	// Calls listener when the utterance finishes, or right away when it has finished.
+	void OnFinished(Listener listener);
+
+	// Like OnFinished(), but returns false instead of calling listener when the utterance
+	// has already finished.
+	bool AddListener(Listener listener);
+
+	// An utterance that is still queued is finished right away, one that is being spoken
+	// is stopped through the cancel handler, which may stop others along with it.
+	void Cancel();
+
+	// Used by Speech. Begin() returns false if the utterance was cancelled while queued.
+	// cancelHandler is called without the state locked, and may still be called after
+	// the utterance has finished.
+	bool Begin(std::function<void()> cancelHandler);
+	void SetSynthesisTimes(std::chrono::steady_clock::time_point started, std::chrono::steady_clock::time_point ended);
+	void MarkStarted();
+	void MarkFailed();
+	void Finish(UtteranceState state);
+
+private:
+	const unsigned m_id;
+	std::mutex m_mutex;
+	UtteranceState m_state;
+	UtteranceTimes m_times;
+	bool m_cancelRequested;
+	bool m_failed;
+	std::function<void()> m_cancelHandler;  // Set while speaking, cleared by Finish()
+	std::vector<Listener> m_listeners;
+	std::promise<UtteranceState> m_promise;
+	std::shared_future<UtteranceState> m_future;
+};
+
+// Reference to an utterance held by Speech while the utterance is pending. Dropping the
+// ticket before the utterance has finished, e.g. when a newer utterance supersedes it in
+// the queue, finishes it as cancelled.
+class UtteranceTicket
+{
+public:
+	UtteranceTicket() {}
+	explicit UtteranceTicket(std::shared_ptr<Utterance> pUtterance) : m_pUtterance(std::move(pUtterance)) {}
+	UtteranceTicket(UtteranceTicket&& other) noexcept : m_pUtterance(std::move(other.m_pUtterance)) {}
+	UtteranceTicket& operator=(UtteranceTicket&& other) noexcept;
+	~UtteranceTicket();
+
+	UtteranceTicket(const UtteranceTicket&) = delete;
+	UtteranceTicket& operator=(const UtteranceTicket&) = delete;
+
+	const std::shared_ptr<Utterance>& Get() const { return m_pUtterance; }
+	Utterance* operator->() const { return m_pUtterance.get(); }
+	explicit operator bool() const { return m_pUtterance != nullptr; }
+
+private:
+	std::shared_ptr<Utterance> m_pUtterance;
+};
+
+// Returned by Speech::Speak(). Cheap to copy; a default constructed handle refers to no
+// utterance and behaves like a cancelled one.
+class SpeechHandle
+{
+public:
+	SpeechHandle() {}
+	explicit SpeechHandle(std::shared_ptr<Utterance> pUtterance) : m_pUtterance(std::move(pUtterance)) {}
+
+	bool IsValid() const { return m_pUtterance != nullptr; }
+	unsigned GetId() const { return m_pUtterance ? m_pUtterance->GetId() : 0; }
+	UtteranceState GetState() const;
+	UtteranceTimes GetTimes() const;
+	bool IsFinished() const;
+
+	UtteranceState Wait() const;
+	bool WaitFor(std::chrono::milliseconds timeout) const;
+	std::shared_future<UtteranceState> GetFuture() const;
+	void OnFinished(Utterance::Listener listener) const;
+	void Cancel() const;
+
+#ifdef SPEECH_HANDLE_COROUTINES
+	// co_await on a handle resumes the coroutine on the thread that finished the utterance.
+	struct Awaiter
+	{
+		std::shared_ptr<Utterance> pUtterance;
+
+		bool await_ready() const { return !pUtterance || pUtterance->IsFinished(); }
+		bool await_suspend(std::coroutine_handle<> coroutine) const
+		{
+			return pUtterance->AddListener([coroutine](UtteranceState) { coroutine.resume(); });
+		}
+		UtteranceState await_resume() const { return pUtterance ? pUtterance->GetState() : UtteranceState::Cancelled; }
+	};
+
+	Awaiter operator co_await() const { return Awaiter{ m_pUtterance }; }
+#endif
+
+private:
+	std::shared_ptr<Utterance> m_pUtterance;
+};
@@ -0,0 +1,206 @@
+//
+// SpeechPool.cpp
+//
+
+#include <chrono>
+
+#include "SpeechPool.h"
+
+#ifndef __NO_TTS__
+SpeechPool::SpeechPool() : m_next(0), m_limit(0), m_generation(0), m_quit(false), m_paused(false), m_pauseCount(0), m_quality(-1), m_responsiveness(-1) {}
+SpeechPool::~SpeechPool() { Term(); }
+
+bool SpeechPool::Init(size_t size, const char* basedir, const char* lang, const char* voice, int sampleRate)
+{
+    for (size_t i = 0; i < size; i++) {
+        std::unique_ptr<SpeechEngine> pEngine(new SpeechEngine());
+        if (!pEngine->Init(basedir, lang, voice, sampleRate)) { Term(); return false; }
+        m_engines.push_back(std::move(pEngine));
+    }
+
+    m_quit = false;
+    for (auto& pEngine : m_engines) {
+        m_threads.emplace_back(&SpeechPool::ThreadProc, this, pEngine.get());
+    }
+    return true;
+}
+
+void SpeechPool::Term()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    Cancel();
+
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+    m_threads.clear();
+    m_engines.clear();
+}
+
+size_t SpeechPool::GetSize()
+{
+    return m_engines.size();
+}
+
+void SpeechPool::SetSpeed(float value)
+{
+    for (auto& pEngine : m_engines) {
+        rsttsSetSpeed(pEngine->GetInstance(), value);
+    }
+}
+
+void SpeechPool::SetPitch(float value)
+{
+    for (auto& pEngine : m_engines) {
+        rsttsSetPitch(pEngine->GetInstance(), value);
+    }
+}
+
+void SpeechPool::SetVolume(float value)
+{
+    for (auto& pEngine : m_engines) {
+        rsttsSetVolume(pEngine->GetInstance(), value);
+    }
+}
+
+void SpeechPool::SetQuality(int quality, int responsiveness)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_quality = quality;
+    m_responsiveness = responsiveness;
+}
+
+void SpeechPool::Start(std::shared_ptr<const Batch> pBatch, size_t limit)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_generation++;
+        m_clips.assign(pBatch->offsets.size(), Clip());
+        m_ready.assign(pBatch->offsets.size(), false);
+        m_pBatch = std::move(pBatch);
+        m_next = 0;
+        m_limit = limit;
+    }
+    m_condition.notify_all();
+}
+
+void SpeechPool::SetLimit(size_t limit)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_limit = limit;
+    }
+    m_condition.notify_all();
+}
+
+bool SpeechPool::Take(size_t index, std::vector<char>& audio, std::vector<TextMark>* pMarks, double* pSeconds)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const unsigned generation = m_generation;
+    m_condition.wait(lock, [&] {
+        return generation != m_generation || index >= m_ready.size() || m_ready[index];
+    });
+    if (generation != m_generation || index >= m_ready.size()) return false;
+
+    audio = std::move(m_clips[index].audio);
+    if (pMarks != nullptr) *pMarks = std::move(m_clips[index].marks);
+    if (pSeconds != nullptr) *pSeconds = m_clips[index].seconds;
+    return true;
+}
+
+// Drops the current batch without waiting. Chunks that are being rendered are stopped,
+// the batch text itself is kept alive by the rendering threads until they are done with
+// it.
+void SpeechPool::Cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_generation++;
+        m_pBatch.reset();
+        m_clips.clear();
+        m_ready.clear();
+        m_next = 0;
+        m_limit = 0;
+        m_paused = false;
+    }
+    m_condition.notify_all();
+
+    for (auto& pEngine : m_engines) {
+        pEngine->Stop();
+    }
+}
+
+void SpeechPool::Pause()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_paused = true;
+        m_pauseCount++;
+    }
+    for (auto& pEngine : m_engines) {
+        pEngine->Pause();
+    }
+}
+
+void SpeechPool::Resume()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_paused = false;
+    }
+    m_condition.notify_all();
+
+    for (auto& pEngine : m_engines) {
+        pEngine->Resume();
+    }
+}
+
+void SpeechPool::ThreadProc(SpeechEngine* pEngine)
+{
+    int quality = -1;
+    int responsiveness = -1;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_condition.wait(lock, [&] {
+            return m_quit || (!m_paused && m_pBatch && m_next < m_limit && m_next < m_ready.size());
+        });
+        if (m_quit) return;
+
+        const size_t index = m_next++;
+        const unsigned generation = m_generation;
+        const unsigned pauseCount = m_pauseCount;
+        std::shared_ptr<const Batch> pBatch = m_pBatch;
+        const bool qualityChanged = m_quality != quality || m_responsiveness != responsiveness;
+        quality = m_quality;
+        responsiveness = m_responsiveness;
+        lock.unlock();
+
+        if (qualityChanged && quality >= 0) {
+            pEngine->SetQuality(quality, responsiveness);
+        }
+
+        Clip clip;
+        const auto start = std::chrono::steady_clock::now();
+        const SpeechEngine::EventSink events = [&clip](const RSTTSEventData& event) {
+            TextMark mark;
+            if (SpeechEngine::GetTextMark(event, mark)) clip.marks.push_back(mark);
+        };
+        pEngine->Synthesize(pBatch->text.c_str() + pBatch->offsets[index], [&clip](const char* data, size_t size) {
+            clip.audio.insert(clip.audio.end(), data, data + size);
+        }, "text", &events);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        lock.lock();
+        if (pauseCount == m_pauseCount) clip.seconds = seconds;
+        if (generation == m_generation) {
+            m_clips[index] = std::move(clip);
+            m_ready[index] = true;
+            m_condition.notify_all();
+        }
+    }
+}
+#endif
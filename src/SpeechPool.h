@@ -0,0 +1,87 @@
+//
+// SpeechPool.h
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SpeechEngine.h"
+
+// A set of TTS instances, each with its own thread, that render the chunks of a long
+// text into audio clips in parallel. Chunks are handed out lowest index first, so the
+// clip needed next for playback is always rendered before those further ahead.
+class SpeechPool
+{
+public:
+	// The chunks of one text, stored NUL-terminated in a single buffer.
+	struct Batch
+	{
+		std::string text;
+		std::vector<size_t> offsets;
+	};
+
+	SpeechPool();
+	~SpeechPool();
+
+	bool Init(size_t size, const char* basedir, const char* lang, const char* voice, int sampleRate);
+	void Term();
+
+	size_t GetSize();
+	void SetSpeed(float value);
+	void SetPitch(float value);
+	void SetVolume(float value);
+
+	// Applied by each instance before it renders its next chunk.
+	void SetQuality(int quality, int responsiveness);
+
+	// Starts rendering a batch. Only chunks with an index below limit are rendered,
+	// SetLimit() raises it as the clips are consumed.
+	void Start(std::shared_ptr<const Batch> pBatch, size_t limit);
+	void SetLimit(size_t limit);
+
+	// Blocks until the clip of the chunk at index is rendered and moves it into audio,
+	// and its word and sentence marks into pMarks if given. pSeconds receives the time
+	// the synthesis took, or 0 if it was paused meanwhile. Returns false if the batch
+	// was cancelled.
+	bool Take(size_t index, std::vector<char>& audio, std::vector<TextMark>* pMarks = nullptr, double* pSeconds = nullptr);
+
+	// Drops the current batch, and ends a pause.
+	void Cancel();
+
+	// Pauses the chunks being rendered. No new chunk is started until Resume().
+	void Pause();
+	void Resume();
+
+private:
+	struct Clip
+	{
+		std::vector<char> audio;
+		std::vector<TextMark> marks;  // Relative to the chunk and its audio
+		double seconds = 0.0;         // Synthesis time, 0 if paused
+	};
+
+	std::vector<std::unique_ptr<SpeechEngine>> m_engines;
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::shared_ptr<const Batch> m_pBatch;
+	std::vector<Clip> m_clips;
+	std::vector<bool> m_ready;
+	size_t m_next;         // Index of the next chunk to render
+	size_t m_limit;
+	unsigned m_generation; // Incremented for every batch, so that stale clips are dropped
+	bool m_quit;
+	bool m_paused;
+	unsigned m_pauseCount;
+	int m_quality;
+	int m_responsiveness;
+
+	void ThreadProc(SpeechEngine* pEngine);
+};
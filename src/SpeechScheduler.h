@@ -0,0 +1,230 @@
+//
+// SpeechScheduler.h
+//
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+enum class SpeechClass
+{
+	Letter,
+	Word,
+	Sentence,
+	Selection,
+	Background,  // Work that nobody is waiting for, e.g. sentence pre-synthesis
+};
+
+struct SpeechSchedulerStats
+{
+	unsigned long dispatched = 0;
+	unsigned long superseded = 0;  // Replaced by a newer utterance of the same class
+	unsigned long overflowed = 0;  // Dropped because the queue was full
+	unsigned long cancelled = 0;   // Removed by Clear()
+	std::chrono::milliseconds totalLatency{ 0 };
+	std::chrono::milliseconds maxLatency{ 0 };
+};
+
+// Replacement for a plain FIFO Queue in front of the speech thread. Utterances are
+// dispatched by class priority and in FIFO order within a priority. A pending letter or
+// word is dropped when a newer one of the same class arrives, since by then it is stale,
+// and so is background work, which only ever concerns the latest state. Sentences and
+// selections are all spoken in turn, as long as they fit in maxDepth. Dropped values are
+// destroyed once the lock is released, as that may notify whoever waits for them.
+template<typename T>
+class SpeechScheduler
+{
+public:
+	explicit SpeechScheduler(size_t maxDepth = 16) : m_maxDepth(maxDepth), m_closed(false) {}
+
+	static int GetPriority(SpeechClass cls)
+	{
+		switch (cls)
+		{
+		case SpeechClass::Letter:
+			return 3;
+		case SpeechClass::Word:
+		case SpeechClass::Sentence:
+			return 2;  // Equal, so a word is still spoken before the sentence it ends
+		case SpeechClass::Selection:
+			return 1;
+		default:
+			return 0;
+		}
+	}
+
+	static bool IsSuperseded(SpeechClass cls)
+	{
+		return cls == SpeechClass::Letter || cls == SpeechClass::Word || cls == SpeechClass::Background;
+	}
+
+	void Enqueue(SpeechClass cls, T value)
+	{
+		std::vector<T> dropped;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			for (auto it = m_queue.begin(); it != m_queue.end(); )
+			{
+				if (it->cls == cls && IsSuperseded(cls))
+				{
+					dropped.push_back(std::move(it->value));
+					it = m_queue.erase(it);
+					m_stats.superseded++;
+				}
+				else
+				{
+					++it;
+				}
+			}
+
+			if (m_queue.size() >= m_maxDepth)
+			{
+				auto victim = m_queue.begin();
+				for (auto it = m_queue.begin(); it != m_queue.end(); ++it)
+				{
+					if (GetPriority(it->cls) < GetPriority(victim->cls)) victim = it;
+				}
+				m_stats.overflowed++;
+				if (GetPriority(victim->cls) > GetPriority(cls))
+				{
+					dropped.push_back(std::move(value));
+					return;
+				}
+				dropped.push_back(std::move(victim->value));
+				m_queue.erase(victim);
+			}
+
+			m_queue.push_back({ cls, std::chrono::steady_clock::now(), std::move(value) });
+		}
+
+		m_condition.notify_all();
+	}
+
+	// Blocks until an utterance is available. Returns false once the scheduler is closed.
+	bool Dequeue(T& value, SpeechClass* pClass = nullptr)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (m_queue.empty() && !m_closed) { m_condition.wait(lock); }
+		if (m_closed) { return false; }
+
+		Take(GetNext(), value, pClass);
+		return true;
+	}
+
+	// Like Dequeue(), but gives up after timeout. Returns false on timeout as well.
+	bool DequeueFor(T& value, SpeechClass* pClass, std::chrono::milliseconds timeout)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (!m_condition.wait_for(lock, timeout, [this] { return !m_queue.empty() || m_closed; })) { return false; }
+		if (m_closed) { return false; }
+
+		Take(GetNext(), value, pClass);
+		return true;
+	}
+
+	// Takes the utterance that Dequeue() would return next, but only if one is pending
+	// and accept(cls, value) returns true for it. Does not block.
+	template<typename Predicate>
+	bool TryDequeueIf(T& value, SpeechClass* pClass, Predicate accept)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_queue.empty() || m_closed) { return false; }
+
+		auto next = GetNext();
+		if (!accept(next->cls, static_cast<const T&>(next->value))) { return false; }
+
+		Take(next, value, pClass);
+		return true;
+	}
+
+	// Drops all pending utterances, except background work.
+	void Clear()
+	{
+		std::vector<T> dropped;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (auto it = m_queue.begin(); it != m_queue.end(); )
+		{
+			if (it->cls != SpeechClass::Background)
+			{
+				dropped.push_back(std::move(it->value));
+				it = m_queue.erase(it);
+				m_stats.cancelled++;
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	void Close()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_closed = true;
+		}
+
+		m_condition.notify_all();
+	}
+
+	bool IsClosed()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_closed;
+	}
+
+	size_t GetDepth()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_queue.size();
+	}
+
+	SpeechSchedulerStats GetStats()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_stats;
+	}
+
+private:
+	struct Entry
+	{
+		SpeechClass cls;
+		std::chrono::steady_clock::time_point time;
+		T value;
+	};
+
+	typename std::deque<Entry>::iterator GetNext()
+	{
+		auto next = m_queue.begin();
+		for (auto it = m_queue.begin(); it != m_queue.end(); ++it)
+		{
+			if (GetPriority(it->cls) > GetPriority(next->cls)) next = it;
+		}
+		return next;
+	}
+
+	void Take(typename std::deque<Entry>::iterator next, T& value, SpeechClass* pClass)
+	{
+		auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - next->time);
+		m_stats.dispatched++;
+		m_stats.totalLatency += latency;
+		if (latency > m_stats.maxLatency) m_stats.maxLatency = latency;
+
+		if (pClass != nullptr) *pClass = next->cls;
+		value = std::move(next->value);
+		m_queue.erase(next);
+	}
+
+	std::mutex m_mutex;
+	std::deque<Entry> m_queue;
+	std::condition_variable m_condition;
+	size_t m_maxDepth;
+	bool m_closed;
+	SpeechSchedulerStats m_stats;
+};
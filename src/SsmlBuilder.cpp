@@ -0,0 +1,87 @@
+//
+// SsmlBuilder.cpp
+//
+
+#include "SsmlBuilder.h"
+
+static const char kHeader[] = "<?xml version=\"1.0\"?><speak version=\"1.1\" xmlns=\"http://www.w3.org/2001/10/synthesis\">";
+static const char kFooter[] = "</speak>";
+
+SsmlBuilder::SsmlBuilder() : m_document(kHeader), m_count(0)
+{
+}
+
+void SsmlBuilder::SetProsody(SpeechClass cls, const SsmlProsody& prosody)
+{
+    if (prosody.IsNeutral()) m_prosody.erase(cls);
+    else m_prosody[cls] = prosody;
+}
+
+bool SsmlBuilder::HasProsody(SpeechClass cls) const
+{
+    return m_prosody.count(cls) > 0;
+}
+
+void SsmlBuilder::Add(SpeechClass cls, const std::string& text)
+{
+    if (m_count > 0) {
+        const int breakMs = cls == SpeechClass::Sentence ? kSentenceBreakMs : kWordBreakMs;
+        m_document += "<break time=\"" + std::to_string(breakMs) + "ms\"/>";
+    }
+
+    auto prosody = m_prosody.find(cls);
+    if (prosody != m_prosody.end()) {
+        m_document += "<prosody";
+        if (prosody->second.rate != 100) {
+            m_document += " rate=\"" + std::to_string(prosody->second.rate) + "%\"";
+        }
+        if (prosody->second.pitch != 0) {
+            m_document += std::string(" pitch=\"") + (prosody->second.pitch > 0 ? "+" : "") + std::to_string(prosody->second.pitch) + "%\"";
+        }
+        m_document += ">";
+    }
+
+    if (cls == SpeechClass::Sentence) {
+        m_document += "<s>";
+        AppendEscaped(m_document, text);
+        m_document += "</s>";
+    }
+    else {
+        AppendEscaped(m_document, text);
+    }
+
+    if (prosody != m_prosody.end()) {
+        m_document += "</prosody>";
+    }
+    m_count++;
+}
+
+size_t SsmlBuilder::GetCount() const
+{
+    return m_count;
+}
+
+std::string SsmlBuilder::Finish()
+{
+    std::string document;
+    document.swap(m_document);
+    document += kFooter;
+
+    m_document = kHeader;
+    m_count = 0;
+    return document;
+}
+
+void SsmlBuilder::AppendEscaped(std::string& document, const std::string& text)
+{
+    for (char c : text) {
+        switch (c) {
+        case '&': document += "&amp;"; break;
+        case '<': document += "&lt;"; break;
+        case '>': document += "&gt;"; break;
+        case '"': document += "&quot;"; break;
+        case '\'': document += "&apos;"; break;
+        default: document += c; break;
+        }
+    }
+}
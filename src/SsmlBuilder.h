@@ -0,0 +1,50 @@
+//
+// SsmlBuilder.h
+//
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "SpeechScheduler.h"
+
+// Prosody of a class of utterances. The rate is a percentage of the speed of the instance,
+// which librstts multiplies in, and the pitch is a change in percent.
+struct SsmlProsody
+{
+	int rate = 100;
+	int pitch = 0;
+
+	bool IsNeutral() const { return rate == 100 && pitch == 0; }
+};
+
+// Builds one SSML document from several utterances, so that they can be synthesized in
+// a single call. Utterances are separated by explicit breaks instead of the silence
+// between separate synthesis calls, sentences are marked up as such, and utterances of a
+// class with a prosody of its own are put in a prosody element.
+class SsmlBuilder
+{
+public:
+	static const int kWordBreakMs = 150;
+	static const int kSentenceBreakMs = 300;
+
+	SsmlBuilder();
+
+	// Applies to the utterances added afterwards.
+	void SetProsody(SpeechClass cls, const SsmlProsody& prosody);
+	bool HasProsody(SpeechClass cls) const;
+
+	void Add(SpeechClass cls, const std::string& text);
+	size_t GetCount() const;
+
+	// Returns the document. The builder is empty afterwards.
+	std::string Finish();
+
+	static void AppendEscaped(std::string& document, const std::string& text);
+
+private:
+	std::string m_document;
+	size_t m_count;
+	std::map<SpeechClass, SsmlProsody> m_prosody;  // Only classes that are not neutral
+};
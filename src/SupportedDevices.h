@@ -1,26 +1,134 @@
 #ifndef SUPPORTED_DEVICES_H
 #define SUPPORTED_DEVICES_H
 
-// Embedded list of supported USB devices.
+// Embedded list of supported USB and Bluetooth devices.
 // This list is compiled into the binary to prevent runtime modification.
 // Modify entries and rebuild to change supported devices.
 // Accessibility note: Device descriptions are for logging/diagnostics; ensure any
 // UI exposing device info uses readable, high-contrast text and conveys state without relying solely on color.
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <cctype>
+
+enum class DeviceBus : uint8_t {
+    Usb,
+    Bluetooth  // The device node, matched by its address
+};
+
 struct SupportedDevice {
-    const char* vendorId;    // 4 uppercase hex characters (e.g., "04B4")
-    const char* productId;   // 4 uppercase hex characters (e.g., "0101")
+    DeviceBus bus;
+    uint16_t vendorId;       // For Bluetooth, the first 4 hex digits after BTHENUM\DEV_
+    uint16_t productId;      // For Bluetooth, the next 4 hex digits
     const char* description; // Optional description for diagnostics
 };
 
 inline constexpr SupportedDevice SUPPORTED_DEVICES[] = {
-    {"04B4", "0101", "Cypress Semiconductor Device"}
-    // Additional devices can be added here.
+    {DeviceBus::Usb, 0x04B4, 0x0101, "Cypress Semiconductor Device"},
+    {DeviceBus::Bluetooth, 0x0100, 0x0141, "Clevy Keyboard (Bluetooth)"}
+    // Additional devices can be added here, in any order.
 };
 
-#include <string>
-#include <algorithm>
-#include <cctype>
+// Devices are matched as a single integer, (VID << 16) | PID.
+constexpr uint32_t MakeDeviceId(uint16_t vid, uint16_t pid)
+{
+    return (static_cast<uint32_t>(vid) << 16) | pid;
+}
+
+constexpr uint64_t MakeDeviceKey(DeviceBus bus, uint32_t id)
+{
+    return (static_cast<uint64_t>(bus) << 32) | id;
+}
+
+// The keys of SUPPORTED_DEVICES, sorted at compile time for a binary search.
+template <size_t N>
+constexpr std::array<uint64_t, N> SortDeviceKeys(const SupportedDevice (&devices)[N])
+{
+    std::array<uint64_t, N> keys{};
+    for (size_t i = 0; i < N; i++) {
+        const uint64_t key = MakeDeviceKey(devices[i].bus, MakeDeviceId(devices[i].vendorId, devices[i].productId));
+        size_t j = i;
+        for (; j > 0 && keys[j - 1] > key; j--) {
+            keys[j] = keys[j - 1];
+        }
+        keys[j] = key;
+    }
+    return keys;
+}
+
+inline constexpr auto SUPPORTED_DEVICE_KEYS = SortDeviceKeys(SUPPORTED_DEVICES);
+
+constexpr bool IsSupportedId(DeviceBus bus, uint32_t id)
+{
+    const uint64_t key = MakeDeviceKey(bus, id);
+    size_t first = 0;
+    size_t last = SUPPORTED_DEVICE_KEYS.size();
+    while (first < last) {
+        const size_t middle = first + (last - first) / 2;
+        if (SUPPORTED_DEVICE_KEYS[middle] < key) {
+            first = middle + 1;
+        }
+        else {
+            last = middle;
+        }
+    }
+    return first < SUPPORTED_DEVICE_KEYS.size() && SUPPORTED_DEVICE_KEYS[first] == key;
+}
+
+constexpr int HexDigitValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Reads exactly count hex digits from the start of s.
+constexpr bool ParseHexDigits(std::string_view s, size_t count, uint32_t& value)
+{
+    if (s.size() < count) {
+        return false;
+    }
+
+    value = 0;
+    for (char c : s.substr(0, count)) {
+        const int digit = HexDigitValue(c);
+        if (digit < 0) {
+            return false;
+        }
+        value = (value << 4) | static_cast<uint32_t>(digit);
+    }
+    return true;
+}
+
+// Reads a 4 digit hex id the way NormalizeHex4 normalizes it: whitespace is skipped, case
+// is ignored, shorter ids are padded with zeros on the left and longer ones are cut off
+// after 4 digits. Fails on anything else within those digits.
+constexpr bool ParseHex4(std::string_view s, uint16_t& value)
+{
+    uint32_t result = 0;
+    size_t count = 0;
+    for (char c : s) {
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v') {
+            continue;
+        }
+        if (count == 4) {
+            break;
+        }
+        const int digit = HexDigitValue(c);
+        if (digit < 0) {
+            return false;
+        }
+        result = (result << 4) | static_cast<uint32_t>(digit);
+        count++;
+    }
+    value = static_cast<uint16_t>(result);
+    return true;
+}
 
 inline std::string NormalizeHex4(const std::string& in)
 {
@@ -35,19 +143,44 @@ inline std::string NormalizeHex4(const std::string& in)
     return s;
 }
 
-inline bool IsSupported(const std::string& vid, const std::string& pid)
+// Does not allocate, so it can be called for every device in a scan.
+constexpr bool IsSupported(std::string_view vid, std::string_view pid)
 {
-    std::string v = NormalizeHex4(vid);
-    std::string p = NormalizeHex4(pid);
-    for (const auto& dev : SUPPORTED_DEVICES) {
-        if (v == dev.vendorId && p == dev.productId) {
+    uint16_t v = 0, p = 0;
+    return ParseHex4(vid, v) && ParseHex4(pid, p) && IsSupportedId(DeviceBus::Usb, MakeDeviceId(v, p));
+}
+
+// Bluetooth devices have hardware ids like "BTHENUM\DEV_0100014122B5", with the device
+// address after DEV_. Its first 8 digits are matched as the vendor and product id.
+constexpr bool IsSupportedBluetooth(std::string_view hardwareId)
+{
+    constexpr std::string_view prefix = "BTHENUM\\DEV_";
+    const size_t pos = hardwareId.find(prefix);
+    uint32_t id = 0;
+    return pos != std::string_view::npos && ParseHexDigits(hardwareId.substr(pos + prefix.size()), 8, id) &&
+        IsSupportedId(DeviceBus::Bluetooth, id);
+}
+
+// Linux input devices tell the bus they are on. Only BUS_USB (3) has known ids; the ids that
+// the keyboard reports over Bluetooth are not known, so it is not matched there.
+constexpr bool IsSupportedInputDevice(uint16_t bustype, uint16_t vid, uint16_t pid)
+{
+    return bustype == 0x03 && IsSupportedId(DeviceBus::Usb, MakeDeviceId(vid, pid));
+}
+
+// Windows hardware ids and device paths, "USB\VID_04B4&PID_0101\..." or
+// "\\?\HID#VID_04B4&PID_0101&MI_00#...", in upper case. Bluetooth devices are matched by
+// their address.
+constexpr bool IsSupportedHardwareId(std::string_view id)
+{
+    const size_t vidPos = id.find("VID_");
+    if (vidPos != std::string_view::npos) {
+        const size_t pidPos = id.find("PID_", vidPos);
+        if (pidPos != std::string_view::npos && IsSupported(id.substr(vidPos + 4, 4), id.substr(pidPos + 4, 4))) {
             return true;
         }
     }
-    return false;
+    return IsSupportedBluetooth(id);
 }
 
-// Future optimization: if SUPPORTED_DEVICES grows beyond ~200 entries,
-// switch to an unordered_set<uint32_t> combining (VID<<16)|PID to achieve O(1) lookups.
-
 #endif // SUPPORTED_DEVICES_H
@@ -0,0 +1,234 @@
+//
+// TextModel.cpp
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include "TextModel.h"
+
+static const char32_t kZeroWidthJoiner = 0x200D;
+
+static bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static bool IsContinuationByte(char c)
+{
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+// Code points that belong to the character before them: combining marks, variation
+// selectors, emoji modifiers and tags, and the joiners.
+static bool IsExtend(char32_t c)
+{
+    return (c >= 0x0300 && c <= 0x036F) || (c >= 0x0483 && c <= 0x0489) || (c >= 0x0591 && c <= 0x05BD) ||
+        (c >= 0x0610 && c <= 0x061A) || (c >= 0x064B && c <= 0x065F) || (c >= 0x0E34 && c <= 0x0E3A) ||
+        (c >= 0x0E47 && c <= 0x0E4E) || (c >= 0x1AB0 && c <= 0x1AFF) || (c >= 0x1DC0 && c <= 0x1DFF) ||
+        c == 0x200C || c == kZeroWidthJoiner || (c >= 0x20D0 && c <= 0x20FF) || (c >= 0xFE00 && c <= 0xFE0F) ||
+        (c >= 0xFE20 && c <= 0xFE2F) || (c >= 0x1F3FB && c <= 0x1F3FF) || (c >= 0xE0020 && c <= 0xE007F) ||
+        (c >= 0xE0100 && c <= 0xE01EF);
+}
+
+static bool IsPictographic(char32_t c)
+{
+    return c == 0x00A9 || c == 0x00AE || (c >= 0x2300 && c <= 0x23FF) || (c >= 0x2600 && c <= 0x27BF) ||
+        (c >= 0x1F000 && c <= 0x1FAFF);
+}
+
+static bool IsRegionalIndicator(char32_t c)
+{
+    return c >= 0x1F1E6 && c <= 0x1F1FF;
+}
+
+// Length of the sequence that a lead byte starts, zero for bytes that cannot start one.
+static size_t SequenceLength(unsigned char c)
+{
+    if (c < 0x80) return 1;
+    if (c >= 0xC2 && c <= 0xDF) return 2;
+    if (c >= 0xE0 && c <= 0xEF) return 3;
+    if (c >= 0xF0 && c <= 0xF4) return 4;
+    return 0;
+}
+
+TextModel::TextModel(size_t capacity) : m_buffer(capacity), m_gapBegin(0), m_gapEnd(capacity)
+{
+}
+
+void TextModel::Clear()
+{
+    m_gapBegin = 0;
+    m_gapEnd = m_buffer.size();
+}
+
+std::string TextModel::GetText() const
+{
+    std::string text;
+    text.reserve(GetLength());
+    text.append(m_buffer.data(), m_gapBegin);
+    text.append(m_buffer.data() + m_gapEnd, m_buffer.size() - m_gapEnd);
+    return text;
+}
+
+std::string TextModel::GetWordBeforeCursor() const
+{
+    size_t begin = m_gapBegin;
+    while (begin > 0 && !IsSpace(m_buffer[begin - 1])) begin--;
+    return std::string(m_buffer.data() + begin, m_gapBegin - begin);
+}
+
+// The gap grows to at least twice the size of the buffer, so that typing stays O(1)
+// amortized.
+void TextModel::Insert(const std::string& text)
+{
+    if (text.empty()) return;
+
+    if (m_gapEnd - m_gapBegin < text.size()) {
+        const size_t after = m_buffer.size() - m_gapEnd;
+        const size_t size = std::max(m_buffer.size() * 2, GetLength() + text.size() + kDefaultCapacity);
+        std::vector<char> buffer(size);
+        std::memcpy(buffer.data(), m_buffer.data(), m_gapBegin);
+        std::memcpy(buffer.data() + size - after, m_buffer.data() + m_gapEnd, after);
+        m_buffer.swap(buffer);
+        m_gapEnd = size - after;
+    }
+
+    std::memcpy(m_buffer.data() + m_gapBegin, text.data(), text.size());
+    m_gapBegin += text.size();
+}
+
+bool TextModel::Backspace()
+{
+    if (m_gapBegin == 0) return false;
+    m_gapBegin = PreviousBoundary(m_gapBegin);
+    return true;
+}
+
+bool TextModel::Delete()
+{
+    if (m_gapEnd == m_buffer.size()) return false;
+    m_gapEnd += NextBoundary(m_gapBegin) - m_gapBegin;
+    return true;
+}
+
+bool TextModel::MoveLeft()
+{
+    if (m_gapBegin == 0) return false;
+    MoveGap(PreviousBoundary(m_gapBegin));
+    return true;
+}
+
+bool TextModel::MoveRight()
+{
+    if (m_gapEnd == m_buffer.size()) return false;
+    MoveGap(NextBoundary(m_gapBegin));
+    return true;
+}
+
+void TextModel::Home()
+{
+    MoveGap(0);
+}
+
+void TextModel::End()
+{
+    MoveGap(GetLength());
+}
+
+// Decodes the code point at pos and returns its length. Invalid bytes are taken one at a
+// time, as U+FFFD.
+size_t TextModel::Decode(size_t pos, char32_t& c) const
+{
+    const unsigned char lead = static_cast<unsigned char>(At(pos));
+    const size_t length = SequenceLength(lead);
+    c = 0xFFFD;
+    if (length == 0 || pos + length > GetLength()) return 1;
+    if (length == 1) {
+        c = lead;
+        return 1;
+    }
+
+    char32_t value = lead & (0x7F >> length);
+    for (size_t i = 1; i < length; i++) {
+        const char b = At(pos + i);
+        if (!IsContinuationByte(b)) return 1;
+        value = (value << 6) | (static_cast<unsigned char>(b) & 0x3F);
+    }
+    c = value;
+    return length;
+}
+
+// Decodes the code point that ends at pos and returns its length.
+size_t TextModel::DecodeBefore(size_t pos, char32_t& c) const
+{
+    size_t begin = pos - 1;
+    while (begin > 0 && pos - begin < 4 && IsContinuationByte(At(begin))) begin--;
+    if (Decode(begin, c) == pos - begin) return pos - begin;
+
+    c = 0xFFFD;
+    return 1;
+}
+
+size_t TextModel::CountRegionalIndicatorsBefore(size_t pos) const
+{
+    size_t count = 0;
+    char32_t c;
+    while (pos > 0) {
+        const size_t length = DecodeBefore(pos, c);
+        if (!IsRegionalIndicator(c)) break;
+        pos -= length;
+        count++;
+    }
+    return count;
+}
+
+// Start of the grapheme cluster that ends at pos.
+size_t TextModel::PreviousBoundary(size_t pos) const
+{
+    char32_t c;
+    pos -= DecodeBefore(pos, c);
+    while (pos > 0) {
+        char32_t previous;
+        const size_t length = DecodeBefore(pos, previous);
+        const bool joined = IsExtend(c) || (previous == kZeroWidthJoiner && IsPictographic(c)) || (previous == '\r' && c == '\n') ||
+            (IsRegionalIndicator(previous) && IsRegionalIndicator(c) && CountRegionalIndicatorsBefore(pos) % 2 == 1);
+        if (!joined) break;
+        pos -= length;
+        c = previous;
+    }
+    return pos;
+}
+
+// End of the grapheme cluster that starts at pos.
+size_t TextModel::NextBoundary(size_t pos) const
+{
+    char32_t c;
+    pos += Decode(pos, c);
+    while (pos < GetLength()) {
+        char32_t next;
+        const size_t length = Decode(pos, next);
+        const bool joined = IsExtend(next) || (c == kZeroWidthJoiner && IsPictographic(next)) || (c == '\r' && next == '\n') ||
+            (IsRegionalIndicator(c) && IsRegionalIndicator(next) && CountRegionalIndicatorsBefore(pos) % 2 == 1);
+        if (!joined) break;
+        pos += length;
+        c = next;
+    }
+    return pos;
+}
+
+void TextModel::MoveGap(size_t pos)
+{
+    if (pos < m_gapBegin) {
+        const size_t count = m_gapBegin - pos;
+        std::memmove(m_buffer.data() + m_gapEnd - count, m_buffer.data() + pos, count);
+        m_gapBegin -= count;
+        m_gapEnd -= count;
+    }
+    else if (pos > m_gapBegin) {
+        const size_t count = pos - m_gapBegin;
+        std::memmove(m_buffer.data() + m_gapBegin, m_buffer.data() + m_gapEnd, count);
+        m_gapBegin += count;
+        m_gapEnd += count;
+    }
+}
@@ -0,0 +1,55 @@
+//
+// TextModel.h
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// UTF-8 text being typed, with a cursor. The text is kept in a gap buffer with the gap
+// at the cursor, so that typing and deleting at the cursor and moving it by a character
+// only move the bytes of that character. Characters are grapheme clusters: a letter
+// with its combining marks, an emoji with its modifiers and joined emoji, or a flag,
+// so that Backspace removes what the user sees as one character.
+class TextModel
+{
+public:
+	static const size_t kDefaultCapacity = 256;
+
+	explicit TextModel(size_t capacity = kDefaultCapacity);
+
+	void Clear();
+	bool IsEmpty() const { return GetLength() == 0; }
+	size_t GetLength() const { return m_buffer.size() - (m_gapEnd - m_gapBegin); }
+	size_t GetCursor() const { return m_gapBegin; }  // In bytes
+	std::string GetText() const;
+
+	// The text between the last whitespace before the cursor and the cursor.
+	std::string GetWordBeforeCursor() const;
+
+	void Insert(const std::string& text);
+
+	// Return false at the start or end of the text, where they do nothing.
+	bool Backspace();
+	bool Delete();
+	bool MoveLeft();
+	bool MoveRight();
+
+	void Home();
+	void End();
+
+private:
+	std::vector<char> m_buffer;
+	size_t m_gapBegin;
+	size_t m_gapEnd;
+
+	char At(size_t pos) const { return pos < m_gapBegin ? m_buffer[pos] : m_buffer[pos + m_gapEnd - m_gapBegin]; }
+	size_t Decode(size_t pos, char32_t& c) const;
+	size_t DecodeBefore(size_t pos, char32_t& c) const;
+	size_t PreviousBoundary(size_t pos) const;
+	size_t NextBoundary(size_t pos) const;
+	size_t CountRegionalIndicatorsBefore(size_t pos) const;
+	void MoveGap(size_t pos);
+};
@@ -0,0 +1,129 @@
+//
+// TextSegmenter.cpp
+//
+
+#include "TextSegmenter.h"
+
+static bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static bool IsContinuationByte(char c)
+{
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+static bool Matches(const char* text, size_t length, size_t pos, const char* sequence, size_t sequenceLength)
+{
+    if (pos + sequenceLength > length) return false;
+    for (size_t i = 0; i < sequenceLength; i++) {
+        if (text[pos + i] != sequence[i]) return false;
+    }
+    return true;
+}
+
+// Length of the sentence terminator at pos: . ! ? or the ellipsis character
+static size_t TerminatorLength(const char* text, size_t length, size_t pos)
+{
+    char c = text[pos];
+    if (c == '.' || c == '!' || c == '?') return 1;
+    if (Matches(text, length, pos, "\xE2\x80\xA6", 3)) return 3;
+    return 0;
+}
+
+// Length of the closing quote or bracket at pos: " ' ) ] and their typographic forms
+static size_t ClosingMarkLength(const char* text, size_t length, size_t pos)
+{
+    char c = text[pos];
+    if (c == '"' || c == '\'' || c == ')' || c == ']') return 1;
+    if (Matches(text, length, pos, "\xE2\x80\x99", 3)) return 3;  // Right single quotation mark
+    if (Matches(text, length, pos, "\xE2\x80\x9D", 3)) return 3;  // Right double quotation mark
+    if (Matches(text, length, pos, "\xC2\xBB", 2)) return 2;      // Right-pointing double angle quotation mark
+    return 0;
+}
+
+TextSegmenter::TextSegmenter(const char* text, size_t length, size_t maxLength)
+    : m_text(text), m_length(length), m_maxLength(maxLength), m_pos(0)
+{
+}
+
+bool TextSegmenter::Next(TextChunk& chunk)
+{
+    m_pos = SkipWhitespace(m_pos);
+    if (m_pos >= m_length) return false;
+
+    const size_t begin = m_pos;
+    size_t lastSpace = begin;
+    size_t end = m_length;
+    size_t after = m_length;
+    bool paragraph = false;
+
+    for (size_t pos = begin; pos < m_length; pos++) {
+        if (IsParagraphBreak(pos, after)) {
+            end = pos;
+            paragraph = true;
+            break;
+        }
+        if (IsSentenceEnd(pos, after)) {
+            end = after;
+            break;
+        }
+        if (IsSpace(m_text[pos])) {
+            lastSpace = pos;
+        }
+        if (pos - begin >= m_maxLength) {
+            end = lastSpace > begin ? lastSpace : pos;
+            while (end > begin + 1 && IsContinuationByte(m_text[end])) end--;
+            after = end;
+            break;
+        }
+    }
+
+    while (end > begin && IsSpace(m_text[end - 1])) end--;
+
+    chunk.begin = begin;
+    chunk.end = end;
+    chunk.paragraph = paragraph;
+    m_pos = after;
+    return true;
+}
+
+bool TextSegmenter::IsSentenceEnd(size_t pos, size_t& after) const
+{
+    size_t length = TerminatorLength(m_text, m_length, pos);
+    if (length == 0) return false;
+
+    // Runs like "?!" or "..." and closing quotes belong to the sentence.
+    pos += length;
+    while (pos < m_length && (length = TerminatorLength(m_text, m_length, pos)) != 0) pos += length;
+    while (pos < m_length && (length = ClosingMarkLength(m_text, m_length, pos)) != 0) pos += length;
+
+    if (pos < m_length && !IsSpace(m_text[pos])) return false;  // e.g. "3.5" or "www.clevy.com"
+
+    // A lowercase letter after the period hints at an abbreviation, as in "bijv. een".
+    size_t next = SkipWhitespace(pos);
+    if (next < m_length && m_text[next] >= 'a' && m_text[next] <= 'z') return false;
+
+    after = pos;
+    return true;
+}
+
+bool TextSegmenter::IsParagraphBreak(size_t pos, size_t& after) const
+{
+    if (m_text[pos] != '\n') return false;
+
+    for (pos++; pos < m_length && IsSpace(m_text[pos]); pos++) {
+        if (m_text[pos] == '\n') {
+            after = pos + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t TextSegmenter::SkipWhitespace(size_t pos) const
+{
+    while (pos < m_length && IsSpace(m_text[pos])) pos++;
+    return pos;
+}
@@ -0,0 +1,37 @@
+//
+// TextSegmenter.h
+//
+
+#pragma once
+
+#include <cstddef>
+
+struct TextChunk
+{
+	size_t begin;
+	size_t end;       // One past the last byte, trailing whitespace excluded
+	bool paragraph;   // Chunk is followed by a paragraph break
+};
+
+// Splits UTF-8 text into sentence and paragraph sized chunks without copying it.
+// Sentences longer than maxLength bytes are split at the last whitespace before
+// that length, or else at a character boundary.
+class TextSegmenter
+{
+public:
+	static const size_t kDefaultMaxLength = 400;
+
+	TextSegmenter(const char* text, size_t length, size_t maxLength = kDefaultMaxLength);
+
+	bool Next(TextChunk& chunk);
+
+private:
+	const char* m_text;
+	size_t m_length;
+	size_t m_maxLength;
+	size_t m_pos;
+
+	bool IsSentenceEnd(size_t pos, size_t& after) const;
+	bool IsParagraphBreak(size_t pos, size_t& after) const;
+	size_t SkipWhitespace(size_t pos) const;
+};
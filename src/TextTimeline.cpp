@@ -0,0 +1,83 @@
+//
+// TextTimeline.cpp
+//
+
+#include <algorithm>
+
+#include "TextTimeline.h"
+
+void TextTimeline::Clear()
+{
+    m_marks.clear();
+}
+
+void TextTimeline::Add(const TextMark& mark)
+{
+    for (auto it = m_marks.rbegin(); it != m_marks.rend(); ++it) {
+        if (it->type != mark.type) continue;
+        if (it->textBegin == mark.textBegin) return;
+        break;
+    }
+    m_marks.push_back(mark);
+}
+
+void TextTimeline::DropBefore(size_t audioOffset)
+{
+    auto end = std::lower_bound(m_marks.begin(), m_marks.end(), audioOffset, [](const TextMark& mark, size_t offset) {
+        return mark.audioOffset < offset;
+    });
+    m_marks.erase(m_marks.begin(), end);
+}
+
+bool TextTimeline::Find(TextMarkType type, size_t audioOffset, TextMark& mark) const
+{
+    auto it = FindLast(type, audioOffset);
+    if (it == m_marks.end()) return false;
+    mark = *it;
+    return true;
+}
+
+bool TextTimeline::GetRepeatOffset(size_t audioOffset, size_t& target, size_t grace) const
+{
+    auto current = FindLast(TextMarkType::Sentence, audioOffset);
+    if (current == m_marks.end()) return false;
+
+    target = current->audioOffset;
+    if (audioOffset - current->audioOffset >= grace) return true;
+
+    for (auto it = current; it != m_marks.begin(); ) {
+        --it;
+        if (it->type == TextMarkType::Sentence) {
+            target = it->audioOffset;
+            break;
+        }
+    }
+    return true;
+}
+
+bool TextTimeline::GetSkipOffset(size_t audioOffset, size_t& target) const
+{
+    auto it = std::upper_bound(m_marks.begin(), m_marks.end(), audioOffset, [](size_t offset, const TextMark& mark) {
+        return offset < mark.audioOffset;
+    });
+    for (; it != m_marks.end(); ++it) {
+        if (it->type == TextMarkType::Sentence) {
+            target = it->audioOffset;
+            return true;
+        }
+    }
+    return false;
+}
+
+// The last mark of type at or before audioOffset, or end().
+std::vector<TextMark>::const_iterator TextTimeline::FindLast(TextMarkType type, size_t audioOffset) const
+{
+    auto it = std::upper_bound(m_marks.begin(), m_marks.end(), audioOffset, [](size_t offset, const TextMark& mark) {
+        return offset < mark.audioOffset;
+    });
+    while (it != m_marks.begin()) {
+        --it;
+        if (it->type == type) return it;
+    }
+    return m_marks.end();
+}
@@ -0,0 +1,61 @@
+//
+// TextTimeline.h
+//
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+enum class TextMarkType
+{
+	Word,
+	Sentence,
+};
+
+// Start of a word or sentence in the audio. Text positions are byte offsets into the
+// text that was read, audio offsets are byte offsets into its audio.
+struct TextMark
+{
+	TextMarkType type;
+	size_t textBegin;
+	size_t textEnd;
+	size_t audioOffset;
+};
+
+// Maps the audio of a text to the words and sentences in it. Marks are added in the
+// order they are spoken, so that their audio offsets never decrease.
+class TextTimeline
+{
+public:
+	// A sentence that started playing less than this long ago is not repeated by
+	// GetRepeatOffset(), the previous one is.
+	static const size_t kDefaultRepeatGrace = 22050 * 2;  // One second of 22 kHz mono PCM
+
+	void Clear();
+
+	// Marks that repeat the previous one of their type, such as a sentence reported both
+	// by the text segmentation and by the engine, are ignored.
+	void Add(const TextMark& mark);
+
+	// Drops marks before audioOffset, once their audio is no longer kept.
+	void DropBefore(size_t audioOffset);
+
+	size_t GetCount() const { return m_marks.size(); }
+
+	// The word or sentence being spoken at audioOffset.
+	bool Find(TextMarkType type, size_t audioOffset, TextMark& mark) const;
+
+	// Where to continue to re-read the sentence being spoken at audioOffset, or the one
+	// before it when it has only just started.
+	bool GetRepeatOffset(size_t audioOffset, size_t& target, size_t grace = kDefaultRepeatGrace) const;
+
+	// Where the sentence after the one being spoken at audioOffset starts. Fails when that
+	// sentence has not been synthesized yet.
+	bool GetSkipOffset(size_t audioOffset, size_t& target) const;
+
+private:
+	std::vector<TextMark> m_marks;
+
+	std::vector<TextMark>::const_iterator FindLast(TextMarkType type, size_t audioOffset) const;
+};
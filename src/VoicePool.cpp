@@ -0,0 +1,189 @@
+//
+// VoicePool.cpp
+//
+
+#include <fstream>
+
+#include "VoicePool.h"
+
+#ifndef __NO_TTS__
+static size_t GetFileSize(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    return file ? static_cast<size_t>(file.tellg()) : 0;
+}
+
+// Voice and language data files make up most of the memory used by an instance.
+static size_t EstimateBytes(const std::string& basedir, const std::string& lang, const std::string& voice)
+{
+    const std::string data = basedir + "/data/";
+    return GetFileSize(data + voice + ".db") + GetFileSize(data + voice + ".fon")
+        + GetFileSize(data + lang + ".db") + GetFileSize(data + lang + ".fsa") + GetFileSize(data + lang + ".fst");
+}
+
+VoicePool::VoicePool() : m_sampleRate(0), m_budget(0), m_settings(0), m_speed(-1.0f), m_pitch(-1.0f), m_volume(-1.0f), m_quality(-1), m_responsiveness(-1) {}
+VoicePool::~VoicePool() { Term(); }
+
+void VoicePool::Configure(const std::string& basedir, int sampleRate, size_t budgetBytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_basedir = basedir;
+    m_sampleRate = sampleRate;
+    m_budget = budgetBytes;
+    for (Entry& entry : m_entries) {
+        entry.bytes = EstimateBytes(m_basedir, entry.lang, entry.voice);
+    }
+}
+
+void VoicePool::AddVoice(const std::string& lang, const std::string& voice)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const Entry& entry : m_entries) {
+        if (entry.voice == voice) return;
+    }
+    m_entries.push_back({ lang, voice, EstimateBytes(m_basedir, lang, voice), nullptr, 0, false });
+}
+
+void VoicePool::Term()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] {
+        for (const Entry& entry : m_entries) {
+            if (entry.bLoading) return false;
+        }
+        return true;
+    });
+    for (Entry& entry : m_entries) {
+        entry.pEngine.reset();
+    }
+}
+
+// Acquire() may reorder the entries while a voice is loaded, which at worst skips one.
+void VoicePool::Preload()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (Entry& entry : m_entries) {
+        if (entry.pEngine || entry.bLoading || GetResidentBytesLocked() + entry.bytes > m_budget) continue;
+        Load(entry, lock);
+    }
+}
+
+std::shared_ptr<SpeechEngine> VoicePool::Acquire(const std::string& voice)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    auto it = m_entries.begin();
+    while (it != m_entries.end() && it->voice != voice) ++it;
+    if (it == m_entries.end()) return nullptr;
+
+    m_entries.splice(m_entries.begin(), m_entries, it);
+    Entry& entry = m_entries.front();
+
+    // Preload() may be loading it.
+    m_condition.wait(lock, [&entry] { return !entry.bLoading; });
+
+    if (!entry.pEngine) {
+        // Make room by freeing the least recently used voices. An instance that is still
+        // referenced elsewhere is freed once that reference is dropped.
+        size_t resident = GetResidentBytesLocked();
+        for (auto victim = m_entries.rbegin(); victim != m_entries.rend() && resident + entry.bytes > m_budget; ++victim) {
+            if (&*victim == &entry || !victim->pEngine) continue;
+            victim->pEngine.reset();
+            resident -= victim->bytes;
+        }
+        if (!Load(entry, lock)) return nullptr;
+    }
+
+    Apply(entry);
+    return entry.pEngine;
+}
+
+void VoicePool::SetSpeed(float value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_speed = value;
+    m_settings++;
+}
+
+void VoicePool::SetPitch(float value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pitch = value;
+    m_settings++;
+}
+
+void VoicePool::SetVolume(float value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_volume = value;
+    m_settings++;
+}
+
+void VoicePool::SetQuality(int quality, int responsiveness)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_quality = quality;
+    m_responsiveness = responsiveness;
+    m_settings++;
+}
+
+size_t VoicePool::GetResidentBytes()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return GetResidentBytesLocked();
+}
+
+std::vector<std::string> VoicePool::GetResidentVoices()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::string> voices;
+    for (const Entry& entry : m_entries) {
+        if (entry.pEngine) voices.push_back(entry.voice);
+    }
+    return voices;
+}
+
+// Loading the voice data takes long, so lock is released meanwhile. The entry stays in
+// place, as entries are never removed.
+bool VoicePool::Load(Entry& entry, std::unique_lock<std::mutex>& lock)
+{
+    const std::string basedir = m_basedir;
+    const int sampleRate = m_sampleRate;
+    entry.bLoading = true;
+    lock.unlock();
+
+    std::shared_ptr<SpeechEngine> pEngine(new SpeechEngine());
+    const bool bLoaded = pEngine->Init(basedir.c_str(), entry.lang.c_str(), entry.voice.c_str(), sampleRate);
+
+    lock.lock();
+    entry.bLoading = false;
+    m_condition.notify_all();
+    if (!bLoaded) return false;
+
+    entry.pEngine = pEngine;
+    entry.settings = m_settings - 1;
+    Apply(entry);
+    return true;
+}
+
+void VoicePool::Apply(Entry& entry)
+{
+    if (entry.settings == m_settings) return;
+
+    RSTTSInst inst = entry.pEngine->GetInstance();
+    if (m_speed >= 0.0f) rsttsSetSpeed(inst, m_speed);
+    if (m_pitch >= 0.0f) rsttsSetPitch(inst, m_pitch);
+    if (m_volume >= 0.0f) rsttsSetVolume(inst, m_volume);
+    if (m_quality >= 0) entry.pEngine->SetQuality(m_quality, m_responsiveness);
+    entry.settings = m_settings;
+}
+
+size_t VoicePool::GetResidentBytesLocked()
+{
+    size_t bytes = 0;
+    for (const Entry& entry : m_entries) {
+        if (entry.pEngine || entry.bLoading) bytes += entry.bytes;
+    }
+    return bytes;
+}
+#endif
@@ -0,0 +1,74 @@
+//
+// VoicePool.h
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "SpeechEngine.h"
+
+// TTS instances for voices other than the main one, so that an utterance can use another
+// voice or language without waiting for its data to load. Voices are preloaded for as
+// long as they fit in the memory budget. The others are loaded when first used, and the
+// least recently used voices are freed to make room for them. Instances are loaded
+// without holding the lock, so that settings and queries do not wait for it.
+class VoicePool
+{
+public:
+	VoicePool();
+	~VoicePool();
+
+	void Configure(const std::string& basedir, int sampleRate, size_t budgetBytes);
+	void AddVoice(const std::string& lang, const std::string& voice);
+	void Term();
+
+	// Loads voices in the order they were added until the budget is used up.
+	void Preload();
+
+	// Returns the instance for voice, loading it if necessary, or nullptr if the voice is
+	// unknown or fails to load. Only called from the speech thread.
+	std::shared_ptr<SpeechEngine> Acquire(const std::string& voice);
+
+	// Settings are stored and applied to an instance when it is next acquired.
+	void SetSpeed(float value);
+	void SetPitch(float value);
+	void SetVolume(float value);
+	void SetQuality(int quality, int responsiveness);
+
+	size_t GetResidentBytes();
+	std::vector<std::string> GetResidentVoices();
+
+private:
+	struct Entry
+	{
+		std::string lang;
+		std::string voice;
+		size_t bytes;                           // Estimated from the size of the data files
+		std::shared_ptr<SpeechEngine> pEngine;  // Null while not resident
+		unsigned settings;                      // Value of m_settings last applied to pEngine
+		bool bLoading;                          // Set while pEngine is being loaded, counts as resident
+	};
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;    // Signalled when a voice has been loaded
+	std::string m_basedir;
+	int m_sampleRate;
+	size_t m_budget;
+	std::list<Entry> m_entries;  // Most recently used first
+	unsigned m_settings;         // Incremented whenever a setting changes
+	float m_speed;
+	float m_pitch;
+	float m_volume;
+	int m_quality;
+	int m_responsiveness;
+
+	bool Load(Entry& entry, std::unique_lock<std::mutex>& lock);
+	void Apply(Entry& entry);
+	size_t GetResidentBytesLocked();
+};
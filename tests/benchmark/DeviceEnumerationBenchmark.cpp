@@ -0,0 +1,110 @@
+//
+// DeviceEnumerationBenchmark.cpp
+//
+// Feeds synthetic device trees of increasing size to the keyboard detection through the
+// in-memory enumerator, and measures the time of a full scan and of applying a hotplug
+// event. Applying an event should not depend on the number of devices; the benchmark
+// fails when it does, so that the incremental path does not turn into a rescan unnoticed.
+// Needs nothing but the standard library.
+//
+// Usage: Benchmark-DeviceEnumeration [hotplug cycles]
+//
+
+#include "../../src/DeviceEnumerator.h"
+#include "../fakes/FakeDeviceEnumerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+static const size_t kSizes[] = { 10, 1000, 100000 };
+
+// Applying an event on the largest tree may take this many times as long as on the
+// smallest one before it counts as a regression.
+static const double kMaxEventSlowdown = 10.0;
+
+static std::string Hex4(unsigned value) {
+    char s[5];
+    std::snprintf(s, sizeof(s), "%04x", value & 0xFFFF);
+    return s;
+}
+
+// A USB device with an input device below it for every other device, with one keyboard.
+static void AddTree(FakeDeviceEnumerator& enumerator, size_t count) {
+    for (size_t i = 0; i + 1 < count; i += 2) {
+        const std::string path = "/sys/devices/pci0000:00/usb" + std::to_string(i / 2000) + "/1-" + std::to_string(i);
+        const std::string vid = Hex4(0x1000 + static_cast<unsigned>(i % 3000));
+        const std::string pid = Hex4(static_cast<unsigned>(i));
+        enumerator.AddExisting(FakeDevice::Usb(path, vid, pid));
+        enumerator.AddExisting(FakeDevice::Input(path + "/input/input" + std::to_string(i), "3", vid, pid));
+    }
+    enumerator.AddExisting(FakeDevice::Usb("/sys/devices/pci0000:00/usb0/1-keyboard", "04b4", "0101"));
+}
+
+int main(int argc, char* argv[]) {
+    const size_t cycles = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    const FakeDevice keyboard = FakeDevice::Usb("/sys/devices/pci0000:00/usb9/9-1", "04b4", "0101");
+    const FakeDevice other = FakeDevice::Usb("/sys/devices/pci0000:00/usb9/9-2", "046d", "c52b");
+
+    std::cout << "devices    scan ms   per device ns   per event ns" << std::endl;
+    std::vector<double> eventTimes;
+    for (size_t size : kSizes) {
+        FakeDeviceEnumerator enumerator;
+        AddTree(enumerator, size);
+
+        // Full scans, repeated so that the small trees give a stable time as well
+        const size_t scans = std::max<size_t>(3, 1000000 / size);
+        std::set<std::string> keyboards;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < scans; i++) {
+            keyboards.clear();
+            ScanClevyKeyboards(enumerator, keyboards, []() { return false; });
+        }
+        const double scanSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / scans;
+        if (keyboards.size() != 1) {
+            std::cerr << "Scan of " << size << " devices found " << keyboards.size() << " keyboards" << std::endl;
+            return 1;
+        }
+
+        // Connecting and disconnecting a keyboard and another device; only applying the
+        // events is measured, not the bookkeeping of the fake tree
+        std::chrono::steady_clock::duration eventTime(0);
+        size_t events = 0;
+        for (size_t i = 0; i < cycles; i++) {
+            if (i % 2 == 0) {
+                enumerator.Add(keyboard);
+                enumerator.Add(other);
+            }
+            else {
+                enumerator.Remove(keyboard.path);
+                enumerator.Remove(other.path);
+            }
+            events += enumerator.GetPendingEventCount();
+
+            start = std::chrono::steady_clock::now();
+            ReceiveClevyKeyboardEvents(enumerator, [&](const std::string& path, bool bAdded) {
+                if (bAdded) keyboards.insert(path);
+                else keyboards.erase(path);
+            });
+            eventTime += std::chrono::steady_clock::now() - start;
+        }
+        const double eventSeconds = std::chrono::duration<double>(eventTime).count() / events;
+        eventTimes.push_back(eventSeconds);
+
+        std::cout << std::setw(7) << size << std::fixed
+                  << std::setw(11) << std::setprecision(3) << scanSeconds * 1e3
+                  << std::setw(16) << std::setprecision(1) << scanSeconds * 1e9 / size
+                  << std::setw(15) << std::setprecision(1) << eventSeconds * 1e9 << std::endl;
+    }
+
+    if (eventTimes.back() > eventTimes.front() * kMaxEventSlowdown) {
+        std::cerr << "Applying a hotplug event slows down with the number of devices" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+//
+// SpeechPoolBenchmark.cpp
+//
+// Renders a long Dutch text with SpeechPool for an increasing number of TTS instances
+// and reports the speedup over a single instance. Needs librstts and its data files,
+// so it is only built with BUILD_BENCHMARKS=ON.
+//
+// Usage: Benchmark-SpeechPool <tts basedir> <lang> <voice> [max instances]
+//
+
+#include "../../src/SpeechPool.h"
+#include "../../src/TextSegmenter.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+static const char kParagraph[] =
+    "De kat zat op de mat en keek naar buiten. Het regende al de hele dag. "
+    "Op straat liepen mensen met paraplu's voorbij, en af en toe reed er een fiets door de plassen. "
+    "Toen de zon eindelijk doorbrak, sprong de kat van de mat en rende naar de deur. "
+    "Zou er vandaag nog iemand komen spelen?\n\n";
+
+static const int kParagraphs = 8;
+static const int kSampleRate = 22050;
+static const int kSampleSize = 2;
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <tts basedir> <lang> <voice> [max instances]" << std::endl;
+        return 2;
+    }
+
+    size_t maxInstances = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : std::thread::hardware_concurrency();
+    if (maxInstances == 0) maxInstances = 1;
+
+    std::string text;
+    for (int i = 0; i < kParagraphs; i++) text += kParagraph;
+
+    auto pBatch = std::make_shared<SpeechPool::Batch>();
+    TextSegmenter segmenter(text.data(), text.size());
+    TextChunk chunk;
+    while (segmenter.Next(chunk)) {
+        pBatch->offsets.push_back(pBatch->text.size());
+        pBatch->text.append(text, chunk.begin, chunk.end - chunk.begin);
+        pBatch->text.push_back('\0');
+    }
+
+    std::cout << "instances  seconds  audio/s  speedup" << std::endl;
+    double baseline = 0.0;
+    for (size_t instances = 1; instances <= maxInstances; instances++) {
+        SpeechPool pool;
+        if (!pool.Init(instances, argv[1], argv[2], argv[3], kSampleRate)) {
+            std::cerr << "SpeechPool::Init() failed for " << instances << " instances" << std::endl;
+            return 1;
+        }
+
+        size_t bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        pool.Start(pBatch, pBatch->offsets.size());
+        for (size_t i = 0; i < pBatch->offsets.size(); i++) {
+            std::vector<char> audio;
+            if (!pool.Take(i, audio)) return 1;
+            bytes += audio.size();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        pool.Term();
+
+        if (instances == 1) baseline = seconds;
+        double audioSeconds = static_cast<double>(bytes) / kSampleSize / kSampleRate;
+        std::cout << std::setw(9) << instances << std::fixed << std::setprecision(2)
+                  << std::setw(9) << seconds
+                  << std::setw(9) << audioSeconds / seconds
+                  << std::setw(9) << baseline / seconds << std::endl;
+    }
+    return 0;
+}
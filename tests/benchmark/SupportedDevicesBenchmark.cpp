@@ -0,0 +1,126 @@
+//
+// SupportedDevicesBenchmark.cpp
+//
+// Measures how fast device ids are parsed and matched against the supported device list,
+// for the id formats that the device scans see: udev sysattrs and Windows hardware ids. The string based matching that was used before is measured as
+// the baseline. Needs nothing but the standard library.
+//
+// Usage: Benchmark-SupportedDevices [iterations]
+//
+
+#include "../../src/SupportedDevices.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct IdPair
+{
+    std::string vid;
+    std::string pid;
+};
+
+// A typical mix, where nearly every device is not a supported one.
+static const std::vector<IdPair> kUsbIds = {
+    { "04b4", "0101" }, { "046d", "c52b" }, { "8087", "0aaa" }, { "1d6b", "0002" },
+    { "1d6b", "0003" }, { "0bda", "5634" }, { "4b4", "101" }, { "5ac", "24f" },
+    { "413c", "2113" }, { "046D", "C077" }, { " 04B4", "0101 " }, { "27c6", "609c" },
+};
+
+static const std::vector<std::string> kHardwareIds = {
+    "USB\\VID_04B4&PID_0101\\5&2A8E4E&0&1",
+    "USB\\VID_046D&PID_C52B\\6&1B2C3D4E&0&2",
+    "USB\\ROOT_HUB30\\4&2F1E1C&0&0",
+    "BTHENUM\\DEV_0100014122B5\\7&1A2B3C&0&BLUETOOTHDEVICE_0100014122B5",
+    "BTHENUM\\DEV_A4C138F0112D\\7&3C4D5E&0&BLUETOOTHDEVICE_A4C138F0112D",
+    "HID\\VID_8087&PID_0AAA&MI_00\\7&9F8E7D&0&0000",
+};
+
+// The former table and lookup, with the ids as uppercase strings.
+struct StringDevice
+{
+    const char* vendorId;
+    const char* productId;
+};
+
+static const StringDevice kStringDevices[] = {
+    { "04B4", "0101" },
+};
+
+static bool IsSupportedStrings(const std::string& vid, const std::string& pid)
+{
+    std::string v = NormalizeHex4(vid);
+    std::string p = NormalizeHex4(pid);
+    for (const auto& dev : kStringDevices) {
+        if (v == dev.vendorId && p == dev.productId) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool IsClevyKeyboardIdStrings(const std::string& id)
+{
+    size_t vidPos = id.find("VID_");
+    if (vidPos != std::string::npos) {
+        size_t pidPos = id.find("PID_", vidPos);
+        if (pidPos != std::string::npos && IsSupportedStrings(id.substr(vidPos + 4, 4), id.substr(pidPos + 4, 4))) {
+            return true;
+        }
+    }
+    return id.find("BTHENUM\\DEV_01000141") != std::string::npos;
+}
+
+template <typename F>
+static void Measure(const char* name, size_t iterations, size_t idsPerIteration, F f)
+{
+    size_t matches = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        matches += f();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double lookups = static_cast<double>(iterations) * idsPerIteration;
+
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed
+              << std::setw(10) << std::setprecision(2) << seconds * 1e9 / lookups << " ns"
+              << std::setw(12) << std::setprecision(1) << lookups / seconds / 1e6 << " M/s"
+              << std::setw(12) << matches << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    const size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    // The scans get the ids as C strings from udev
+    std::vector<const char*> vids, pids;
+    for (const auto& ids : kUsbIds) {
+        vids.push_back(ids.vid.c_str());
+        pids.push_back(ids.pid.c_str());
+    }
+
+    std::cout << "lookup                      per id       ids/s     matches" << std::endl;
+    Measure("usb strings", iterations, kUsbIds.size(), [&]() {
+        size_t n = 0;
+        for (size_t i = 0; i < vids.size(); i++) n += IsSupportedStrings(vids[i], pids[i]);
+        return n;
+    });
+    Measure("usb packed", iterations, kUsbIds.size(), [&]() {
+        size_t n = 0;
+        for (size_t i = 0; i < vids.size(); i++) n += IsSupported(vids[i], pids[i]);
+        return n;
+    });
+    Measure("hardware id strings", iterations, kHardwareIds.size(), [&]() {
+        size_t n = 0;
+        for (const auto& id : kHardwareIds) n += IsClevyKeyboardIdStrings(id);
+        return n;
+    });
+    Measure("hardware id packed", iterations, kHardwareIds.size(), [&]() {
+        size_t n = 0;
+        for (const auto& id : kHardwareIds) n += IsSupportedHardwareId(id);
+        return n;
+    });
+    return 0;
+}
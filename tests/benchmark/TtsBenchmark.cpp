@@ -0,0 +1,203 @@
+//
+// TtsBenchmark.cpp
+//
+// Measures librstts performance for every combination of voice, sample rate and quality
+// level over a corpus of Dutch words, sentences and paragraphs. Audio goes to a null sink.
+// Results are written to stdout as JSON, so that they can be compared between builds.
+// Needs librstts and its data files, so it is only built with BUILD_BENCHMARKS=ON.
+//
+// Usage: Benchmark-Tts <tts basedir> [options]
+//   --voices nl_nl:Ilse,nl_be:Veerle   language:voice pairs
+//   --rates 16000,22050                sample rates in Hz
+//   --qualities 0,50,100               RSTTS_PARAM_QUALITY_SETTING levels
+//   --iterations 5                     runs per text
+//
+
+#include "../../src/SpeechEngine.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+struct Voice
+{
+    std::string lang;
+    std::string name;
+};
+
+struct TextClass
+{
+    const char* name;
+    std::vector<const char*> texts;
+};
+
+static const std::vector<TextClass> kCorpus = {
+    { "word", { "fiets", "boterham", "schoolbord", "verjaardag", "ziekenhuis", "eekhoorn" } },
+    { "sentence", {
+        "De kat zat op de mat.",
+        "Morgen gaan we met de hele klas naar het museum.",
+        "Heb jij mijn blauwe pen ergens zien liggen?",
+        "Na school fietst Sanne altijd langs de bakker.",
+    } },
+    { "paragraph", {
+        "Het was een koude ochtend in december. Op het schoolplein lag een dun laagje sneeuw, "
+        "en de kinderen probeerden sneeuwballen te maken. Dat lukte niet echt, want de sneeuw was te droog. "
+        "Toen de bel ging, renden ze met rode wangen naar binnen.",
+        "Elke zaterdag helpt Daan zijn opa in de moestuin. Ze zaaien bonen, wieden onkruid en geven de tomaten water. "
+        "Opa vertelt dan verhalen over vroeger, toen er nog geen computers waren. "
+        "Daan vindt dat moeilijk voor te stellen, maar hij luistert graag.",
+    } },
+};
+
+struct Sample
+{
+    double firstAudioMs;
+    double realTimeFactor;
+};
+
+static std::vector<std::string> Split(const std::string& s, char separator)
+{
+    std::vector<std::string> parts;
+    std::stringstream stream(s);
+    std::string part;
+    while (std::getline(stream, part, separator)) {
+        if (!part.empty()) parts.push_back(part);
+    }
+    return parts;
+}
+
+static long GetPeakRssKb()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return -1;
+    return static_cast<long>(counters.PeakWorkingSetSize / 1024);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+    return usage.ru_maxrss;
+#endif
+}
+
+static double Percentile(std::vector<double> values, double p)
+{
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(p / 100.0 * (values.size() - 1) + 0.5);
+    return values[index];
+}
+
+static void WriteStats(std::ostream& out, const char* name, const std::vector<double>& values)
+{
+    out << "\"" << name << "\": { \"p50\": " << Percentile(values, 50) << ", \"p90\": " << Percentile(values, 90)
+        << ", \"p99\": " << Percentile(values, 99) << ", \"max\": " << Percentile(values, 100) << " }";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <tts basedir> [--voices lang:voice,...] [--rates hz,...] [--qualities level,...] [--iterations n]" << std::endl;
+        return 2;
+    }
+
+    std::vector<Voice> voices = { { "nl_nl", "Ilse" }, { "nl_be", "Veerle" } };
+    std::vector<int> rates = { 16000, 22050 };
+    std::vector<int> qualities = { 0, 50, 100 };
+    int iterations = 5;
+
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::vector<std::string> values = Split(argv[i + 1], ',');
+        if (option == "--voices") {
+            voices.clear();
+            for (const auto& value : values) {
+                size_t colon = value.find(':');
+                if (colon == std::string::npos) { std::cerr << "Invalid voice: " << value << std::endl; return 2; }
+                voices.push_back({ value.substr(0, colon), value.substr(colon + 1) });
+            }
+        }
+        else if (option == "--rates") {
+            rates.clear();
+            for (const auto& value : values) rates.push_back(std::atoi(value.c_str()));
+        }
+        else if (option == "--qualities") {
+            qualities.clear();
+            for (const auto& value : values) qualities.push_back(std::atoi(value.c_str()));
+        }
+        else if (option == "--iterations") {
+            iterations = std::max(1, std::atoi(argv[i + 1]));
+        }
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 2;
+        }
+    }
+
+    std::ostream& out = std::cout;
+    out << "{ \"results\": [";
+    bool first = true;
+
+    for (const auto& voice : voices) {
+        for (int rate : rates) {
+            SpeechEngine engine;
+            auto initStart = std::chrono::steady_clock::now();
+            if (!engine.Init(argv[1], voice.lang.c_str(), voice.name.c_str(), rate)) {
+                std::cerr << "SpeechEngine::Init() failed for " << voice.name << " at " << rate << " Hz" << std::endl;
+                return 1;
+            }
+            double initMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - initStart).count();
+
+            for (int quality : qualities) {
+                engine.SetQuality(quality, RSTTS_RESPONSIVENESS_FAST);
+
+                for (const auto& textClass : kCorpus) {
+                    std::vector<Sample> samples;
+                    for (int iteration = 0; iteration < iterations; iteration++) {
+                        for (const char* text : textClass.texts) {
+                            size_t bytes = 0;
+                            std::chrono::steady_clock::time_point firstAudio;
+                            auto start = std::chrono::steady_clock::now();
+                            engine.Synthesize(text, [&](const char*, size_t size) {
+                                if (bytes == 0) firstAudio = std::chrono::steady_clock::now();
+                                bytes += size;
+                            });
+                            auto end = std::chrono::steady_clock::now();
+                            if (bytes == 0) continue;
+
+                            double seconds = std::chrono::duration<double>(end - start).count();
+                            double audioSeconds = static_cast<double>(bytes) / 2 / rate;  // 16-bit mono
+                            samples.push_back({ std::chrono::duration<double, std::milli>(firstAudio - start).count(), audioSeconds / seconds });
+                        }
+                    }
+
+                    std::vector<double> firstAudioMs, realTimeFactors;
+                    for (const auto& sample : samples) {
+                        firstAudioMs.push_back(sample.firstAudioMs);
+                        realTimeFactors.push_back(sample.realTimeFactor);
+                    }
+
+                    out << (first ? "\n" : ",\n") << "  { \"voice\": \"" << voice.name << "\", \"lang\": \"" << voice.lang
+                        << "\", \"sampleRate\": " << rate << ", \"quality\": " << quality << ", \"text\": \"" << textClass.name
+                        << "\", \"samples\": " << samples.size() << ", \"initMs\": " << initMs << ", ";
+                    WriteStats(out, "firstAudioMs", firstAudioMs);
+                    out << ", ";
+                    WriteStats(out, "realTimeFactor", realTimeFactors);
+                    out << ", \"peakRssKb\": " << GetPeakRssKb() << " }";
+                    first = false;
+                }
+            }
+        }
+    }
+
+    out << "\n] }" << std::endl;
+    return 0;
+}
@@ -0,0 +1,102 @@
+//
+// FakeDeviceEnumerator.h
+//
+// In-memory device tree for tests and benchmarks. Devices that are added or removed
+// after construction are reported as hotplug events, like udev does.
+//
+
+#pragma once
+
+#include "../../src/DeviceEnumerator.h"
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+
+struct FakeDevice
+{
+    std::string path;
+    std::string subsystem;
+    std::string devtype;
+    std::string vendorId;   // Empty for none
+    std::string productId;
+    std::string product;
+
+    static FakeDevice Usb(const std::string& path, const std::string& vid, const std::string& pid) {
+        return { path, "usb", "usb_device", vid, pid, vid + "/" + pid + "/100" };
+    }
+
+    static FakeDevice Input(const std::string& path, const std::string& bus, const std::string& vid, const std::string& pid) {
+        return { path, "input", "", "", "", bus + "/" + vid + "/" + pid + "/111" };
+    }
+
+    DeviceEntry ToEntry() const {
+        auto get = [](const std::string& s) { return s.empty() ? nullptr : s.c_str(); };
+        return { path.c_str(), get(subsystem), get(devtype), get(vendorId), get(productId), get(product) };
+    }
+};
+
+class FakeDeviceEnumerator : public DeviceEnumerator
+{
+public:
+    void Add(const FakeDevice& device) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_devices[device.path] = device;
+        m_events.push_back({ DeviceAction::Add, device });
+    }
+
+    // Removed devices keep their properties, but lose their sysattrs.
+    void Remove(const std::string& path) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_devices.find(path);
+        if (it == m_devices.end()) return;
+        FakeDevice device = it->second;
+        device.vendorId.clear();
+        device.productId.clear();
+        m_devices.erase(it);
+        m_events.push_back({ DeviceAction::Remove, device });
+    }
+
+    // Adds devices without reporting events, as if they were there from the start.
+    void AddExisting(const FakeDevice& device) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_devices[device.path] = device;
+    }
+
+    size_t GetPendingEventCount() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_events.size();
+    }
+
+    virtual void Scan(const Visitor& visitor) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& device : m_devices) {
+            if (!visitor(device.second.ToEntry())) break;
+        }
+    }
+
+    virtual bool StartMonitor() override { return true; }
+    virtual int GetMonitorFd() const override { return -1; }
+
+    virtual void ReceiveEvents(const EventVisitor& visitor) override {
+        std::deque<Event> events;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            events.swap(m_events);
+        }
+        for (const auto& event : events) {
+            visitor(event.action, event.device.ToEntry());
+        }
+    }
+
+private:
+    struct Event
+    {
+        DeviceAction action;
+        FakeDevice device;
+    };
+
+    std::mutex m_mutex;
+    std::map<std::string, FakeDevice> m_devices;
+    std::deque<Event> m_events;
+};
@@ -0,0 +1,143 @@
+//
+// FakePortAudio.cpp
+//
+// Implements the PortAudio API of portaudio.h in this directory, see FakePortAudio.h.
+// Writes block like those to a real stream in blocking mode, and return with
+// paStreamIsStopped when the stream is aborted in the meantime.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+#include "FakePortAudio.h"
+#include "portaudio.h"
+
+struct FakeStream
+{
+    int channels;
+    double sampleRate;
+    bool started;
+    unsigned aborts;  // Incremented by Pa_AbortStream(), ends pending writes
+    PaStreamInfo info;
+};
+
+static std::mutex g_mutex;
+static std::condition_variable g_condition;
+static double g_speed = 1.0;
+static std::vector<int16_t> g_played;
+static unsigned g_stopCount = 0;
+static unsigned g_abortCount = 0;
+static std::map<std::thread::id, unsigned> g_threadAbortCounts;
+
+void FakePortAudio::SetSpeed(double speed)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_speed = speed;
+}
+
+std::vector<int16_t> FakePortAudio::GetPlayed()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_played;
+}
+
+bool FakePortAudio::HasPlayed(int16_t value)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return std::find(g_played.begin(), g_played.end(), value) != g_played.end();
+}
+
+unsigned FakePortAudio::GetStopCount()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_stopCount;
+}
+
+unsigned FakePortAudio::GetAbortCount()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_abortCount;
+}
+
+unsigned FakePortAudio::GetAbortCount(std::thread::id thread)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_threadAbortCounts[thread];
+}
+
+PaError Pa_Initialize(void) { return paNoError; }
+PaError Pa_Terminate(void) { return paNoError; }
+PaError Pa_GetSampleSize(PaSampleFormat) { return 2; }
+
+PaError Pa_OpenDefaultStream(PaStream** stream, int, int numOutputChannels, PaSampleFormat, double sampleRate, unsigned long, PaStreamCallback*, void*)
+{
+    FakeStream* pStream = new FakeStream{ numOutputChannels, sampleRate, false, 0, { 1, 0.0, 0.0, sampleRate } };
+    *stream = pStream;
+    return paNoError;
+}
+
+PaError Pa_CloseStream(PaStream* stream)
+{
+    delete static_cast<FakeStream*>(stream);
+    return paNoError;
+}
+
+PaError Pa_StartStream(PaStream* stream)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    static_cast<FakeStream*>(stream)->started = true;
+    return paNoError;
+}
+
+PaError Pa_StopStream(PaStream* stream)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    static_cast<FakeStream*>(stream)->started = false;
+    g_stopCount++;
+    return paNoError;
+}
+
+PaError Pa_AbortStream(PaStream* stream)
+{
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        FakeStream* pStream = static_cast<FakeStream*>(stream);
+        pStream->started = false;
+        pStream->aborts++;
+        g_abortCount++;
+        g_threadAbortCounts[std::this_thread::get_id()]++;
+    }
+    g_condition.notify_all();
+    return paNoError;
+}
+
+PaError Pa_IsStreamStopped(PaStream* stream)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return static_cast<FakeStream*>(stream)->started ? 0 : 1;
+}
+
+PaError Pa_WriteStream(PaStream* stream, const void* buffer, unsigned long frames)
+{
+    FakeStream* pStream = static_cast<FakeStream*>(stream);
+    std::unique_lock<std::mutex> lock(g_mutex);
+    if (!pStream->started) return paStreamIsStopped;
+
+    const unsigned aborts = pStream->aborts;
+    const std::chrono::duration<double> duration(frames / pStream->sampleRate / g_speed);
+    if (g_condition.wait_for(lock, duration, [pStream, aborts] { return pStream->aborts != aborts; })) {
+        return paStreamIsStopped;
+    }
+
+    const int16_t value = frames > 0 ? static_cast<const int16_t*>(buffer)[0] : 0;
+    if (g_played.empty() || g_played.back() != value) g_played.push_back(value);
+    return paNoError;
+}
+
+const PaStreamInfo* Pa_GetStreamInfo(PaStream* stream)
+{
+    return &static_cast<FakeStream*>(stream)->info;
+}
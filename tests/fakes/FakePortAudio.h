@@ -0,0 +1,29 @@
+//
+// FakePortAudio.h
+//
+// Controls the stand-in for PortAudio in FakePortAudio.cpp. There is one output device,
+// which takes as long to play the frames written to it as a real one would, divided by
+// the speed. What it played is logged as the values of the samples, which FakeRstts
+// sets to the number of the synthesis that produced them.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace FakePortAudio
+{
+    void SetSpeed(double speed);
+
+    // The sample value of each block that was played, a run of equal values as one.
+    std::vector<int16_t> GetPlayed();
+
+    // Whether blocks with the given sample value were played.
+    bool HasPlayed(int16_t value);
+
+    unsigned GetStopCount();   // Pa_StopStream() calls, which let the buffer play out
+    unsigned GetAbortCount();  // Pa_AbortStream() calls, which drop it
+    unsigned GetAbortCount(std::thread::id thread);  // Those made on the thread
+}
@@ -0,0 +1,237 @@
+//
+// FakeRstts.cpp
+//
+// Implements the part of the librstts API that SpeechEngine uses, see FakeRstts.h.
+//
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include <librstts.h>
+#include <librstts_event.h>
+
+#include "FakeRstts.h"
+
+struct RSTTSInst_Record
+{
+    std::mutex mutex;
+    std::condition_variable condition;
+    RSTTSInst_State state = RSTTSInst_ready;
+    rsttsAudioCallback audioCallback = nullptr;
+    void* audioUserData = nullptr;
+    rsttsEventCallback eventCallback = nullptr;
+    void* eventUserData = nullptr;
+    float speed = static_cast<float>(RSTTS_SPEED_DEFAULT);
+    float pitch = static_cast<float>(RSTTS_PITCH_DEFAULT);
+    float volume = 100.0f;
+    std::thread worker;
+};
+
+static std::mutex g_mutex;
+static std::condition_variable g_condition;
+static FakeRstts::Settings g_settings;
+static std::vector<FakeRstts::Synthesis> g_syntheses;
+static int g_instances = 0;
+
+void FakeRstts::Configure(const Settings& settings)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_settings = settings;
+}
+
+std::vector<FakeRstts::Synthesis> FakeRstts::GetSyntheses()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_syntheses;
+}
+
+int FakeRstts::GetInstanceCount()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_instances;
+}
+
+bool FakeRstts::WaitForInstanceCount(int count, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(g_mutex);
+    return g_condition.wait_for(lock, timeout, [count] { return g_instances == count; });
+}
+
+// Markup does not count for the text positions, as with the real engine.
+static std::string StripMarkup(const std::string& text, const std::string& format)
+{
+    if (format != "ssml") return text;
+
+    std::string result;
+    bool inTag = false;
+    for (char c : text) {
+        if (c == '<') inTag = true;
+        else if (c == '>') inTag = false;
+        else if (!inTag) result += c;
+    }
+    return result;
+}
+
+static void SendEvent(RSTTSInst inst, RSTTSEventType type, long textPos, long bytePos, int status = RSTTS_OK)
+{
+    RSTTSEventData_SynthesizeEnd end = { status };
+    RSTTSEventData event = {};
+    event.eventtype = type;
+    event.text_pos_start = textPos;
+    event.text_pos_end = textPos;
+    event.byte_pos = bytePos;
+    event.time_pos_ms = -1;
+    if (type == RSTTSEvent_SynthesizeEnd) event.evtspec.SynthesizeEnd = &end;
+    if (inst->eventCallback) inst->eventCallback(inst, &event, inst->eventUserData);
+}
+
+// Runs on the thread of the synthesis. Returns false when it was stopped.
+static bool WaitWhilePaused(RSTTSInst inst)
+{
+    std::unique_lock<std::mutex> lock(inst->mutex);
+    inst->condition.wait(lock, [inst] { return inst->state != RSTTSInst_paused; });
+    return inst->state == RSTTSInst_playing;
+}
+
+static void SetState(RSTTSInst inst, RSTTSInst_State state)
+{
+    {
+        std::lock_guard<std::mutex> lock(inst->mutex);
+        inst->state = state;
+    }
+    inst->condition.notify_all();
+}
+
+static void Synthesize(RSTTSInst inst, std::string text, int16_t tag, FakeRstts::Settings settings)
+{
+    SendEvent(inst, RSTTSEvent_TextStart, 0, 0);
+
+    const std::vector<int16_t> samples(settings.bytesPerChar / sizeof(int16_t), tag);
+    long bytes = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (!WaitWhilePaused(inst)) {
+            std::this_thread::sleep_for(settings.stopTime);
+            SetState(inst, RSTTSInst_ready);
+            return;
+        }
+
+        if (text[i] != ' ' && (i == 0 || text[i - 1] == ' ')) {
+            SendEvent(inst, RSTTSEvent_Word, static_cast<long>(i), bytes);
+        }
+        std::this_thread::sleep_for(settings.timePerChar);
+        if (inst->audioCallback) inst->audioCallback(inst, samples.data(), samples.size() * sizeof(int16_t), inst->audioUserData);
+        bytes += static_cast<long>(samples.size() * sizeof(int16_t));
+    }
+
+    SendEvent(inst, RSTTSEvent_TextEnd, static_cast<long>(text.size()), bytes);
+    SendEvent(inst, RSTTSEvent_SynthesizeEnd, -1, bytes);
+    SetState(inst, RSTTSInst_ready);
+}
+
+RSTTSInst rsttsInit(const char*)
+{
+    std::chrono::milliseconds initTime;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        initTime = g_settings.initTime;
+    }
+    std::this_thread::sleep_for(initTime);
+
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_instances++;
+    }
+    g_condition.notify_all();
+    return new RSTTSInst_Record();
+}
+
+int rsttsFree(RSTTSInst inst)
+{
+    rsttsSetState(inst, RSTTSInst_stopping);
+    if (inst->worker.joinable()) inst->worker.join();
+    delete inst;
+
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_instances--;
+    }
+    g_condition.notify_all();
+    return RSTTS_OK;
+}
+
+int rsttsSetParameter(RSTTSInst, const RSTTS_PARAMS, const RSTTS_TYPES, const void*) { return RSTTS_OK; }
+int rsttsSetSampleRate(RSTTSInst, int) { return RSTTS_OK; }
+int rsttsSetLanguage(RSTTSInst, const char*) { return RSTTS_OK; }
+int rsttsSetVoiceByName(RSTTSInst, const char*) { return RSTTS_OK; }
+
+int rsttsSetAudioCallback(RSTTSInst inst, rsttsAudioCallback cb, void* userdata)
+{
+    inst->audioCallback = cb;
+    inst->audioUserData = userdata;
+    return RSTTS_OK;
+}
+
+int rsttsSetEventCallback(RSTTSInst inst, rsttsEventCallback cb, void* userdata)
+{
+    inst->eventCallback = cb;
+    inst->eventUserData = userdata;
+    return RSTTS_OK;
+}
+
+int rsttsSetSpeed(RSTTSInst inst, float speed) { inst->speed = speed; return RSTTS_OK; }
+int rsttsGetSpeed(RSTTSInst inst, float* pval) { *pval = inst->speed; return RSTTS_OK; }
+int rsttsSetPitch(RSTTSInst inst, float pitch) { inst->pitch = pitch; return RSTTS_OK; }
+int rsttsGetPitch(RSTTSInst inst, float* pval) { *pval = inst->pitch; return RSTTS_OK; }
+int rsttsSetVolume(RSTTSInst inst, float volume) { inst->volume = volume; return RSTTS_OK; }
+int rsttsGetVolume(RSTTSInst inst, float* pval) { *pval = inst->volume; return RSTTS_OK; }
+
+int rsttsSynthesizeAsync(RSTTSInst inst, const char* text, const char* format)
+{
+    {
+        std::lock_guard<std::mutex> lock(inst->mutex);
+        if (inst->state != RSTTSInst_ready) return RSTTS_INSTANCE_BUSY;
+        inst->state = RSTTSInst_playing;
+    }
+    if (inst->worker.joinable()) inst->worker.join();
+
+    FakeRstts::Settings settings;
+    int16_t tag;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_syntheses.push_back({ text, format, inst->speed });
+        tag = static_cast<int16_t>(g_syntheses.size());
+        settings = g_settings;
+    }
+    inst->worker = std::thread(Synthesize, inst, StripMarkup(text, format), tag, settings);
+    return RSTTS_OK;
+}
+
+int rsttsSetState(RSTTSInst inst, RSTTSInst_State state)
+{
+    {
+        std::lock_guard<std::mutex> lock(inst->mutex);
+        const bool busy = inst->state == RSTTSInst_playing || inst->state == RSTTSInst_paused;
+        if (state == RSTTSInst_stopping && busy) inst->state = RSTTSInst_stopping;
+        else if (state == RSTTSInst_paused && inst->state == RSTTSInst_playing) inst->state = RSTTSInst_paused;
+        else if (state == RSTTSInst_playing && inst->state == RSTTSInst_paused) inst->state = RSTTSInst_playing;
+    }
+    inst->condition.notify_all();
+    return RSTTS_OK;
+}
+
+RSTTSInst_State rsttsGetState(RSTTSInst inst)
+{
+    std::lock_guard<std::mutex> lock(inst->mutex);
+    return inst->state;
+}
+
+int rsttsWaitState(RSTTSInst inst, int state_mask, int timeout_ms)
+{
+    std::unique_lock<std::mutex> lock(inst->mutex);
+    const bool reached = inst->condition.wait_for(lock, std::chrono::milliseconds(timeout_ms), [inst, state_mask] {
+        return (inst->state & state_mask) != 0;
+    });
+    return reached ? RSTTS_OK : RSTTS_TIMEOUT;
+}
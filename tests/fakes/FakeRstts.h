@@ -0,0 +1,46 @@
+//
+// FakeRstts.h
+//
+// Controls the stand-in for librstts in FakeRstts.cpp, which lets tests run Speech
+// without voice data. Synthesis produces audio at a fixed rate per character of text,
+// with Word events at the start of every word, on a thread per call like
+// rsttsSynthesizeAsync() does. Every sample of the audio of the n-th synthesis has the
+// value n, counting from 1, so that tests can tell what is being played.
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace FakeRstts
+{
+    struct Settings
+    {
+        std::chrono::milliseconds initTime{ 0 };       // Taken by rsttsInit()
+        std::chrono::milliseconds stopTime{ 0 };       // From rsttsStop() until the instance is ready
+        std::chrono::microseconds timePerChar{ 100 };  // Synthesis time per character
+        size_t bytesPerChar = 882;                     // 20 ms of audio at 22050 Hz
+    };
+
+    struct Synthesis
+    {
+        std::string text;
+        std::string format;
+        float speed;
+    };
+
+    // Applies to syntheses and instances started afterwards.
+    void Configure(const Settings& settings);
+
+    // All syntheses so far, in the order they were started.
+    std::vector<Synthesis> GetSyntheses();
+
+    // Instances initialized and not yet freed.
+    int GetInstanceCount();
+
+    // Blocks until count instances are alive, or timeout has passed.
+    bool WaitForInstanceCount(int count, std::chrono::milliseconds timeout);
+}
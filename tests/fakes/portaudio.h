@@ -0,0 +1,40 @@
+//
+// portaudio.h
+//
+// The part of the PortAudio API that Audio uses. Tests put this directory on the include
+// path ahead of the real header and link FakePortAudio.cpp instead of the library.
+//
+
+#pragma once
+
+typedef int PaError;
+typedef unsigned long PaSampleFormat;
+typedef double PaTime;
+typedef void PaStream;
+typedef void PaStreamCallback;
+
+struct PaStreamInfo
+{
+    int structVersion;
+    PaTime inputLatency;
+    PaTime outputLatency;
+    double sampleRate;
+};
+
+#define paNoError 0
+#define paStreamIsStopped (-9983)
+#define paInt16 ((PaSampleFormat)0x00000008)
+#define paFramesPerBufferUnspecified (0)
+
+PaError Pa_Initialize(void);
+PaError Pa_Terminate(void);
+PaError Pa_GetSampleSize(PaSampleFormat format);
+PaError Pa_OpenDefaultStream(PaStream** stream, int numInputChannels, int numOutputChannels, PaSampleFormat sampleFormat,
+    double sampleRate, unsigned long framesPerBuffer, PaStreamCallback* streamCallback, void* userData);
+PaError Pa_CloseStream(PaStream* stream);
+PaError Pa_StartStream(PaStream* stream);
+PaError Pa_StopStream(PaStream* stream);
+PaError Pa_AbortStream(PaStream* stream);
+PaError Pa_IsStreamStopped(PaStream* stream);
+PaError Pa_WriteStream(PaStream* stream, const void* buffer, unsigned long frames);
+const PaStreamInfo* Pa_GetStreamInfo(PaStream* stream);
@@ -0,0 +1,196 @@
+//
+// EvdevCaptureTest.cpp
+//
+// Creates uinput keyboards with the ids of the Clevy Keyboard and of another keyboard, and
+// checks that EvdevCapture only takes the keystrokes of the first, passes the ones that it
+// does not suppress on through its virtual keyboard, and leaves the other keyboard alone.
+// Needs access to /dev/uinput and /dev/input, so it is only built with
+// BUILD_INTEGRATION_TESTS=ON, and skipped (exit code 77) without that access.
+//
+
+#include "../../src/EvdevCapture.h"
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+typedef std::vector<std::pair<int, int>> KeyEvents;
+
+static const int kSkipped = 77;
+
+class FakeKeyboard
+{
+public:
+    FakeKeyboard(const char* name, unsigned short vendor, unsigned short product) {
+        m_fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+        assert(m_fd >= 0);
+        ioctl(m_fd, UI_SET_EVBIT, EV_KEY);
+        ioctl(m_fd, UI_SET_EVBIT, EV_SYN);
+        for (int code = KEY_ESC; code <= KEY_F12; code++) ioctl(m_fd, UI_SET_KEYBIT, code);
+
+        struct uinput_setup setup = {};
+        setup.id.bustype = BUS_USB;
+        setup.id.vendor = vendor;
+        setup.id.product = product;
+        strncpy(setup.name, name, UINPUT_MAX_NAME_SIZE - 1);
+        const bool created = ioctl(m_fd, UI_DEV_SETUP, &setup) == 0 && ioctl(m_fd, UI_DEV_CREATE) == 0;
+        assert(created);
+        (void)created;
+    }
+
+    ~FakeKeyboard() {
+        ioctl(m_fd, UI_DEV_DESTROY);
+        close(m_fd);
+    }
+
+    void Tap(int code) {
+        Write(code, 1);
+        Write(code, 0);
+    }
+
+private:
+    int m_fd;
+
+    void Write(int code, int value) {
+        struct input_event events[2] = {};
+        events[0].type = EV_KEY;
+        events[0].code = static_cast<unsigned short>(code);
+        events[0].value = value;
+        events[1].type = EV_SYN;
+        events[1].code = SYN_REPORT;
+        const ssize_t written = write(m_fd, events, sizeof(events));
+        assert(written == sizeof(events));
+        (void)written;
+    }
+};
+
+// Opens the event node of the input device with the given name, once udev has made it.
+static int OpenNode(const std::string& name) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+    while (std::chrono::steady_clock::now() < deadline) {
+        DIR* dir = opendir("/dev/input");
+        while (dir != nullptr) {
+            struct dirent* entry = readdir(dir);
+            if (entry == nullptr) break;
+            if (strncmp(entry->d_name, "event", 5) != 0) continue;
+
+            int fd = open((std::string("/dev/input/") + entry->d_name).c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+            char nodeName[256] = {};
+            if (fd >= 0 && ioctl(fd, EVIOCGNAME(sizeof(nodeName) - 1), nodeName) >= 0 && name == nodeName) {
+                closedir(dir);
+                return fd;
+            }
+            if (fd >= 0) close(fd);
+        }
+        if (dir != nullptr) closedir(dir);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return -1;
+}
+
+static KeyEvents ReadKeys(int fd) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    KeyEvents keys;
+    struct input_event event;
+    while (read(fd, &event, sizeof(event)) == sizeof(event)) {
+        if (event.type == EV_KEY) keys.push_back({ event.code, event.value });
+    }
+    return keys;
+}
+
+// Handles the events of the capture until done() or a timeout.
+template <typename F>
+static bool Pump(EvdevCapture& capture, F done) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+    while (!done() && std::chrono::steady_clock::now() < deadline) {
+        struct pollfd pfd = { capture.GetFd(), POLLIN, 0 };
+        poll(&pfd, 1, 20);
+        capture.ReadEvents();
+    }
+    return done();
+}
+
+int main() {
+    if (access("/dev/uinput", W_OK) != 0 || access("/dev/input", R_OK) != 0) {
+        std::cout << "Skipped: no access to /dev/uinput and /dev/input." << std::endl;
+        return kSkipped;
+    }
+
+    FakeKeyboard clevy("Fake Clevy Keyboard", 0x04B4, 0x0101);
+    FakeKeyboard other("Fake other keyboard", 0x046D, 0xC52B);
+    int clevyFd = OpenNode("Fake Clevy Keyboard");
+    int otherFd = OpenNode("Fake other keyboard");
+    assert(clevyFd >= 0 && otherFd >= 0);
+
+    // Suppresses A and lets the rest through
+    KeyEvents received;
+    EvdevCapture capture([&](int code, int value) {
+        received.push_back({ code, value });
+        return code == KEY_A;
+    });
+    assert(capture.IsValid());
+    const size_t devices = capture.GetDeviceCount();
+    assert(devices >= 1);
+
+    int virtualFd = OpenNode("Clevy Dyscover virtual keyboard");
+    assert(virtualFd >= 0);
+
+    clevy.Tap(KEY_A);
+    clevy.Tap(KEY_B);
+    other.Tap(KEY_C);
+    assert(Pump(capture, [&]() { return received.size() >= 4; }));
+    assert(received == KeyEvents({ { KEY_A, 1 }, { KEY_A, 0 }, { KEY_B, 1 }, { KEY_B, 0 } }));
+
+    // Grabbed, so nobody else sees the keystrokes of the Clevy Keyboard itself
+    assert(ReadKeys(clevyFd).empty());
+    assert(ReadKeys(virtualFd) == KeyEvents({ { KEY_B, 1 }, { KEY_B, 0 } }));
+    assert(ReadKeys(otherFd) == KeyEvents({ { KEY_C, 1 }, { KEY_C, 0 } }));
+
+    // Keyboards that are plugged in later are captured as well
+    {
+        FakeKeyboard second("Fake Clevy Keyboard 2", 0x04B4, 0x0101);
+        assert(Pump(capture, [&]() { return capture.GetDeviceCount() == devices + 1; }));
+
+        received.clear();
+        second.Tap(KEY_D);
+        assert(Pump(capture, [&]() { return received.size() >= 2; }));
+        assert(received == KeyEvents({ { KEY_D, 1 }, { KEY_D, 0 } }));
+    }
+    assert(Pump(capture, [&]() { return capture.GetDeviceCount() == devices; }));
+
+    // Caps Lock follows the LEDs that the system sets on the virtual keyboard
+    for (int value : { 1, 0 }) {
+        // As the system would, through the node; the one open is read-only
+        int ledFd = open(("/proc/self/fd/" + std::to_string(virtualFd)).c_str(), O_RDWR | O_CLOEXEC);
+        assert(ledFd >= 0);
+        struct input_event events[2] = {};
+        events[0].type = EV_LED;
+        events[0].code = LED_CAPSL;
+        events[0].value = value;
+        events[1].type = EV_SYN;
+        events[1].code = SYN_REPORT;
+        const ssize_t written = write(ledFd, events, sizeof(events));
+        assert(written == sizeof(events));
+        (void)written;
+        close(ledFd);
+        assert(Pump(capture, [&]() { return capture.IsCapsLockActive() == (value != 0); }));
+    }
+
+    close(virtualFd);
+    close(otherFd);
+    close(clevyFd);
+    std::cout << "Only the Clevy Keyboard was captured." << std::endl;
+    return 0;
+}
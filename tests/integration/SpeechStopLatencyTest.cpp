@@ -0,0 +1,77 @@
+//
+// SpeechStopLatencyTest.cpp
+//
+// Measures how long Speech::Stop() and Speech::Term() take while a long text is being
+// read. Needs librstts, its data files and an audio device, so it is only built with
+// BUILD_INTEGRATION_TESTS=ON.
+//
+// Usage: Integration-SpeechStopLatency <tts basedir> <lang> <voice>
+//
+
+#include "../../src/Speech.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+static const char kText[] =
+    "Dit is een lange tekst om de stoptijd van de spraak te meten. "
+    "De zin wordt telkens halverwege afgebroken, zodat de synthese en de audio allebei bezig zijn. "
+    "Daarna wordt gekeken hoe lang het duurt voordat alles weer stil is.";
+
+static const int kIterations = 20;
+static const std::chrono::milliseconds kMaxStopLatency(250);
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <tts basedir> <lang> <voice>" << std::endl;
+        return 2;
+    }
+
+    Speech speech;
+    if (!speech.Init(argv[1], argv[2], argv[3])) {
+        std::cerr << "Speech::Init() failed" << std::endl;
+        return 1;
+    }
+
+    std::chrono::microseconds worst(0), total(0);
+    for (int i = 0; i < kIterations; i++) {
+        SpeechHandle handle = speech.Speak(kText, SpeechClass::Selection);
+
+        // Vary the moment of stopping so that it hits synthesis as well as playback.
+        std::this_thread::sleep_for(std::chrono::milliseconds(50 + 37 * i));
+
+        auto start = std::chrono::steady_clock::now();
+        speech.Stop();
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        worst = std::max(worst, latency);
+        total += latency;
+
+        // The stopped utterance reports being cancelled without waiting for playback.
+        assert(handle.WaitFor(kMaxStopLatency));
+        assert(handle.GetState() == UtteranceState::Cancelled);
+    }
+
+    // An utterance that is not interrupted finishes once it has been played.
+    SpeechHandle handle = speech.Speak("Klaar.", SpeechClass::Sentence);
+    assert(handle.Wait() == UtteranceState::Done);
+    UtteranceTimes times = handle.GetTimes();
+    assert(times.synthesisStarted >= times.requested && times.started >= times.synthesisStarted && times.ended >= times.started);
+    std::cout << "Time to first audio: " << std::chrono::duration_cast<std::chrono::milliseconds>(times.started - times.requested).count() << " ms" << std::endl;
+
+    speech.Speak(kText, SpeechClass::Selection);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    auto start = std::chrono::steady_clock::now();
+    speech.Term();
+    auto termLatency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    std::cout << "Stop latency: worst = " << worst.count() / 1000.0 << " ms, average = "
+              << total.count() / 1000.0 / kIterations << " ms" << std::endl;
+    std::cout << "Term latency: " << termLatency.count() / 1000.0 << " ms" << std::endl;
+
+    assert(worst <= kMaxStopLatency);
+    assert(termLatency <= kMaxStopLatency);
+    return 0;
+}
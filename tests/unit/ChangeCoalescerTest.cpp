@@ -0,0 +1,107 @@
+//
+// ChangeCoalescerTest.cpp
+//
+
+#include "../../src/ChangeCoalescer.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+static void burst(ChangeCoalescer& coalescer, int count, milliseconds interval) {
+    for (int i = 0; i < count; i++) {
+        coalescer.Notify();
+        std::this_thread::sleep_for(interval);
+    }
+}
+
+static void testBurstCollapsesIntoOneCall() {
+    std::atomic<int> calls(0);
+    ChangeCoalescer coalescer(milliseconds(100), milliseconds(5000), [&]() { calls++; });
+
+    // Like the dozens of device changes when a laptop is docked
+    burst(coalescer, 40, milliseconds(2));
+    assert(calls == 0);
+    std::this_thread::sleep_for(milliseconds(400));
+    assert(calls == 1);
+    assert(coalescer.GetNotifyCount() == 40 && coalescer.GetCallCount() == 1);
+}
+
+static void testSeparateBurstsGetSeparateCalls() {
+    std::atomic<int> calls(0);
+    ChangeCoalescer coalescer(milliseconds(30), milliseconds(5000), [&]() { calls++; });
+
+    burst(coalescer, 10, milliseconds(1));
+    std::this_thread::sleep_for(milliseconds(300));
+    burst(coalescer, 10, milliseconds(1));
+    std::this_thread::sleep_for(milliseconds(300));
+    assert(calls == 2);
+}
+
+static void testEndlessBurstIsCapped() {
+    std::atomic<int> calls(0);
+    ChangeCoalescer coalescer(milliseconds(50), milliseconds(200), [&]() { calls++; });
+
+    // Never quiet for 50 ms, so only the maximum delay ends the waits
+    const auto start = steady_clock::now();
+    burst(coalescer, 100, milliseconds(10));
+    const auto elapsed = duration_cast<milliseconds>(steady_clock::now() - start).count();
+    assert(calls >= 2 && calls <= elapsed / 200 + 1);
+}
+
+static void testNotifyFromManyThreads() {
+    std::atomic<int> calls(0);
+    ChangeCoalescer coalescer(milliseconds(100), milliseconds(5000), [&]() { calls++; });
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([&]() { burst(coalescer, 20, milliseconds(1)); });
+    }
+    for (auto& thread : threads) thread.join();
+    std::this_thread::sleep_for(milliseconds(400));
+    assert(calls == 1 && coalescer.GetNotifyCount() == 160);
+}
+
+static void testNotifyDuringCallback() {
+    std::atomic<int> calls(0);
+    ChangeCoalescer* pCoalescer = nullptr;
+    ChangeCoalescer coalescer(milliseconds(20), milliseconds(5000), [&]() {
+        // A change that comes in while handling the previous one is not lost
+        if (calls++ == 0) pCoalescer->Notify();
+    });
+    pCoalescer = &coalescer;
+
+    coalescer.Notify();
+    std::this_thread::sleep_for(milliseconds(300));
+    assert(calls == 2);
+}
+
+static void testStopDropsPendingCall() {
+    std::atomic<int> calls(0);
+    {
+        ChangeCoalescer coalescer(milliseconds(200), milliseconds(5000), [&]() { calls++; });
+        coalescer.Notify();
+    }
+    assert(calls == 0);
+
+    ChangeCoalescer coalescer(milliseconds(10), milliseconds(5000), [&]() { calls++; });
+    coalescer.Stop();
+    coalescer.Notify();
+    std::this_thread::sleep_for(milliseconds(100));
+    assert(calls == 0);
+}
+
+int main() {
+    testBurstCollapsesIntoOneCall();
+    testSeparateBurstsGetSeparateCalls();
+    testEndlessBurstIsCapped();
+    testNotifyFromManyThreads();
+    testNotifyDuringCallback();
+    testStopDropsPendingCall();
+    std::cout << "All change coalescer tests passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,85 @@
+//
+// DeviceEnumeratorTest.cpp
+//
+
+#include "../../src/DeviceEnumerator.h"
+#include "../fakes/FakeDeviceEnumerator.h"
+#include <cassert>
+#include <iostream>
+#include <set>
+#include <string>
+
+static const std::string kUsbPath = "/sys/devices/pci0000:00/0000:00:14.0/usb1/1-2";
+static const std::string kInputPath = "/sys/devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.0/0003:04B4:0101.0001/input/input7";
+
+static void testRecognizesKeyboards() {
+    assert(IsClevyKeyboard(FakeDevice::Usb(kUsbPath, "04b4", "0101").ToEntry()));
+    assert(!IsClevyKeyboard(FakeDevice::Usb(kUsbPath, "046d", "c52b").ToEntry()));
+
+    // Without sysattrs, the PRODUCT property is used
+    FakeDevice usb = FakeDevice::Usb(kUsbPath, "4b4", "101");
+    usb.vendorId.clear();
+    usb.productId.clear();
+    assert(IsClevyKeyboard(usb.ToEntry()));
+
+    // Interfaces of the keyboard are not the keyboard
+    usb.devtype = "usb_interface";
+    assert(!IsClevyKeyboard(usb.ToEntry()));
+
+    assert(IsClevyKeyboard(FakeDevice::Input(kInputPath, "3", "4b4", "101").ToEntry()));
+    assert(!IsClevyKeyboard(FakeDevice::Input(kInputPath, "5", "4b4", "101").ToEntry()));  // Bluetooth ids are not known
+    assert(!IsClevyKeyboard(FakeDevice::Input(kInputPath, "19", "4b4", "101").ToEntry())); // Host, i.e. built in
+    assert(!IsClevyKeyboard(FakeDevice::Input(kInputPath, "3", "46d", "c52b").ToEntry()));
+
+    FakeDevice broken = FakeDevice::Input(kInputPath, "3", "4b4", "101");
+    broken.product = "3/4b4";
+    assert(!IsClevyKeyboard(broken.ToEntry()));
+    broken.subsystem.clear();
+    assert(!IsClevyKeyboard(broken.ToEntry()));
+}
+
+static void testScan() {
+    FakeDeviceEnumerator enumerator;
+    enumerator.AddExisting(FakeDevice::Usb("/sys/a", "046d", "c52b"));
+    enumerator.AddExisting(FakeDevice::Usb("/sys/b", "04B4", "0101"));
+    enumerator.AddExisting(FakeDevice::Input("/sys/b/input", "3", "4b4", "101"));
+
+    std::set<std::string> keyboards;
+    ScanClevyKeyboards(enumerator, keyboards, []() { return false; });
+    assert(keyboards == std::set<std::string>({ "/sys/b", "/sys/b/input" }));
+
+    keyboards.clear();
+    ScanClevyKeyboards(enumerator, keyboards, []() { return true; });
+    assert(keyboards.empty());
+}
+
+static void testHotplug() {
+    FakeDeviceEnumerator enumerator;
+    std::set<std::string> keyboards;
+    auto receive = [&]() {
+        ReceiveClevyKeyboardEvents(enumerator, [&](const std::string& path, bool bAdded) {
+            if (bAdded) keyboards.insert(path);
+            else keyboards.erase(path);
+        });
+    };
+
+    enumerator.Add(FakeDevice::Usb("/sys/a", "046d", "c52b"));
+    enumerator.Add(FakeDevice::Usb("/sys/b", "04b4", "0101"));
+    receive();
+    assert(keyboards == std::set<std::string>({ "/sys/b" }));
+    assert(enumerator.GetPendingEventCount() == 0);
+
+    // The removal is passed on although the device can no longer be recognized
+    enumerator.Remove("/sys/b");
+    enumerator.Remove("/sys/a");
+    receive();
+    assert(keyboards.empty());
+}
+
+int main() {
+    testRecognizesKeyboards();
+    testScan();
+    testHotplug();
+    std::cout << "All device enumerator tests passed." << std::endl;
+    return 0;
+}
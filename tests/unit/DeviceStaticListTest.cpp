@@ -12,20 +12,70 @@ static void testNormalize() {
     assert(NormalizeHex4("04B4AA") == "04B4"); // truncated
 }
 
+static void testParseHex4() {
+    uint16_t value = 0;
+    assert(ParseHex4("04b4", value) && value == 0x04B4);
+    assert(ParseHex4("4b4", value) && value == 0x04B4);
+    assert(ParseHex4(" 04B4AA", value) && value == 0x04B4);
+    assert(ParseHex4("04B4ZZ", value) && value == 0x04B4); // cut off before the bad digits
+    assert(!ParseHex4("ZZZZ", value));
+    static_assert(MakeDeviceId(0x04B4, 0x0101) == 0x04B40101, "packed as (VID << 16) | PID");
+}
+
+static void testSortedKeys() {
+    for (size_t i = 1; i < SUPPORTED_DEVICE_KEYS.size(); i++) {
+        assert(SUPPORTED_DEVICE_KEYS[i - 1] < SUPPORTED_DEVICE_KEYS[i]);
+    }
+    for (const auto& dev : SUPPORTED_DEVICES) {
+        assert(IsSupportedId(dev.bus, MakeDeviceId(dev.vendorId, dev.productId)));
+    }
+}
+
 static void testIsSupportedPositive() {
     assert(IsSupported("04B4", "0101") == true);
     assert(IsSupported("04b4", "0101") == true); // case normalization
+    assert(IsSupported("4b4", "101") == true); // as in udev PRODUCT properties
+    static_assert(IsSupported("04B4", "0101"), "usable at compile time");
 }
 
 static void testIsSupportedNegative() {
     assert(IsSupported("FFFF", "FFFF") == false);
     assert(IsSupported("0000", "0101") == false);
+    assert(IsSupported("ZZZZ", "0101") == false);
+    assert(IsSupportedId(DeviceBus::Bluetooth, 0x04B40101) == false); // buses do not mix
+}
+
+static void testBluetooth() {
+    assert(IsSupportedBluetooth("BTHENUM\\DEV_0100014122B5\\7&1A2B3C&0&BLUETOOTHDEVICE_0100014122B5"));
+    assert(!IsSupportedBluetooth("BTHENUM\\DEV_0100014222B5"));
+    assert(!IsSupportedBluetooth("BTHENUM\\DEV_010001"));
+    assert(!IsSupportedBluetooth("USB\\VID_04B4&PID_0101"));
+
+    // Linux input devices, by bus
+    assert(IsSupportedInputDevice(0x03, 0x04B4, 0x0101));
+    assert(!IsSupportedInputDevice(0x05, 0x04B4, 0x0101)); // Bluetooth ids are not known
+    assert(!IsSupportedInputDevice(0x05, 0x0100, 0x0141)); // an address, not HID ids
+    assert(!IsSupportedInputDevice(0x06, 0x04B4, 0x0101));
+}
+
+static void testHardwareIds() {
+    assert(IsSupportedHardwareId("USB\\VID_04B4&PID_0101\\5&2A8E4E&0&1"));
+    assert(IsSupportedHardwareId("\\\\?\\HID#VID_04B4&PID_0101&MI_00#7&1B2C3D&0&0000#{884B96C3-56EF-11D1-BC8C-00A0C91405DD}"));
+    assert(IsSupportedHardwareId("BTHENUM\\DEV_0100014122B5"));
+
+    assert(!IsSupportedHardwareId("\\\\?\\HID#{00001124-0000-1000-8000-00805F9B34FB}_VID&000204B4_PID&0101#8&2C5A3B1&0&0000"));
+    assert(!IsSupportedHardwareId("USB\\VID_046D&PID_C52B\\6&1B2C3D4E&0&2"));
+    assert(!IsSupportedHardwareId("USB\\ROOT_HUB30\\4&2F1E1C&0&0"));
 }
 
 int main() {
     testNormalize();
+    testParseHex4();
+    testSortedKeys();
     testIsSupportedPositive();
     testIsSupportedNegative();
+    testBluetooth();
+    testHardwareIds();
     std::cout << "All static list tests passed.\n";
     return 0;
 }
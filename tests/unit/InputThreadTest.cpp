@@ -0,0 +1,187 @@
+//
+// InputThreadTest.cpp
+//
+// A pipe stands in for the keyboard: each key is the time it was written. The keys are
+// handled on the input thread, which hands them on to a UI thread through a queue, the
+// way Core does with CallAfter(). The UI thread stalls now and then, as it does while a
+// dialog is painted, and the time it takes the input thread to see each key is checked.
+//
+
+#include "../../src/InputThread.h"
+#include "../../src/Queue.h"
+#include <unistd.h>
+#include <cassert>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const int kKeyCount = 40;
+static const auto kKeyInterval = std::chrono::milliseconds(10);
+static const auto kUiStall = std::chrono::milliseconds(250);
+static const int kKeysPerStall = 15;
+
+// Runs what is queued to it, until it gets an empty function.
+class UiThread
+{
+public:
+    UiThread() : m_thread([this]() { for (auto f = m_queue.Dequeue(); f; f = m_queue.Dequeue()) f(); }) {}
+    ~UiThread() { m_queue.Enqueue(std::function<void()>()); m_thread.join(); }
+
+    void CallAfter(std::function<void()> f) { m_queue.Enqueue(std::move(f)); }
+
+private:
+    Queue<std::function<void()>> m_queue;
+    std::thread m_thread;
+};
+
+static void sendKeys(int fd) {
+    for (int i = 0; i < kKeyCount; i++) {
+        const Clock::time_point sent = Clock::now();
+        const ssize_t written = write(fd, &sent, sizeof(sent));
+        assert(written == sizeof(sent));
+        (void)written;
+        std::this_thread::sleep_for(kKeyInterval);
+    }
+}
+
+// Reads one key, epoll wakes the thread again while there are more.
+static bool readKey(int fd, Clock::time_point& sent) {
+    return read(fd, &sent, sizeof(sent)) == sizeof(sent);
+}
+
+static void openPipe(int fds[2]) {
+    const int result = pipe(fds);
+    assert(result == 0);
+    (void)result;
+}
+
+static Clock::duration maxOf(const std::vector<Clock::duration>& latencies) {
+    Clock::duration result = Clock::duration::zero();
+    for (auto latency : latencies) result = std::max(result, latency);
+    return result;
+}
+
+static long toMs(Clock::duration duration) {
+    return static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(duration).count());
+}
+
+// The baseline: keys handled by the UI thread wait for its stalls.
+static void testKeysOnTheUiThreadWait() {
+    int fds[2];
+    openPipe(fds);
+
+    std::mutex mutex;
+    std::vector<Clock::duration> latencies;
+    {
+        UiThread ui;
+        InputThread input;
+        int count = 0;
+        // Only the reading is done on the input thread here
+        const bool bStarted = input.Start(fds[0], [&]() {
+            Clock::time_point sent;
+            if (!readKey(fds[0], sent)) return;
+            const bool bStall = count++ % kKeysPerStall == 0;
+            ui.CallAfter([&, sent, bStall]() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    latencies.push_back(Clock::now() - sent);
+                }
+                if (bStall) std::this_thread::sleep_for(kUiStall);
+            });
+        });
+        assert(bStarted);
+        (void)bStarted;
+        sendKeys(fds[1]);
+        input.Stop();
+    }
+
+    assert(latencies.size() == static_cast<size_t>(kKeyCount));
+    std::cout << "on the UI thread:    max latency " << toMs(maxOf(latencies)) << " ms" << std::endl;
+    assert(maxOf(latencies) >= kUiStall / 2);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void testKeysOnTheInputThreadDoNotWait() {
+    int fds[2];
+    openPipe(fds);
+
+    std::vector<Clock::duration> latencies;
+    std::vector<int> shown;
+    {
+        UiThread ui;
+        InputThread input;
+        const bool bStarted = input.Start(fds[0], [&]() {
+            Clock::time_point sent;
+            if (!readKey(fds[0], sent)) return;
+            latencies.push_back(Clock::now() - sent);
+            const int key = static_cast<int>(latencies.size());
+            ui.CallAfter([&, key]() {
+                shown.push_back(key);
+                if (key % kKeysPerStall == 1) std::this_thread::sleep_for(kUiStall);
+            });
+        });
+        assert(bStarted);
+        (void)bStarted;
+        sendKeys(fds[1]);
+        input.Stop();
+        std::cout << "on the input thread: max latency " << toMs(maxOf(latencies)) << " ms"
+                  << (input.IsHighPriority() ? "" : " (normal priority)") << std::endl;
+    }
+
+    // The UI thread got everything, in order, once it caught up
+    assert(latencies.size() == static_cast<size_t>(kKeyCount));
+    assert(shown.size() == static_cast<size_t>(kKeyCount));
+    for (int i = 0; i < kKeyCount; i++) assert(shown[i] == i + 1);
+
+    // Generous for loaded build machines, but well below a single stall
+    assert(maxOf(latencies) < std::chrono::milliseconds(50));
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void testStopWithoutInput() {
+    int fds[2];
+    openPipe(fds);
+
+    int calls = 0;
+    InputThread input;
+    const bool bStarted = input.Start(fds[0], [&]() { calls++; });
+    assert(bStarted);
+    (void)bStarted;
+    const Clock::time_point start = Clock::now();
+    input.Stop();
+    assert(Clock::now() - start < std::chrono::seconds(1));
+    (void)start;
+    assert(calls == 0);
+
+    // Stopping again, as the destructor does, is harmless
+    input.Stop();
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void testStartFailsWithoutDescriptor() {
+    InputThread input;
+    const bool bStarted = input.Start(-1, []() {});
+    assert(!bStarted);
+    (void)bStarted;
+    input.Stop();
+}
+
+int main() {
+    testKeysOnTheUiThreadWait();
+    testKeysOnTheInputThreadDoNotWait();
+    testStopWithoutInput();
+    testStartFailsWithoutDescriptor();
+    std::cout << "All input thread tests passed." << std::endl;
+    return 0;
+}
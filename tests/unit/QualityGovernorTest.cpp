@@ -0,0 +1,67 @@
+//
+// QualityGovernorTest.cpp
+//
+
+#include "../../src/QualityGovernor.h"
+#include <cassert>
+#include <iostream>
+
+static void testStartsAtBestLevel() {
+    QualityGovernor latency(QualityPolicy::Latency);
+    assert(latency.GetLevel() == 1);
+    assert(latency.GetQuality() == 100 && latency.GetResponsiveness() == 100);
+
+    QualityGovernor quality(QualityPolicy::Quality);
+    assert(quality.GetLevel() == 0);
+    assert(quality.GetQuality() == 100 && quality.GetResponsiveness() == 0);
+}
+
+static void testStepsDownWhenFallingBehind() {
+    QualityGovernor governor(QualityPolicy::Latency);
+    QualityDecision decision;
+    assert(governor.Update(1.2, decision));
+    assert(decision.level == 2 && decision.quality == 75 && decision.realTimeFactor == 1.2);
+    assert(governor.Update(0.8, decision) && decision.level == 3);
+
+    for (int i = 0; i < 10; i++) governor.Update(0.5, decision);
+    assert(governor.GetLevel() == QualityGovernor::kLevelCount - 1);
+    assert(governor.GetQuality() == 0);
+}
+
+static void testHysteresis() {
+    QualityGovernor governor(QualityPolicy::Quality);
+    QualityDecision decision;
+    assert(governor.Update(1.0, decision) && decision.level == 1);
+
+    // Within the band between the thresholds nothing changes.
+    for (int i = 0; i < 10; i++) assert(!governor.Update(1.5, decision));
+
+    // Stepping up needs several measurements in a row with headroom.
+    assert(!governor.Update(2.5, decision));
+    assert(!governor.Update(2.5, decision));
+    assert(!governor.Update(1.5, decision));
+    assert(!governor.Update(2.5, decision));
+    assert(!governor.Update(2.5, decision));
+    assert(governor.Update(2.5, decision) && decision.level == 0);
+
+    // Never above the best level of the policy.
+    for (int i = 0; i < 10; i++) assert(!governor.Update(10.0, decision));
+}
+
+static void testPolicyChangeStartsOver() {
+    QualityGovernor governor(QualityPolicy::Latency);
+    QualityDecision decision;
+    governor.Update(0.5, decision);
+    governor.SetPolicy(QualityPolicy::Quality);
+    assert(governor.GetPolicy() == QualityPolicy::Quality);
+    assert(governor.GetLevel() == 0);
+}
+
+int main() {
+    testStartsAtBestLevel();
+    testStepsDownWhenFallingBehind();
+    testHysteresis();
+    testPolicyChangeStartsOver();
+    std::cout << "All quality governor tests passed.\n";
+    return 0;
+}
@@ -0,0 +1,102 @@
+//
+// ReplayBufferTest.cpp
+//
+
+#include "../../src/ReplayBuffer.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <string>
+
+static void record(ReplayBuffer& buffer, const std::string& audio, size_t pieces = 1) {
+    buffer.Begin();
+    const size_t size = audio.size() / pieces;
+    for (size_t pos = 0; pos < audio.size(); pos += size) {
+        buffer.Append(audio.data() + pos, std::min(size, audio.size() - pos));
+    }
+    buffer.Commit();
+}
+
+static std::string get(const ReplayBuffer& buffer, size_t back) {
+    std::vector<char> audio;
+    if (!buffer.Get(back, audio)) return "-";
+    return std::string(audio.begin(), audio.end());
+}
+
+static void testLatestFirst() {
+    ReplayBuffer buffer(64, 3);
+    record(buffer, "een");
+    record(buffer, "twee");
+    assert(buffer.GetCount() == 2);
+    assert(get(buffer, 0) == "twee");
+    assert(get(buffer, 1) == "een");
+    assert(get(buffer, 2) == "-");
+}
+
+static void testMaxClips() {
+    ReplayBuffer buffer(64, 2);
+    record(buffer, "een");
+    record(buffer, "twee");
+    record(buffer, "drie");
+    assert(buffer.GetCount() == 2);
+    assert(get(buffer, 0) == "drie" && get(buffer, 1) == "twee");
+}
+
+static void testWrapsAround() {
+    ReplayBuffer buffer(10, 5);
+    record(buffer, "abcdef");
+    record(buffer, "ghij");
+    assert(buffer.GetCount() == 2);
+
+    // Overwrites the first clip, and wraps around the end of the ring.
+    record(buffer, "klmnop", 4);
+    assert(buffer.GetCount() == 2);
+    assert(get(buffer, 0) == "klmnop");
+    assert(get(buffer, 1) == "ghij");
+}
+
+static void testTooLargeIsDropped() {
+    ReplayBuffer buffer(8, 5);
+    record(buffer, "abc");
+    record(buffer, "much too long for the ring", 5);
+    assert(get(buffer, 0) == "abc");
+}
+
+static void testDiscard() {
+    ReplayBuffer buffer(64, 5);
+    record(buffer, "een");
+    buffer.Begin();
+    buffer.Append("twee", 4);
+    buffer.Discard();
+    assert(!buffer.Commit());
+    assert(buffer.GetCount() == 1 && get(buffer, 0) == "een");
+
+    // Nothing is recorded outside Begin() and Commit().
+    buffer.Append("drie", 4);
+    buffer.Begin();
+    assert(!buffer.Commit());
+    assert(buffer.GetCount() == 1);
+}
+
+static void testDisabled() {
+    ReplayBuffer buffer;
+    record(buffer, "een");
+    assert(buffer.GetCount() == 0);
+
+    buffer.SetLimits(16, 1);
+    record(buffer, "een");
+    assert(get(buffer, 0) == "een");
+    buffer.SetLimits(16, 1);
+    assert(buffer.GetCount() == 0);
+}
+
+int main() {
+    testLatestFirst();
+    testMaxClips();
+    testWrapsAround();
+    testTooLargeIsDropped();
+    testDiscard();
+    testDisabled();
+    std::cout << "All replay buffer tests passed." << std::endl;
+    return 0;
+}
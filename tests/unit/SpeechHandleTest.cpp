@@ -0,0 +1,193 @@
+//
+// SpeechHandleTest.cpp
+//
+
+#include "../../src/SpeechHandle.h"
+#include <cassert>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+static void testFinishesOnce() {
+    auto pUtterance = std::make_shared<Utterance>(1);
+    SpeechHandle handle(pUtterance);
+    assert(handle.IsValid() && handle.GetId() == 1);
+    assert(handle.GetState() == UtteranceState::Queued && !handle.IsFinished());
+
+    assert(pUtterance->Begin([]() {}));
+    assert(handle.GetState() == UtteranceState::Speaking);
+
+    pUtterance->Finish(UtteranceState::Done);
+    pUtterance->Finish(UtteranceState::Cancelled);
+    assert(handle.Wait() == UtteranceState::Done);
+    assert(handle.GetTimes().ended >= handle.GetTimes().requested);
+}
+
+static void testListeners() {
+    auto pUtterance = std::make_shared<Utterance>(2);
+    SpeechHandle handle(pUtterance);
+
+    int calls = 0;
+    UtteranceState state = UtteranceState::Queued;
+    handle.OnFinished([&](UtteranceState s) { calls++; state = s; });
+    assert(calls == 0);
+
+    pUtterance->Finish(UtteranceState::Done);
+    assert(calls == 1 && state == UtteranceState::Done);
+
+    // Listeners added after the fact are called right away.
+    handle.OnFinished([&](UtteranceState) { calls++; });
+    assert(calls == 2);
+    assert(!pUtterance->AddListener([](UtteranceState) {}));
+}
+
+static void testCancelWhileQueued() {
+    auto pUtterance = std::make_shared<Utterance>(3);
+    SpeechHandle handle(pUtterance);
+
+    handle.Cancel();
+    assert(handle.GetState() == UtteranceState::Cancelled);
+    assert(!pUtterance->Begin([]() { assert(false); }));
+}
+
+static void testCancelWhileSpeaking() {
+    auto pUtterance = std::make_shared<Utterance>(4);
+    SpeechHandle handle(pUtterance);
+
+    int interrupts = 0;
+    assert(pUtterance->Begin([&]() { interrupts++; }));
+    handle.Cancel();
+    assert(interrupts == 1);
+    assert(!handle.IsFinished());
+
+    // Speech finishes it once playback has stopped, the cancel takes precedence.
+    pUtterance->Finish(UtteranceState::Done);
+    assert(handle.GetState() == UtteranceState::Cancelled);
+
+    handle.Cancel();
+    assert(interrupts == 1);
+}
+
+// Stopping may finish the utterance right away, on the thread that cancels it.
+static void testCancelHandlerMayFinish() {
+    auto pUtterance = std::make_shared<Utterance>(9);
+    SpeechHandle handle(pUtterance);
+
+    assert(pUtterance->Begin([&]() { pUtterance->Finish(UtteranceState::Done); }));
+    handle.Cancel();
+    assert(handle.GetState() == UtteranceState::Cancelled);
+}
+
+static void testFailure() {
+    auto pUtterance = std::make_shared<Utterance>(5);
+    assert(pUtterance->Begin([]() {}));
+    pUtterance->MarkFailed();
+    pUtterance->Finish(UtteranceState::Done);
+    assert(SpeechHandle(pUtterance).GetState() == UtteranceState::Failed);
+}
+
+static void testDroppedTicketCancels() {
+    auto pUtterance = std::make_shared<Utterance>(6);
+    SpeechHandle handle(pUtterance);
+    {
+        UtteranceTicket ticket(pUtterance);
+        UtteranceTicket moved(std::move(ticket));
+        assert(!ticket && moved);
+    }
+    assert(handle.GetState() == UtteranceState::Cancelled);
+
+    // A finished utterance stays finished when its ticket is dropped.
+    auto pDone = std::make_shared<Utterance>(7);
+    {
+        UtteranceTicket ticket(pDone);
+        ticket->Finish(UtteranceState::Done);
+    }
+    assert(pDone->GetState() == UtteranceState::Done);
+}
+
+static void testSynthesisTimes() {
+    auto pUtterance = std::make_shared<Utterance>(8);
+    const auto first = std::chrono::steady_clock::now();
+    const auto second = first + std::chrono::milliseconds(10);
+    pUtterance->SetSynthesisTimes(first, first);
+    pUtterance->SetSynthesisTimes(second, second);
+    pUtterance->MarkStarted();
+
+    UtteranceTimes times = pUtterance->GetTimes();
+    assert(times.synthesisStarted == first);
+    assert(times.synthesisEnded == second);
+    assert(times.started != std::chrono::steady_clock::time_point());
+}
+
+static void testWaitAcrossThreads() {
+    auto pUtterance = std::make_shared<Utterance>(9);
+    SpeechHandle handle(pUtterance);
+    assert(!handle.WaitFor(std::chrono::milliseconds(1)));
+
+    std::thread player([pUtterance]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        pUtterance->Finish(UtteranceState::Done);
+    });
+    assert(handle.GetFuture().get() == UtteranceState::Done);
+    player.join();
+}
+
+static void testInvalidHandle() {
+    SpeechHandle handle;
+    assert(!handle.IsValid() && handle.IsFinished());
+    assert(handle.Wait() == UtteranceState::Cancelled);
+    assert(handle.GetFuture().get() == UtteranceState::Cancelled);
+    handle.Cancel();
+}
+
+#ifdef SPEECH_HANDLE_COROUTINES
+// Fire-and-forget coroutine, just enough to co_await a handle.
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+static Detached awaitHandle(SpeechHandle handle, UtteranceState& result) {
+    result = co_await handle;
+}
+
+static void testCoroutine() {
+    auto pUtterance = std::make_shared<Utterance>(10);
+    UtteranceState result = UtteranceState::Queued;
+    awaitHandle(SpeechHandle(pUtterance), result);
+    assert(result == UtteranceState::Queued);
+
+    pUtterance->Finish(UtteranceState::Done);
+    assert(result == UtteranceState::Done);
+
+    // Awaiting a finished utterance does not suspend.
+    awaitHandle(SpeechHandle(pUtterance), result = UtteranceState::Queued);
+    assert(result == UtteranceState::Done);
+}
+#endif
+
+int main() {
+    testFinishesOnce();
+    testListeners();
+    testCancelWhileQueued();
+    testCancelWhileSpeaking();
+    testCancelHandlerMayFinish();
+    testFailure();
+    testDroppedTicketCancels();
+    testSynthesisTimes();
+    testWaitAcrossThreads();
+    testInvalidHandle();
+#ifdef SPEECH_HANDLE_COROUTINES
+    testCoroutine();
+#endif
+    std::cout << "All speech handle tests passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,108 @@
+//
+// SpeechPoolTest.cpp
+//
+// Runs SpeechPool on the fake librstts in tests/fakes, which synthesizes at a known speed.
+//
+
+#include "../../src/SpeechPool.h"
+#include "../fakes/FakeRstts.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+static std::shared_ptr<SpeechPool::Batch> makeBatch(const char* const* chunks, size_t count) {
+    auto pBatch = std::make_shared<SpeechPool::Batch>();
+    for (size_t i = 0; i < count; i++) {
+        pBatch->offsets.push_back(pBatch->text.size());
+        pBatch->text.append(chunks[i]);
+        pBatch->text.push_back('\0');
+    }
+    return pBatch;
+}
+
+static void testPauseHoldsTheInstances() {
+    static const char* const kChunks[] = {
+        "Dit is de tweede zin van de selectie.",
+        "En dit is de derde zin ervan.",
+        "De vierde zin is de laatste.",
+    };
+    const size_t count = sizeof(kChunks) / sizeof(kChunks[0]);
+
+    FakeRstts::Settings settings;
+    settings.timePerChar = std::chrono::milliseconds(2);
+    FakeRstts::Configure(settings);
+
+    SpeechPool pool;
+    const bool bReady = pool.Init(1, "fake", "nl", "Ilse", 22050);
+    assert(bReady);
+    (void)bReady;
+
+    pool.Start(makeBatch(kChunks, count), 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    pool.Pause();
+
+    // The chunk under way is held, and no other one is started
+    const size_t started = FakeRstts::GetSyntheses().size();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    assert(FakeRstts::GetSyntheses().size() == started);
+    assert(started == 1);
+    (void)started;
+
+    // Nor one that is allowed while paused
+    pool.Resume();
+    std::vector<char> first;
+    double seconds = -1.0;
+    const bool bFirst = pool.Take(0, first, nullptr, &seconds);
+    assert(bFirst);
+    (void)bFirst;
+
+    // A paused synthesis says nothing about the speed of the instance
+    assert(seconds == 0.0);
+    pool.Pause();
+    pool.SetLimit(count);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    assert(FakeRstts::GetSyntheses().size() == started);
+
+    pool.Resume();
+    for (size_t i = 1; i < count; i++) {
+        std::vector<char> audio;
+        const bool bTaken = pool.Take(i, audio, nullptr, &seconds);
+        assert(bTaken && audio.size() == std::string(kChunks[i]).size() * settings.bytesPerChar);
+        (void)bTaken;
+
+        // The time per character of the fake, give or take the scheduling
+        const double expected = std::chrono::duration<double>(settings.timePerChar).count() * std::string(kChunks[i]).size();
+        assert(seconds >= expected && seconds < expected * 3);
+        (void)expected;
+    }
+    pool.Term();
+
+    FakeRstts::Configure(FakeRstts::Settings());
+}
+
+static void testCancelEndsAPause() {
+    static const char* const kChunks[] = { "Een zin.", "Nog een zin." };
+
+    SpeechPool pool;
+    const bool bReady = pool.Init(1, "fake", "nl", "Ilse", 22050);
+    assert(bReady);
+    (void)bReady;
+
+    pool.Pause();
+    pool.Cancel();
+    pool.Start(makeBatch(kChunks, 2), 2);
+    std::vector<char> audio;
+    const bool bTaken = pool.Take(1, audio);
+    assert(bTaken && !audio.empty());
+    (void)bTaken;
+    pool.Term();
+}
+
+int main() {
+    testPauseHoldsTheInstances();
+    testCancelEndsAPause();
+    std::cout << "All speech pool tests passed." << std::endl;
+    return 0;
+}
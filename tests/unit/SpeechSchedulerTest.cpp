@@ -0,0 +1,150 @@
+//
+// SpeechSchedulerTest.cpp
+//
+
+#include "../../src/SpeechScheduler.h"
+#include <cassert>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+
+static void testPriorityOrder() {
+    SpeechScheduler<std::string> scheduler;
+    scheduler.Enqueue(SpeechClass::Selection, "selection");
+    scheduler.Enqueue(SpeechClass::Word, "word");
+    scheduler.Enqueue(SpeechClass::Sentence, "sentence");
+    scheduler.Enqueue(SpeechClass::Letter, "letter");
+
+    std::string value;
+    assert(scheduler.Dequeue(value) && value == "letter");
+    assert(scheduler.Dequeue(value) && value == "word");      // same priority as sentence, FIFO
+    assert(scheduler.Dequeue(value) && value == "sentence");
+    assert(scheduler.Dequeue(value) && value == "selection");
+    assert(scheduler.GetStats().dispatched == 4);
+}
+
+static void testStaleWordIsSuperseded() {
+    SpeechScheduler<std::string> scheduler;
+    scheduler.Enqueue(SpeechClass::Word, "een");
+    scheduler.Enqueue(SpeechClass::Word, "twee");
+    scheduler.Enqueue(SpeechClass::Word, "drie");
+
+    std::string value;
+    SpeechClass cls;
+    assert(scheduler.Dequeue(value, &cls) && value == "drie" && cls == SpeechClass::Word);
+    assert(scheduler.GetDepth() == 0);
+    assert(scheduler.GetStats().superseded == 2);
+}
+
+static void testSentencesAreNotSuperseded() {
+    SpeechScheduler<std::string> scheduler(3);
+    scheduler.Enqueue(SpeechClass::Sentence, "een");
+    scheduler.Enqueue(SpeechClass::Sentence, "twee");
+    scheduler.Enqueue(SpeechClass::Selection, "selectie");
+    scheduler.Enqueue(SpeechClass::Sentence, "drie");  // evicts the selection
+    assert(scheduler.GetStats().superseded == 0);
+    assert(scheduler.GetStats().overflowed == 1);
+
+    std::string value;
+    assert(scheduler.Dequeue(value) && value == "een");
+    assert(scheduler.Dequeue(value) && value == "twee");
+    assert(scheduler.Dequeue(value) && value == "drie");
+    assert(scheduler.GetDepth() == 0);
+}
+
+static void testBoundedDepth() {
+    SpeechScheduler<std::string> scheduler(2);
+    scheduler.Enqueue(SpeechClass::Background, "background");
+    scheduler.Enqueue(SpeechClass::Selection, "selection");
+    scheduler.Enqueue(SpeechClass::Word, "word");  // evicts the background item
+    assert(scheduler.GetDepth() == 2);
+
+    scheduler.Enqueue(SpeechClass::Background, "late");  // lower than everything pending, dropped
+    assert(scheduler.GetDepth() == 2);
+    assert(scheduler.GetStats().overflowed == 2);
+
+    std::string value;
+    assert(scheduler.Dequeue(value) && value == "word");
+    assert(scheduler.Dequeue(value) && value == "selection");
+}
+
+static void testClearKeepsBackground() {
+    SpeechScheduler<std::string> scheduler;
+    scheduler.Enqueue(SpeechClass::Word, "word");
+    scheduler.Enqueue(SpeechClass::Selection, "selection");
+    scheduler.Enqueue(SpeechClass::Background, "background");
+    scheduler.Clear();
+
+    assert(scheduler.GetDepth() == 1);
+    assert(scheduler.GetStats().cancelled == 2);
+    std::string value;
+    assert(scheduler.Dequeue(value) && value == "background");
+}
+
+static void testCloseWakesConsumer() {
+    SpeechScheduler<std::string> scheduler;
+    bool result = true;
+    std::thread consumer([&]() {
+        std::string value;
+        result = scheduler.Dequeue(value);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    scheduler.Close();
+    consumer.join();
+    assert(!result);
+}
+
+static void testTryDequeueIf() {
+    SpeechScheduler<std::string> scheduler;
+    scheduler.Enqueue(SpeechClass::Word, "woord");
+    scheduler.Enqueue(SpeechClass::Selection, "selectie");
+
+    std::string value;
+    SpeechClass cls;
+    auto foreground = [](SpeechClass c, const std::string&) { return c != SpeechClass::Selection; };
+    assert(scheduler.TryDequeueIf(value, &cls, foreground) && value == "woord" && cls == SpeechClass::Word);
+    assert(!scheduler.TryDequeueIf(value, &cls, foreground));
+    assert(scheduler.GetDepth() == 1);
+    assert(scheduler.Dequeue(value) && value == "selectie");
+    assert(!scheduler.TryDequeueIf(value, &cls, foreground));
+}
+
+// Calls back when it is dropped, like a ticket that finishes its utterance.
+struct DropNotifier {
+    std::function<void()> onDrop;
+
+    DropNotifier() {}
+    explicit DropNotifier(std::function<void()> f) : onDrop(std::move(f)) {}
+    DropNotifier(DropNotifier&& other) noexcept : onDrop(std::move(other.onDrop)) { other.onDrop = nullptr; }
+    DropNotifier& operator=(DropNotifier&& other) noexcept { onDrop = std::move(other.onDrop); other.onDrop = nullptr; return *this; }
+    ~DropNotifier() { if (onDrop) onDrop(); }
+};
+
+static void testDroppedValuesAreDestroyedUnlocked() {
+    SpeechScheduler<DropNotifier> scheduler(2);
+    int drops = 0;
+    auto onDrop = [&]() { drops++; (void)scheduler.GetDepth(); };
+
+    scheduler.Enqueue(SpeechClass::Word, DropNotifier(onDrop));
+    scheduler.Enqueue(SpeechClass::Word, DropNotifier(onDrop));      // Supersedes
+    assert(drops == 1);
+    scheduler.Enqueue(SpeechClass::Selection, DropNotifier(onDrop));
+    scheduler.Enqueue(SpeechClass::Selection, DropNotifier(onDrop)); // Overflows
+    assert(drops == 2);
+    scheduler.Clear();
+    assert(drops == 4);
+}
+
+int main() {
+    testPriorityOrder();
+    testStaleWordIsSuperseded();
+    testSentencesAreNotSuperseded();
+    testBoundedDepth();
+    testClearKeepsBackground();
+    testCloseWakesConsumer();
+    testTryDequeueIf();
+    testDroppedValuesAreDestroyedUnlocked();
+    std::cout << "All speech scheduler tests passed.\n";
+    return 0;
+}
@@ -0,0 +1,296 @@
+//
+// SpeechTest.cpp
+//
+// Runs Speech on top of the fake librstts and PortAudio in tests/fakes, which synthesize
+// and play at a known speed, and tell which synthesis the audio being played came from.
+//
+
+#include "../../src/Speech.h"
+#include "../fakes/FakePortAudio.h"
+#include "../fakes/FakeRstts.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+static const char kSelection[] =
+    "Dit is de eerste zin van een lange selectie. Dit is de tweede zin ervan. "
+    "En dit is de derde zin, die ook nog wat langer is dan de andere twee.";
+
+static const std::chrono::seconds kTimeout(5);
+
+static void initSpeech(Speech& speech) {
+    const bool bReady = speech.Init("fake", "nl", "Ilse");
+    assert(bReady);
+    (void)bReady;
+}
+
+static void testStopDoesNotWaitForTheEngine() {
+    FakeRstts::Settings settings;
+    settings.stopTime = std::chrono::milliseconds(300);
+    settings.timePerChar = std::chrono::milliseconds(2);  // Still synthesizing when stopped
+    FakeRstts::Configure(settings);
+
+    Speech speech;
+    initSpeech(speech);
+
+    SpeechHandle handle = speech.Speak(kSelection, SpeechClass::Selection);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    const Clock::time_point start = Clock::now();
+    speech.Stop();
+    const Clock::duration latency = Clock::now() - start;
+    std::cout << "stop took " << std::chrono::duration_cast<std::chrono::microseconds>(latency).count() << " us" << std::endl;
+    assert(latency < settings.stopTime / 4);
+
+    const bool bFinished = handle.WaitFor(kTimeout);
+    assert(bFinished && handle.GetState() == UtteranceState::Cancelled);
+    (void)bFinished;
+
+    // The engine is waited for before the next utterance
+    SpeechHandle next = speech.Speak("klaar", SpeechClass::Sentence);
+    assert(next.Wait() == UtteranceState::Done);
+
+    FakeRstts::Configure(FakeRstts::Settings());
+}
+
+// The tag of the audio of the latest synthesis of text.
+static int16_t findSynthesis(const std::string& text) {
+    const std::vector<FakeRstts::Synthesis> syntheses = FakeRstts::GetSyntheses();
+    for (size_t i = syntheses.size(); i > 0; i--) {
+        if (syntheses[i - 1].text == text) return static_cast<int16_t>(i);
+    }
+    return 0;
+}
+
+static void testWordsAreSpokenDuringAPause() {
+    Speech speech;
+    initSpeech(speech);
+    speech.SetBargeIn(true);
+
+    SpeechHandle selection = speech.Speak(kSelection, SpeechClass::Selection);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    speech.Pause();
+
+    SpeechHandle word = speech.Speak("woord", SpeechClass::Word);
+    const bool bSpoken = word.WaitFor(kTimeout);
+    assert(bSpoken && word.GetState() == UtteranceState::Done);
+    assert(FakePortAudio::HasPlayed(findSynthesis("woord")));
+    (void)bSpoken;
+
+    // The selection stayed paused, and continues after the word
+    assert(selection.GetState() != UtteranceState::Done);
+    speech.Resume();
+    assert(selection.Wait() == UtteranceState::Done);
+    const std::vector<int16_t> played = FakePortAudio::GetPlayed();
+    assert(played.back() != findSynthesis("woord"));
+
+    // The device was silenced without playing out its buffer
+    assert(FakePortAudio::GetStopCount() == 0);
+}
+
+// The last word of a sentence and the sentence itself, typed while the engine loads.
+static void testUnpreparedSentenceIsBatchedWithTheWord() {
+    FakeRstts::Settings settings;
+    settings.initTime = std::chrono::milliseconds(200);
+    FakeRstts::Configure(settings);
+
+    Speech speech;
+    speech.InitAsync("fake", "nl", "Ilse");
+    SpeechHandle word = speech.Speak("zin.", SpeechClass::Word);
+    SpeechHandle sentence = speech.SpeakPrepared("Dit is een zin.");
+    assert(word.Wait() == UtteranceState::Done);
+    assert(sentence.Wait() == UtteranceState::Done);
+    FakeRstts::Configure(FakeRstts::Settings());
+
+    const FakeRstts::Synthesis batch = FakeRstts::GetSyntheses().back();
+    assert(batch.format == "ssml");
+    assert(batch.text.find("zin.") < batch.text.find("Dit is een zin."));
+    assert(batch.text.find("Dit is een zin.") != std::string::npos);
+    (void)batch;
+}
+
+// Whether a synthesis of text was started, waiting up to kTimeout for it.
+static bool waitForSynthesis(const std::string& text) {
+    const Clock::time_point deadline = Clock::now() + kTimeout;
+    while (findSynthesis(text) == 0) {
+        if (Clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+static void testIdleUnloadAndReload() {
+    Speech speech;
+    initSpeech(speech);
+    speech.SetIdleTimeout(std::chrono::milliseconds(200));
+
+    SpeechHandle word = speech.Speak("eerst", SpeechClass::Word);
+    assert(word.Wait() == UtteranceState::Done);
+    const bool bUnloaded = FakeRstts::WaitForInstanceCount(0, kTimeout);
+    assert(bUnloaded);
+    (void)bUnloaded;
+
+    // A key press reloads, and the sentence that is being typed is still prepared
+    FakeRstts::Settings settings;
+    settings.initTime = std::chrono::milliseconds(100);
+    FakeRstts::Configure(settings);
+    speech.Wake();
+    speech.Prepare("Dit is, ");
+    speech.Wake();
+    const bool bPrepared = waitForSynthesis("Dit is, ");
+    assert(bPrepared);
+    (void)bPrepared;
+    assert(FakeRstts::GetInstanceCount() == 1);
+    FakeRstts::Configure(FakeRstts::Settings());
+
+    SpeechHandle next = speech.Speak("dan", SpeechClass::Word);
+    assert(next.Wait() == UtteranceState::Done);
+    assert(FakePortAudio::HasPlayed(findSynthesis("dan")));
+}
+
+// A Stop() while a clause of the sentence is prepared cuts off its audio, which is not used.
+static void testStoppedPrepareIsDropped() {
+    FakeRstts::Settings settings;
+    settings.timePerChar = std::chrono::milliseconds(20);
+    FakeRstts::Configure(settings);
+
+    Speech speech;
+    initSpeech(speech);
+    speech.Prepare("Zo is het, ");
+    const bool bStarted = waitForSynthesis("Zo is het, ");
+    assert(bStarted);
+    (void)bStarted;
+    speech.Stop();
+    FakeRstts::Configure(FakeRstts::Settings());
+
+    SpeechHandle sentence = speech.SpeakPrepared("Zo is het, goed.");
+    assert(sentence.Wait() == UtteranceState::Done);
+    assert(FakeRstts::GetSyntheses().back().text == "Zo is het, goed.");
+}
+
+// Only completed clauses are prepared, and a word typed meanwhile does not wait for them.
+static void testClausesArePreparedBetweenWords() {
+    FakeRstts::Settings settings;
+    settings.timePerChar = std::chrono::milliseconds(5);
+    FakeRstts::Configure(settings);
+
+    Speech speech;
+    initSpeech(speech);
+    speech.Prepare("Als het morgen regent, blijven we thuis, en dan ");
+    const bool bStarted = waitForSynthesis("Als het morgen regent, ");
+    assert(bStarted);
+    (void)bStarted;
+    SpeechHandle word = speech.Speak("thuis,", SpeechClass::Word);
+    assert(word.Wait() == UtteranceState::Done);
+    const bool bPrepared = waitForSynthesis("blijven we thuis, ");
+    assert(bPrepared);
+    (void)bPrepared;
+    assert(findSynthesis("thuis,") < findSynthesis("blijven we thuis, "));
+    FakeRstts::Configure(FakeRstts::Settings());
+
+    SpeechHandle sentence = speech.SpeakPrepared("Als het morgen regent, blijven we thuis, en dan lezen we.");
+    assert(sentence.Wait() == UtteranceState::Done);
+    assert(FakeRstts::GetSyntheses().back().text == "en dan lezen we.");
+}
+
+static void testBargeInStopsAReplay() {
+    Speech speech;
+    initSpeech(speech);
+    speech.SetBargeIn(true);
+
+    SpeechHandle sentence = speech.Speak(kSelection, SpeechClass::Sentence);
+    assert(sentence.Wait() == UtteranceState::Done);
+    const bool bReplaying = speech.Replay();
+    assert(bReplaying);
+    (void)bReplaying;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // The word does not wait for the rest of the replay
+    const Clock::time_point start = Clock::now();
+    SpeechHandle word = speech.Speak("nu", SpeechClass::Word);
+    assert(word.Wait() == UtteranceState::Done);
+    const Clock::duration latency = Clock::now() - start;
+    std::cout << "word after replay took " << std::chrono::duration_cast<std::chrono::milliseconds>(latency).count() << " ms" << std::endl;
+    assert(latency < std::chrono::milliseconds(300));
+}
+
+// Stop() is called from the keyboard hook, which must not wait for the device.
+static void testDeviceIsStoppedOnThePlaybackThread() {
+    Speech speech;
+    initSpeech(speech);
+
+    const size_t before = FakeRstts::GetSyntheses().size();
+    SpeechHandle sentence = speech.Speak(kSelection, SpeechClass::Sentence);
+    const Clock::time_point deadline = Clock::now() + kTimeout;
+    while (Clock::now() < deadline && !(static_cast<size_t>(findSynthesis(kSelection)) > before && FakePortAudio::HasPlayed(findSynthesis(kSelection)))) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    const unsigned aborts = FakePortAudio::GetAbortCount();
+    const unsigned ownAborts = FakePortAudio::GetAbortCount(std::this_thread::get_id());
+    speech.Stop();
+    assert(sentence.Wait() == UtteranceState::Cancelled);
+    while (Clock::now() < deadline && FakePortAudio::GetAbortCount() == aborts) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    assert(FakePortAudio::GetAbortCount() > aborts);
+    assert(FakePortAudio::GetAbortCount(std::this_thread::get_id()) == ownAborts);
+    (void)ownAborts;
+}
+
+static void testSpeedChangeDropsPreparedAudio() {
+    Speech speech;
+    initSpeech(speech);
+    speech.Prepare("Nu gaat het, ");
+    const bool bPrepared = waitForSynthesis("Nu gaat het, ");
+    assert(bPrepared);
+    (void)bPrepared;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    speech.SetSpeed(20.0f);
+
+    const size_t start = FakePortAudio::GetPlayed().size();
+    SpeechHandle sentence = speech.SpeakPrepared("Nu gaat het, sneller.");
+    assert(sentence.Wait() == UtteranceState::Done);
+    const std::vector<int16_t> played = FakePortAudio::GetPlayed();
+    const std::vector<FakeRstts::Synthesis> syntheses = FakeRstts::GetSyntheses();
+    assert(played.size() > start);
+    for (size_t i = start; i < played.size(); i++) {
+        assert(syntheses[played[i] - 1].speed == static_cast<float>(RSTTS_SPEED_DEFAULT) + 20.0f);
+    }
+    (void)syntheses;
+}
+
+static void testLetterWithProsody() {
+    Speech speech;
+    initSpeech(speech);
+    SsmlProsody prosody;
+    prosody.rate = 80;
+    speech.SetProsody(SpeechClass::Letter, prosody);
+
+    SpeechHandle letter = speech.Speak("q", SpeechClass::Letter);
+    assert(letter.Wait() == UtteranceState::Done);
+    const FakeRstts::Synthesis synthesis = FakeRstts::GetSyntheses().back();
+    assert(synthesis.format == "ssml");
+    assert(synthesis.text.find("<prosody rate=\"80%\">q</prosody>") != std::string::npos);
+    (void)synthesis;
+}
+
+int main() {
+    FakePortAudio::SetSpeed(4.0);
+    testStopDoesNotWaitForTheEngine();
+    testWordsAreSpokenDuringAPause();
+    testUnpreparedSentenceIsBatchedWithTheWord();
+    testIdleUnloadAndReload();
+    testBargeInStopsAReplay();
+    testDeviceIsStoppedOnThePlaybackThread();
+    testStoppedPrepareIsDropped();
+    testClausesArePreparedBetweenWords();
+    testLetterWithProsody();
+    testSpeedChangeDropsPreparedAudio();
+    std::cout << "All speech tests passed." << std::endl;
+    return 0;
+}
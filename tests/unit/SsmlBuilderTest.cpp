@@ -0,0 +1,65 @@
+//
+// SsmlBuilderTest.cpp
+//
+
+#include "../../src/SsmlBuilder.h"
+#include <cassert>
+#include <iostream>
+#include <string>
+
+static bool contains(const std::string& s, const std::string& part) {
+    return s.find(part) != std::string::npos;
+}
+
+static void testBatch() {
+    SsmlBuilder builder;
+    builder.Add(SpeechClass::Word, "mat");
+    builder.Add(SpeechClass::Sentence, "De kat zat op de mat.");
+    assert(builder.GetCount() == 2);
+
+    std::string document = builder.Finish();
+    assert(document.compare(0, 5, "<?xml") == 0);
+    assert(contains(document, "<speak "));
+    assert(contains(document, ">mat<break time=\"300ms\"/><s>De kat zat op de mat.</s></speak>"));
+    assert(builder.GetCount() == 0);
+}
+
+static void testWordBreaks() {
+    SsmlBuilder builder;
+    builder.Add(SpeechClass::Letter, "a");
+    builder.Add(SpeechClass::Word, "aap");
+    assert(contains(builder.Finish(), ">a<break time=\"150ms\"/>aap</speak>"));
+}
+
+static void testEscaping() {
+    SsmlBuilder builder;
+    builder.Add(SpeechClass::Word, "<b> & 'c' \"d\"");
+    assert(contains(builder.Finish(), "&lt;b&gt; &amp; &apos;c&apos; &quot;d&quot;"));
+}
+
+static void testProsody() {
+    SsmlBuilder builder;
+    SsmlProsody letter;
+    letter.rate = 80;
+    builder.SetProsody(SpeechClass::Letter, letter);
+    SsmlProsody sentence;
+    sentence.pitch = -10;
+    builder.SetProsody(SpeechClass::Sentence, sentence);
+    builder.SetProsody(SpeechClass::Word, SsmlProsody());
+    assert(builder.HasProsody(SpeechClass::Letter) && !builder.HasProsody(SpeechClass::Word));
+
+    builder.Add(SpeechClass::Letter, "k");
+    builder.Add(SpeechClass::Word, "kat");
+    builder.Add(SpeechClass::Sentence, "De kat.");
+    assert(contains(builder.Finish(), "><prosody rate=\"80%\">k</prosody><break time=\"150ms\"/>kat"
+        "<break time=\"300ms\"/><prosody pitch=\"-10%\"><s>De kat.</s></prosody></speak>"));
+}
+
+int main() {
+    testBatch();
+    testWordBreaks();
+    testEscaping();
+    testProsody();
+    std::cout << "All SSML builder tests passed.\n";
+    return 0;
+}
@@ -0,0 +1,151 @@
+//
+// TextModelTest.cpp
+//
+
+#include "../../src/TextModel.h"
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static void testTyping() {
+    TextModel model(4);
+    model.Insert("Hallo");
+    model.Insert(" ");
+    model.Insert("wereld");
+    assert(model.GetText() == "Hallo wereld");
+    assert(model.GetCursor() == 12);
+    assert(model.GetWordBeforeCursor() == "wereld");
+
+    model.Clear();
+    assert(model.IsEmpty() && model.GetText().empty());
+    assert(!model.Backspace() && !model.Delete() && !model.MoveLeft() && !model.MoveRight());
+}
+
+static void testBackspaceRemovesWholeCharacters() {
+    TextModel model;
+    model.Insert("caf\xC3\xA9");  // Precomposed e with acute
+    assert(model.Backspace());
+    assert(model.GetText() == "caf");
+
+    model.Insert("e\xCC\x81");  // e followed by a combining acute accent
+    assert(model.Backspace());
+    assert(model.GetText() == "caf");
+
+    model.Insert("\xF0\x9F\x91\x8D\xF0\x9F\x8F\xBD");  // Thumbs up with a skin tone
+    model.Insert("\xF0\x9F\x91\xA8\xE2\x80\x8D\xF0\x9F\x91\xA9\xE2\x80\x8D\xF0\x9F\x91\xA7");  // Family
+    assert(model.Backspace());
+    assert(model.Backspace());
+    assert(model.GetText() == "caf");
+}
+
+static void testFlags() {
+    const std::string nl = "\xF0\x9F\x87\xB3\xF0\x9F\x87\xB1";
+    const std::string be = "\xF0\x9F\x87\xA7\xF0\x9F\x87\xAA";
+    TextModel model;
+    model.Insert(nl + be + nl);
+    assert(model.MoveLeft());
+    assert(model.GetCursor() == 16);
+    assert(model.Backspace());
+    assert(model.GetText() == nl + nl);
+    model.Home();
+    assert(model.Delete());
+    assert(model.GetText() == nl);
+}
+
+static void testEditingInTheMiddle() {
+    TextModel model;
+    model.Insert("Het is mooi");
+    for (int i = 0; i < 4; i++) model.MoveLeft();
+    model.Insert("erg ");
+    assert(model.GetText() == "Het is erg mooi");
+    assert(model.GetWordBeforeCursor().empty());
+    assert(model.Delete());
+    assert(model.GetText() == "Het is erg ooi");
+    model.End();
+    assert(model.GetWordBeforeCursor() == "ooi");
+}
+
+static void testInvalidUtf8() {
+    TextModel model;
+    model.Insert("a\xFF\xC3");
+    assert(model.Backspace());
+    assert(model.Backspace());
+    assert(model.GetText() == "a");
+}
+
+// Replays a long random editing session against a document kept as a list of
+// characters, as an editor would show it.
+static void testReplay() {
+    const std::vector<std::string> characters = {
+        "a", "b", "z", " ", "\xC3\xA9", "e\xCC\x81", "\xC3\x9F", "\xE2\x82\xAC",
+        "\xF0\x9F\x91\x8D\xF0\x9F\x8F\xBD",
+        "\xF0\x9F\x91\xA8\xE2\x80\x8D\xF0\x9F\x91\xA9\xE2\x80\x8D\xF0\x9F\x91\xA7",
+        "\xF0\x9F\x87\xB3\xF0\x9F\x87\xB1",
+    };
+
+    std::mt19937 random(42);
+    TextModel model(8);
+    std::vector<std::string> document;
+    size_t cursor = 0;
+
+    for (int step = 0; step < 20000; step++) {
+        switch (random() % 10) {
+        case 0:
+        case 1:
+            if (model.Backspace()) document.erase(document.begin() + --cursor);
+            else assert(cursor == 0);
+            break;
+        case 2:
+            if (model.Delete()) document.erase(document.begin() + cursor);
+            else assert(cursor == document.size());
+            break;
+        case 3:
+            if (model.MoveLeft()) cursor--;
+            else assert(cursor == 0);
+            break;
+        case 4:
+            if (model.MoveRight()) cursor++;
+            else assert(cursor == document.size());
+            break;
+        case 5:
+            if (random() % 20 == 0) {
+                model.Home();
+                cursor = 0;
+            }
+            else if (random() % 20 == 0) {
+                model.End();
+                cursor = document.size();
+            }
+            break;
+        default:
+            {
+                const std::string& c = characters[random() % characters.size()];
+                model.Insert(c);
+                document.insert(document.begin() + cursor++, c);
+            }
+            break;
+        }
+
+        std::string before, text;
+        for (size_t i = 0; i < document.size(); i++) {
+            if (i == cursor) before = text;
+            text += document[i];
+        }
+        if (cursor == document.size()) before = text;
+        assert(model.GetText() == text);
+        assert(model.GetCursor() == before.size());
+    }
+}
+
+int main() {
+    testTyping();
+    testBackspaceRemovesWholeCharacters();
+    testFlags();
+    testEditingInTheMiddle();
+    testInvalidUtf8();
+    testReplay();
+    std::cout << "All text model tests passed." << std::endl;
+    return 0;
+}
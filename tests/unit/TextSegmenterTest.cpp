@@ -0,0 +1,93 @@
+//
+// TextSegmenterTest.cpp
+//
+
+#include "../../src/TextSegmenter.h"
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static std::vector<std::string> segment(const std::string& text, size_t maxLength = TextSegmenter::kDefaultMaxLength) {
+    std::vector<std::string> chunks;
+    TextSegmenter segmenter(text.data(), text.size(), maxLength);
+    TextChunk chunk;
+    while (segmenter.Next(chunk)) {
+        assert(chunk.begin < chunk.end && chunk.end <= text.size());
+        chunks.push_back(text.substr(chunk.begin, chunk.end - chunk.begin));
+    }
+    return chunks;
+}
+
+static void testSentences() {
+    auto chunks = segment("  Dit is een zin. Is dit er nog een?  Ja!\n");
+    assert(chunks.size() == 3);
+    assert(chunks[0] == "Dit is een zin.");
+    assert(chunks[1] == "Is dit er nog een?");
+    assert(chunks[2] == "Ja!");
+}
+
+static void testPunctuationRunsAndQuotes() {
+    auto chunks = segment("Echt?! \"Ja.\" Hij wacht\xE2\x80\xA6 En dan...");
+    assert(chunks.size() == 4);
+    assert(chunks[0] == "Echt?!");
+    assert(chunks[1] == "\"Ja.\"");
+    assert(chunks[2] == "Hij wacht\xE2\x80\xA6");
+    assert(chunks[3] == "En dan...");
+}
+
+static void testNoSplitInsideNumbersAndAbbreviations() {
+    auto chunks = segment("Het kost 3.50 euro, bijv. op www.clevy.com vandaag. Klaar");
+    assert(chunks.size() == 2);
+    assert(chunks[0] == "Het kost 3.50 euro, bijv. op www.clevy.com vandaag.");
+    assert(chunks[1] == "Klaar");
+}
+
+static void testParagraphs() {
+    std::string text = "Kop zonder punt\n  \nTekst van\nde alinea";
+    TextSegmenter segmenter(text.data(), text.size());
+    TextChunk chunk;
+    assert(segmenter.Next(chunk) && chunk.paragraph);
+    assert(text.substr(chunk.begin, chunk.end - chunk.begin) == "Kop zonder punt");
+    assert(segmenter.Next(chunk) && !chunk.paragraph);
+    assert(text.substr(chunk.begin, chunk.end - chunk.begin) == "Tekst van\nde alinea");
+    assert(!segmenter.Next(chunk));
+}
+
+static void testLongSentenceSplitsAtWhitespace() {
+    auto chunks = segment("een twee drie vier vijf", 10);
+    assert(chunks.size() == 3);
+    assert(chunks[0] == "een twee");
+    assert(chunks[1] == "drie vier");
+    assert(chunks[2] == "vijf");
+}
+
+static void testLongWordSplitsAtCharacterBoundary() {
+    std::string word;
+    for (int i = 0; i < 10; i++) word += "\xC3\xA9";  // e acute, two bytes each
+    auto chunks = segment(word, 5);
+    std::string joined;
+    for (const auto& chunk : chunks) {
+        assert((static_cast<unsigned char>(chunk[0]) & 0xC0) != 0x80);
+        assert(chunk.size() % 2 == 0);
+        joined += chunk;
+    }
+    assert(joined == word);
+}
+
+static void testEmptyText() {
+    assert(segment("").empty());
+    assert(segment(" \n\n\t ").empty());
+}
+
+int main() {
+    testSentences();
+    testPunctuationRunsAndQuotes();
+    testNoSplitInsideNumbersAndAbbreviations();
+    testParagraphs();
+    testLongSentenceSplitsAtWhitespace();
+    testLongWordSplitsAtCharacterBoundary();
+    testEmptyText();
+    std::cout << "All text segmenter tests passed.\n";
+    return 0;
+}
@@ -0,0 +1,89 @@
+//
+// TextTimelineTest.cpp
+//
+
+#include "../../src/TextTimeline.h"
+#include <cassert>
+#include <iostream>
+
+static const size_t kSecond = 22050 * 2;
+
+// "Een zin. Nog een zin. Laatste." with a sentence every three seconds.
+static TextTimeline makeTimeline() {
+    TextTimeline timeline;
+    timeline.Add({ TextMarkType::Sentence, 0, 8, 0 });
+    timeline.Add({ TextMarkType::Word, 0, 3, 0 });
+    timeline.Add({ TextMarkType::Word, 4, 8, kSecond });
+    timeline.Add({ TextMarkType::Sentence, 9, 21, 3 * kSecond });
+    timeline.Add({ TextMarkType::Word, 9, 12, 3 * kSecond });
+    timeline.Add({ TextMarkType::Word, 13, 16, 4 * kSecond });
+    timeline.Add({ TextMarkType::Sentence, 22, 30, 6 * kSecond });
+    timeline.Add({ TextMarkType::Word, 22, 30, 6 * kSecond });
+    return timeline;
+}
+
+static void testFind() {
+    TextTimeline timeline = makeTimeline();
+    TextMark mark;
+    assert(timeline.Find(TextMarkType::Word, kSecond + 10, mark));
+    assert(mark.textBegin == 4 && mark.textEnd == 8);
+    assert(timeline.Find(TextMarkType::Sentence, 4 * kSecond, mark));
+    assert(mark.textBegin == 9);
+    assert(timeline.Find(TextMarkType::Word, 3 * kSecond, mark) && mark.textBegin == 9);
+}
+
+static void testDuplicatesIgnored() {
+    TextTimeline timeline = makeTimeline();
+    const size_t count = timeline.GetCount();
+    // The engine reports the sentence that the segmentation already added.
+    timeline.Add({ TextMarkType::Sentence, 22, 30, 6 * kSecond + 4 });
+    assert(timeline.GetCount() == count);
+}
+
+static void testRepeat() {
+    TextTimeline timeline = makeTimeline();
+    size_t target = 0;
+
+    // Well into the second sentence: back to its start.
+    assert(timeline.GetRepeatOffset(5 * kSecond, target));
+    assert(target == 3 * kSecond);
+
+    // Just after it started: back to the first one.
+    assert(timeline.GetRepeatOffset(3 * kSecond + 100, target));
+    assert(target == 0);
+
+    // The first sentence has nothing before it.
+    assert(timeline.GetRepeatOffset(100, target));
+    assert(target == 0);
+}
+
+static void testSkip() {
+    TextTimeline timeline = makeTimeline();
+    size_t target = 0;
+    assert(timeline.GetSkipOffset(0, target) && target == 3 * kSecond);
+    assert(timeline.GetSkipOffset(4 * kSecond, target) && target == 6 * kSecond);
+    assert(!timeline.GetSkipOffset(6 * kSecond, target));
+}
+
+static void testDropBefore() {
+    TextTimeline timeline = makeTimeline();
+    timeline.DropBefore(3 * kSecond);
+    TextMark mark;
+    assert(!timeline.Find(TextMarkType::Sentence, 2 * kSecond, mark));
+    size_t target = 0;
+    assert(timeline.GetRepeatOffset(3 * kSecond + 100, target) && target == 3 * kSecond);
+
+    timeline.Clear();
+    assert(timeline.GetCount() == 0);
+    assert(!timeline.GetRepeatOffset(0, target));
+}
+
+int main() {
+    testFind();
+    testDuplicatesIgnored();
+    testRepeat();
+    testSkip();
+    testDropBefore();
+    std::cout << "All text timeline tests passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,77 @@
+//
+// VoicePoolTest.cpp
+//
+// Runs VoicePool on the fake librstts in tests/fakes, which takes a known time to load
+// an instance.
+//
+
+#include "../../src/VoicePool.h"
+#include "../fakes/FakeRstts.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+static const std::chrono::milliseconds kInitTime(300);
+
+static void configure(VoicePool& pool) {
+    FakeRstts::Settings settings;
+    settings.initTime = kInitTime;
+    FakeRstts::Configure(settings);
+
+    pool.Configure("fake", 22050, 64 * 1024 * 1024);
+    pool.AddVoice("nl", "Ilse");
+    pool.AddVoice("en", "Daniel");
+}
+
+static void testSettingsDoNotWaitForALoad() {
+    VoicePool pool;
+    configure(pool);
+
+    std::shared_ptr<SpeechEngine> pEngine;
+    std::thread loader([&]() { pEngine = pool.Acquire("Daniel"); });
+    std::this_thread::sleep_for(kInitTime / 4);
+
+    const Clock::time_point start = Clock::now();
+    pool.SetSpeed(1.2f);
+    const std::vector<std::string> voices = pool.GetResidentVoices();
+    assert(Clock::now() - start < kInitTime / 4);
+    assert(voices.empty());
+    (void)start;
+
+    loader.join();
+    assert(pEngine);
+    assert(pool.GetResidentVoices() == std::vector<std::string>{ "Daniel" });
+    pEngine.reset();
+    pool.Term();
+
+    FakeRstts::Configure(FakeRstts::Settings());
+}
+
+static void testAcquireWaitsForAPreload() {
+    VoicePool pool;
+    configure(pool);
+
+    std::thread preloader([&]() { pool.Preload(); });
+    std::this_thread::sleep_for(kInitTime / 4);
+
+    // The first voice is being loaded, it is not loaded a second time
+    std::shared_ptr<SpeechEngine> pEngine = pool.Acquire("Ilse");
+    assert(pEngine);
+    preloader.join();
+    assert(FakeRstts::GetInstanceCount() == 2);
+    pEngine.reset();
+    pool.Term();
+    assert(FakeRstts::GetInstanceCount() == 0);
+
+    FakeRstts::Configure(FakeRstts::Settings());
+}
+
+int main() {
+    testSettingsDoNotWaitForALoad();
+    testAcquireWaitsForAPreload();
+    std::cout << "All voice pool tests passed." << std::endl;
+    return 0;
+}